@@ -18,12 +18,14 @@
 #include <wx/string.h>
 #include <vector>
 #include <map>
+#include <memory>
 #include <set> 
 
 class tpicons;
 class tpSignalKNotesManager;
 class tpConfigDialog;
 class SignalKNote;
+class tpNoteBatch;
 
 class signalk_notes_opencpn_pi : public opencpn_plugin_119 {
 public:
@@ -58,7 +60,7 @@ public:
     double longitude;
     wxString subResourceSetName;  // Name des Unter-Resourcesets
     wxString resourceSetName;     // Name des Haupt-Resourcesets (z.B. "Funk")
-    wxString GUID;  // generiert: "RS_<resourceSetName>_<subName>_<index>"
+    wxString GUID;  // generiert: "RS_<resourceSetName>_<subName>_<hash>"
   };
 
   struct SubResourceSetConfig {
@@ -67,10 +69,23 @@ public:
     wxString iconName;  // gewähltes Icon (Dateiname ohne .svg)
   };
 
+  // Reihenfolge im Abruf-Batch, kleiner = früher
+  enum ResourceSetPriority {
+    RS_PRIORITY_HIGH = 0,
+    RS_PRIORITY_NORMAL = 1,
+    RS_PRIORITY_BACKGROUND = 2  // nur bei freier Leitung
+  };
+
   struct ResourceSetConfig {
     wxString name;  // Name des Haupt-Resourcesets (z.B. "Funk")
     bool enabled = false;
     std::map<wxString, SubResourceSetConfig> subSets;  // subName -> config
+    // Aktualisierung: ab refreshMinutes fällig (0 = globales Intervall),
+    // wird aber nur bei freier Leitung geholt; ab maxStaleMinutes
+    // (0 = sofort) auch zusammen mit dem Viewport-Abruf
+    int refreshMinutes = 0;
+    int priority = RS_PRIORITY_NORMAL;
+    int maxStaleMinutes = 0;
   };
 
   // Bitmap-Erzeugung / GL-Vorbereitung
@@ -112,6 +127,7 @@ public:
   bool KeyboardEventHook(wxKeyEvent& event) override;
 
   void LateInit(void) override;
+  void SetPositionFixEx(PlugIn_Position_Fix_Ex& pfix) override;
 
   wxBitmap* GetPlugInBitmap() override;
 
@@ -124,11 +140,32 @@ public:
     double lastFetchCenterLon = 0.0;
     double lastFetchDistance = 0.0;
     wxLongLong lastFetchTime = 0;
-    wxLongLong lastRSFetchTime = 0;
-    std::map<wxString, SignalKNote> notes;
-    mutable wxMutex notesMutex;  // Schützt notes
+    // resourceSetName -> letzter Abruf; fehlt ein Set, wird es sofort geholt
+    std::map<wxString, wxLongLong> rsFetchTimes;
+    // Die Notes selbst hält der Manager einmal für alle Canvas. Nur im
+    // UI-Thread benutzt; der Render-Pfad liest über tpNoteSnapshot.
     ClusterZoomState clusterZoom;
-    std::map<wxString, SignalKNote> resourceSetNotes;
+    // Je Resourceset der geteilte Stand und daraus die Notes im Fenster
+    struct ResourceSetView {
+      std::shared_ptr<const tpNoteBatch> notes;
+      std::vector<const SignalKNote*> window;
+    };
+    std::map<wxString, ResourceSetView> resourceSets;
+    // Umkreis, aus dem die Fenster stammen (Radius 0: alles)
+    double rsWindowLat = 0.0;
+    double rsWindowLon = 0.0;
+    double rsWindowRadius = 0.0;
+    bool notesDirty = false;  // Fetch-Ergebnis übernommen → Cluster neu bauen
+    // Kennung für die HTTP-Validatoren der Resourcesets dieses Canvas; ein
+    // neu angelegter State bekommt eine neue und lädt sie wieder vollständig
+    unsigned long fetchSession = 0;
+    // Schwenkgeschwindigkeit aus aufeinanderfolgenden Viewports (m/s),
+    // geglättet; Stichprobe = Zeit und Mittelpunkt der letzten Messung
+    double panNorthMps = 0.0;
+    double panEastMps = 0.0;
+    wxLongLong panSampleTime = 0;
+    double panSampleLat = 0.0;
+    double panSampleLon = 0.0;
   };
   std::map<int, CanvasState> m_canvasStates;
 
@@ -140,7 +177,7 @@ public:
   double CalculateMaxDistance(const CanvasState& state);
   void UpdateOverviewDialog();
   wxString GetPluginIconDir() const;
-  int GetVisibleNoteCount(CanvasState& state) const;
+  int GetVisibleNoteCount(int canvasIndex) const;
   int GetVisibleNoteCount() const;
 
   // Public state
@@ -172,11 +209,17 @@ public:
   bool IsDebugMode() const { return m_debugMode; }
   void SetDebugMode(bool v) { m_debugMode = v; }
   void SetFetchInterval(int v) { m_fetchInterval = v; }
+  bool IsStreamUpdates() const { return m_streamUpdates; }
+  void SetStreamUpdates(bool v) { m_streamUpdates = v; }
+  void RestartStream();
   void ShowPreferencesDialog(wxWindow* parent);
   wxWindow* GetParentWindow();
   virtual void SetCurrentViewPort(PlugIn_ViewPort& vp) override;
   int m_activeCanvasIndex = 0;
   bool m_dialogOpen = false;
+  // Startzeit bis zu den ersten Icons, fürs Debug-Log
+  wxLongLong m_initTime = 0;
+  bool m_firstIconsLogged = false;
   // Resourceset-Konfiguration
   std::map<wxString, ResourceSetConfig>
       m_resourceSetConfigs;                    // resourceSetName -> config
@@ -186,6 +229,17 @@ public:
   void LoadResourceSetConfig(wxFileConfig* pConf);
   wxString m_pluginDataDir;
 
+  // Eigenes Schiff aus SetPositionFixEx
+  struct OwnshipState {
+    bool valid = false;
+    double lat = 0.0;
+    double lon = 0.0;
+    double cog = 0.0;  // Grad, NaN wenn unbekannt
+    double sog = 0.0;  // Knoten
+    wxLongLong fixTime = 0;  // lokale Zeit des Empfangs
+  };
+  const OwnshipState& GetOwnship() const { return m_ownship; }
+
 
 private:
   bool DoRenderCommon(PlugIn_ViewPort* vp, int canvasIndex, int priority);
@@ -195,6 +249,7 @@ private:
                          int canvasIndex, int priority);
   void PruneCanvasStates(int canvasIndex);
   bool ViewPortsDiffer(const PlugIn_ViewPort& a, const PlugIn_ViewPort& b);
+  void UpdatePanVelocity(CanvasState& state);
   // Config + UI
   wxFileConfig* m_pTPConfig = nullptr;
   int m_signalk_notes_opencpn_button_id = -1;
@@ -203,6 +258,7 @@ private:
   tpConfigDialog* m_pOverviewDialog = nullptr;
   tpConfigDialog* m_pConfigDialog = nullptr;
   friend class tpSignalKNotesManager;
+  friend class tpConfigDialog;
 
   // Bitmap-Caching
   std::map<wxString, wxBitmap> m_iconBitmapCache;  // iconName -> Bitmap
@@ -229,10 +285,12 @@ private:
   int m_clusterMaxScale;
   int m_clusterMinScale;
   int m_fetchInterval;
+  bool m_streamUpdates = false;  // Push-Updates über SignalK-Stream
   bool m_debugMode = false;
   double m_prevChartScale = -1;
   wxPoint m_mouseDownPos;
   std::set<wxString> m_availableResourceSets;
+  OwnshipState m_ownship;
 
 };
 
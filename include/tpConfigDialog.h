@@ -21,8 +21,11 @@
 #include <wx/notebook.h>
 #include <wx/spinctrl.h>
 #include <wx/clrpicker.h>
+#include <wx/gauge.h>
 
 class signalk_notes_opencpn_pi;
+class tpConfigLoader;
+struct tpConfigLoadResult;
 
 class tpConfigDialog : public wxDialog {
 public:
@@ -32,10 +35,15 @@ public:
   void UpdateIconMappings(const std::set<wxString>& skIcons);
 
   std::map<wxString, bool> GetProviderSettings() const;
+  // providerId -> minutes, only providers with their own interval
+  std::map<wxString, int> GetProviderIntervals() const;
   std::map<wxString, wxString> GetIconMappings() const;
 
   void LoadSettings(const std::map<wxString, bool>& providers,
                     const std::map<wxString, wxString>& iconMappings);
+  // Opens from the known state; providers and resourcesets are completed
+  // from the server in the background
+  void StartLoading();
   void UpdateVisibleCount(int count);
   void UpdateVisibleCount(int left, int right);
   void LoadDisplaySettings(int iconSize, int clusterSize, int clusterRadius,
@@ -111,9 +119,20 @@ private:
 
   // Event-Handler
   void SaveProviderSettings();
+  wxString GetSelectedProviderId() const;
+  void OnProviderSelected(wxCommandEvent& event);
+  void OnProviderIntervalChanged(wxSpinEvent& event);
   void OnOK(wxCommandEvent& event);
   void OnCancel(wxCommandEvent& event);
 
+  // Hintergrund-Abfragen beim Öffnen
+  tpConfigLoader* m_loader = nullptr;
+  bool m_providersLoading = false;  // /plugins/ steht noch aus
+  std::set<wxString> m_rsLoading;   // Resourcesets, deren Abruf aussteht
+  void StopLoading();
+  void OnConfigLoadResult(tpConfigLoadResult& result);
+  void UpdateLoadingLabels();
+
   // UI-Elemente
   wxStaticText* m_countLabel;       // Anzeige bei 1 Canvas
   wxStaticText* m_countLabelLeft;   // "Icons im Kartenausschnitt links:"
@@ -121,6 +140,8 @@ private:
   wxStaticText* m_countLabelTotal;  // "Icons gesamt:"
   wxStaticText* m_infoLabel;
   wxCheckListBox* m_providerList;
+  wxSpinCtrl* m_providerIntervalCtrl = nullptr;  // Intervall des markierten
+  std::map<wxString, int> m_providerIntervals;   // providerId -> Minuten
 
   // Icon-Mapping UI
   wxScrolledWindow* m_iconMappingPanel;
@@ -176,6 +197,7 @@ private:
   wxSpinCtrl* m_clusterMinScaleCtrl;  // "Minimaler Maßstab für Cluster 1:"
   wxStaticText* m_scaleErrorLabel;    // Fehlermeldung für Maßstab-Validierung
   wxSpinCtrl* m_fetchIntervalCtrl;  // "Intervall API Aktualisierung (Minuten)"
+  wxCheckBox* m_streamCheckbox = nullptr;  // Push-Updates über SignalK-Stream
 
   void CreateDisplayTab();
   void UpdateIconPreview();
@@ -199,10 +221,30 @@ private:
   struct MainRSRow {
     wxString rsName;
     wxCheckBox* enabledCheck = nullptr;
+    wxSpinCtrl* refreshCtrl = nullptr;    // Minuten, 0 = globales Intervall
+    wxChoice* priorityCtrl = nullptr;     // ResourceSetPriority
+    wxSpinCtrl* maxStaleCtrl = nullptr;   // Minuten
+    wxStaticText* loadingLabel = nullptr;  // während des Abrufs sichtbar
     std::vector<SubRSRow> subRows;
   };
   std::vector<MainRSRow> m_rsRows;
   void OnMainRSToggled(wxCommandEvent& event);
+
+  // Offline UI
+  wxChoice* m_offlineAreaChoice = nullptr;  // Kartenausschnitt oder Route
+  wxArrayString m_offlineRouteGuids;        // Route je Eintrag ab Index 1
+  wxSpinCtrl* m_offlineCorridorCtrl = nullptr;  // Seemeilen je Seite
+  wxGauge* m_offlineGauge = nullptr;
+  wxStaticText* m_offlineStatusLabel = nullptr;
+  wxButton* m_offlineResumeButton = nullptr;
+  wxButton* m_offlineStopButton = nullptr;
+
+  void CreateOfflineTab();
+  void UpdateOfflineStatus();
+  void OnOfflineDownload(wxCommandEvent& event);
+  void OnOfflineResume(wxCommandEvent& event);
+  void OnOfflineStop(wxCommandEvent& event);
+  void OnOfflineClear(wxCommandEvent& event);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,52 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Background requests of the configuration dialog
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPCONFIGLOADER_H_
+#define _TPCONFIGLOADER_H_
+
+#include "tpSignalKNotes.h"
+#include "tpHttpClient.h"
+
+#include <wx/thread.h>
+#include <functional>
+
+// Runs the server requests of the config dialog, so the dialog opens at once
+// from the state at hand. Every answer is passed to onResult on the UI
+// thread through target as soon as it arrives; a FINISHED result follows the
+// last one. The owner of target stops and deletes the loader before target
+// goes away.
+class tpConfigLoader : public wxThread {
+public:
+  typedef std::function<void(tpConfigLoadResult&)> ResultFn;
+
+  tpConfigLoader(tpSignalKNotesManager* manager, const tpConfigLoadJob& job,
+                 wxEvtHandler* target, const ResultFn& onResult);
+
+  void RequestStop();
+
+protected:
+  ExitCode Entry() override;
+
+private:
+  bool IsStopRequested();
+  void Post(tpConfigLoadResult& result);
+
+  tpSignalKNotesManager* m_manager;
+  tpConfigLoadJob m_job;
+  wxEvtHandler* m_target;
+  ResultFn m_onResult;
+  tpHttpClient m_http;  // only used from Entry()
+
+  wxMutex m_mutex;  // protects m_stopRequested
+  bool m_stopRequested = false;
+};
+
+#endif  // _TPCONFIGLOADER_H_
@@ -0,0 +1,66 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Compressed storage for resourceset note descriptions
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPDESCRIPTIONSTORE_H_
+#define _TPDESCRIPTIONSTORE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class tpBinaryWriter;
+class tpBinaryReader;
+
+// Descriptions of resourceset notes, often long HTML, are only read when a
+// note is clicked. They are appended here while parsing and deflated in
+// blocks of CHUNK_SIZE bytes, so only the block being filled is held
+// uncompressed. Reading one inflates its block again. Filled by a single
+// parser, read-only once Finish() was called.
+class tpDescriptionStore {
+public:
+  static const size_t CHUNK_SIZE = 64 * 1024;
+
+  // Handle for SignalKNote::SetDescriptionRef(); 0 for an empty text
+  uint32_t Add(const std::string& utf8);
+  // Compresses the last block
+  void Finish();
+  std::string Get(uint32_t ref) const;
+  // Adds the texts of refs (ascending) from source, inflating each of its
+  // blocks once; returns the new handles in the same order
+  std::vector<uint32_t> AddFrom(const tpDescriptionStore& source,
+                                const std::vector<uint32_t>& refs);
+  // Finished store, blocks still deflated, for tpWarmStartFile
+  void Write(tpBinaryWriter& out) const;
+  bool Read(tpBinaryReader& in);
+
+  size_t GetCount() const { return m_entries.size(); }
+  size_t GetRawBytes() const { return m_rawBytes; }
+  size_t GetCompressedBytes() const;
+  // Heap blocks and bytes held
+  size_t GetAllocations() const;
+  size_t GetMemoryUsage() const;
+
+private:
+  struct Entry {
+    uint32_t chunk;
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  void FlushChunk();
+
+  std::vector<Entry> m_entries;      // by ref - 1
+  std::vector<std::string> m_chunks;  // deflated
+  std::string m_pending;             // block being filled
+  size_t m_rawBytes = 0;
+};
+
+#endif  // _TPDESCRIPTIONSTORE_H_
@@ -0,0 +1,57 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Background worker thread for SignalK note fetching
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPFETCHWORKER_H_
+#define _TPFETCHWORKER_H_
+
+#include "signalk_notes_opencpn_pi.h"
+#include "tpSignalKNotes.h"
+#include "tpHttpClient.h"
+
+#include <wx/thread.h>
+#include <map>
+#include <vector>
+
+// Runs the HTTP requests and JSON parsing for viewport driven fetches off the
+// UI thread. Requests are coalesced per canvas: a new request for a canvas
+// replaces the one still waiting in the queue, so only the latest viewport is
+// fetched. Notes tiles still in flight are aborted as soon as a newer
+// viewport for its canvas is posted. Prefetches are only queued while
+// nothing else waits for their canvas and give way to any real request.
+// Finished results are handed back to the manager, which applies them on the
+// UI thread. The manager runs one worker per SignalK server.
+class tpFetchWorker : public wxThread {
+public:
+  tpFetchWorker(tpSignalKNotesManager* manager);
+
+  void Post(const tpFetchRequest& request);
+  void RequestStop();
+  // true if nothing is queued or in flight
+  bool IsIdle();
+
+protected:
+  ExitCode Entry() override;
+
+private:
+  bool IsSuperseded(const tpFetchRequest& request);
+
+  tpSignalKNotesManager* m_manager;
+  tpHttpClient m_http;  // only used from Entry()
+
+  wxMutex m_mutex;  // protects the members below
+  wxCondition m_cond;
+  std::vector<tpFetchRequest> m_pending;
+  std::map<int, unsigned long> m_latestGeneration;  // by canvas index
+  bool m_stopRequested = false;
+  bool m_busy = false;  // a request is being executed
+};
+
+#endif  // _TPFETCHWORKER_H_
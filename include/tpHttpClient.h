@@ -0,0 +1,163 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Pooled HTTP transport for all SignalK server requests
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPHTTPCLIENT_H_
+#define _TPHTTPCLIENT_H_
+
+#include <wx/string.h>
+#include <wx/thread.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+class tpRequestGovernor;
+
+#if (defined(__linux__) || defined(__APPLE__)) && !defined(__OCPN__ANDROID__)
+#define TP_HTTP_USE_CURL
+#endif
+
+// One HTTP exchange: filled in by the caller, completed by tpHttpClient.
+struct tpHttpRequest {
+  tpHttpRequest() {}
+  tpHttpRequest(const wxString& requestUrl,
+                const wxString& requestAuthHeader = wxEmptyString)
+      : url(requestUrl), authHeader(requestAuthHeader) {}
+
+  // Request
+  wxString url;
+  wxString authHeader;  // complete header line, "Authorization: Bearer ..."
+  std::string postBody;  // sent as POST when not empty
+  wxString contentType;
+  // Limits connecting and any stall while waiting or receiving, not the
+  // whole transfer
+  long timeoutSecs = 10;
+  // Enables conditional GET: the client remembers validators and a hash of
+  // the last body under this key and reports unchanged responses.
+  wxString cacheKey;
+  // Polled while the request waits or is in flight; returning true aborts it
+  std::function<bool()> isCancelled;
+  // When set, the body of a 2xx answer is handed over chunk by chunk as it
+  // arrives instead of being collected in body. Returning false aborts the
+  // transfer.
+  std::function<bool(const char* data, size_t size)> onData;
+  // Set by tpHttpClient when only the body hash can tell an unchanged answer
+  // (cacheKey server without ETag/Last-Modified): the body is collected and
+  // handed to onData in one piece after the transfer, and only if it differs
+  // from the last one.
+  bool deferData = false;
+
+  // Conditional request headers, filled in by tpHttpClient from cacheKey
+  wxString ifNoneMatch;
+  wxString ifModifiedSince;
+
+  // Response
+  long status = 0;   // HTTP status code, 0/-1 on transport errors
+  wxString error;    // empty on success
+  std::string body;  // decoded response bytes (UTF-8), unless streamed
+  long long bodyBytes = 0;  // decoded size, streamed or not
+  uint64_t bodyHash = 0;    // FNV-1a of the decoded body
+  // Body bytes as received, before gzip/deflate/br decoding; -1 if the
+  // transport cannot tell
+  long long wireBytes = -1;
+  long elapsedMs = 0;  // total time of the transfer
+  // Until the response started to arrive: the server's latency, whatever
+  // the size of the body
+  long firstByteMs = 0;
+  wxString etag;
+  wxString lastModified;
+  // 304, or a body identical to the last one seen for cacheKey. The body is
+  // empty or unchanged and does not need to be parsed again.
+  bool notModified = false;
+  bool cancelled = false;  // aborted through isCancelled, status stays 0
+
+  bool IsOk() const {
+    return error.IsEmpty() &&
+           (notModified || (status >= 200 && status < 300));
+  }
+  wxString GetBodyString() const { return wxString::FromUTF8(body.c_str()); }
+};
+
+// Keep-alive HTTP client. On Linux/macOS all requests of a batch run
+// concurrently on one curl multi handle, whose connection cache survives
+// between batches (HTTP/1.1 keep-alive, HTTP/2 multiplexing over TLS). DNS and
+// TLS session caches are shared by all clients of the process. Windows keeps
+// one WinHTTP session (and its connection pool) alive, Android falls back to
+// wxHTTP; on both the batch runs sequentially.
+//
+// Cancelled requests are dropped from the multi handle mid-transfer on
+// curl; the sequential transports can only skip them before they start.
+//
+// Every transport negotiates compressed transfer and decodes while reading,
+// so body always holds the plain payload.
+//
+// With a governor set, requests to endpoints whose circuit is open fail
+// immediately with status -1, the remaining ones are rate limited and use the
+// adaptive timeout of their endpoint. Rate limiting never blocks the UI
+// thread.
+//
+// A client must only be used by one thread at a time - the UI thread and the
+// fetch worker each own their own instance.
+class tpHttpClient {
+public:
+  typedef std::function<void(size_t index, tpHttpRequest& request)>
+      CompletionFn;
+
+  tpHttpClient();
+  ~tpHttpClient();
+
+  void SetGovernor(tpRequestGovernor* governor) { m_governor = governor; }
+
+  // Runs all requests; onDone is called for every request as soon as it has
+  // finished, in completion order.
+  void PerformAll(std::vector<tpHttpRequest>& requests,
+                  const CompletionFn& onDone = CompletionFn());
+  bool Perform(tpHttpRequest& request);
+
+  // Plain GET. Returns the body on HTTP 200, an empty string otherwise.
+  wxString Get(const wxString& url, const wxString& authHeader = wxEmptyString,
+               long* httpStatusOut = nullptr, wxString* errorOut = nullptr);
+
+  // Drops the validators of cacheKey, the next request fetches in full
+  void ForgetValidators(const wxString& cacheKey);
+
+private:
+  tpHttpClient(const tpHttpClient&) = delete;
+  tpHttpClient& operator=(const tpHttpClient&) = delete;
+
+  // Platform specific transfer of a whole batch
+  void PerformBatch(std::vector<tpHttpRequest>& requests,
+                    const CompletionFn& onDone);
+
+  void PrepareConditional(tpHttpRequest& request);
+  void CompleteConditional(tpHttpRequest& request);
+
+  struct Validators {
+    wxString etag;
+    wxString lastModified;
+    uint64_t bodyHash = 0;
+  };
+  std::map<wxString, Validators> m_validators;  // by cacheKey
+
+  tpRequestGovernor* m_governor = nullptr;
+
+#ifdef TP_HTTP_USE_CURL
+  void* AcquireHandle();
+  void ReleaseHandle(void* handle);
+
+  void* m_multi = nullptr;           // CURLM*
+  std::vector<void*> m_idleHandles;  // CURL*, reused between requests
+#endif
+};
+
+#endif  // _TPHTTPCLIENT_H_
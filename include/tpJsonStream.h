@@ -0,0 +1,123 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Incremental JSON parser for streamed server responses
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPJSONSTREAM_H_
+#define _TPJSONSTREAM_H_
+
+#include <wx/jsonval.h>
+#include <string>
+#include <vector>
+
+// Push parser: the document is fed in arbitrary chunks as it arrives and
+// reported to a handler as events, without ever holding the whole text or a
+// DOM of it. Scalars are reported as their UTF-8 text, so a handler converts
+// only the fields it uses. A handler that wants a complete value - one note -
+// asks for it in CaptureValue and then receives it as a wxJSONValue, so memory
+// stays bounded by the largest captured value.
+//
+// Captured values are converted the way wxJSONReader does: integers that fit
+// become int, all other numbers double, strings are decoded from UTF-8.
+class tpJsonStream {
+public:
+  class Handler {
+  public:
+    virtual ~Handler() {}
+
+    // GetDepth() during these calls is the number of enclosing containers,
+    // GetKey()/GetIndex() of the innermost one tell where the value sits.
+    virtual void OnStartObject(const tpJsonStream& json) {}
+    virtual void OnEndObject(const tpJsonStream& json) {}
+    virtual void OnStartArray(const tpJsonStream& json) {}
+    virtual void OnEndArray(const tpJsonStream& json) {}
+    // text: decoded string, or number / true / false / null as written
+    virtual void OnScalar(const tpJsonStream& json, const std::string& text,
+                          bool isString) {}
+
+    // Asked before every value that starts outside a capture. Returning true
+    // delivers the whole value through OnValue instead of single events.
+    virtual bool CaptureValue(const tpJsonStream& json) { return false; }
+    virtual void OnValue(const tpJsonStream& json, wxJSONValue& value) {}
+  };
+
+  tpJsonStream(Handler& handler);
+
+  // false once the input is not valid JSON; further input is ignored
+  bool Feed(const char* data, size_t size);
+  // true if exactly one complete document was read
+  bool Finish();
+  bool HasError() const { return m_error; }
+
+  size_t GetDepth() const { return m_stack.size(); }
+  // Member name / element index of the value currently read in the
+  // container at level (0 = root); empty resp. -1 for the other kind
+  const std::string& GetKey(size_t level) const { return m_stack[level].key; }
+  int GetIndex(size_t level) const { return m_stack[level].index; }
+  bool IsArray(size_t level) const { return m_stack[level].isArray; }
+
+  // Number text as reported by OnScalar, independent of the locale
+  static bool ToDouble(const std::string& text, double& out);
+
+private:
+  enum State {
+    EXPECT_VALUE,
+    EXPECT_VALUE_OR_END,  // after '['
+    EXPECT_KEY_OR_END,    // after '{'
+    EXPECT_KEY,           // after ',' in an object
+    EXPECT_COLON,
+    EXPECT_COMMA_OR_END,
+    EXPECT_NOTHING  // document complete
+  };
+  enum Token { TOKEN_NONE, TOKEN_STRING, TOKEN_NUMBER, TOKEN_LITERAL };
+
+  struct Frame {
+    bool isArray = false;
+    std::string key;
+    int index = -1;
+  };
+
+  bool Fail();
+  bool BeginValue(char c);
+  void EndValue();
+  bool CloseContainer(bool isArray);
+  size_t ReadString(const char* data, size_t size, size_t pos);
+  bool AppendEscape(char c);
+  void AppendCodePoint(unsigned int cp);
+  void FlushSurrogate();
+  void AppendUtf8(unsigned int cp);
+  bool FinishString();
+  bool FinishScalarToken();
+
+  // Events, routed either to the handler or into the current capture
+  void EmitStart(bool isArray);
+  void EmitEnd(bool isArray);
+  void AddCaptured(const wxJSONValue& value);
+
+  Handler& m_handler;
+  std::vector<Frame> m_stack;
+  State m_state = EXPECT_VALUE;
+  bool m_error = false;
+
+  // Token in progress, may span several chunks
+  Token m_token = TOKEN_NONE;
+  std::string m_text;
+  bool m_tokenIsKey = false;
+  bool m_escape = false;
+  int m_unicodeDigits = -1;  // >= 0 while reading \uXXXX
+  unsigned int m_unicode = 0;
+  unsigned int m_highSurrogate = 0;
+
+  // Capture of a complete value for the handler
+  bool m_capturing = false;
+  std::vector<wxJSONValue> m_captureStack;
+  wxJSONValue m_captured;
+};
+
+#endif  // _TPJSONSTREAM_H_
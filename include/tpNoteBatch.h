@@ -0,0 +1,80 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Immutable block of notes from one resourceset fetch
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPNOTEBATCH_H_
+#define _TPNOTEBATCH_H_
+
+#include "tpSignalKNotes.h"
+#include "tpDescriptionStore.h"
+#include "tpTileCache.h"
+
+#include <stdint.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// All notes of one parsed resourceset in a single array, sorted by id and
+// indexed by Web Mercator tile at INDEX_ZOOM. Built once on the worker
+// thread and read-only afterwards, so the snapshot and every canvas share
+// it through a shared_ptr instead of copying notes into maps; dropping the
+// last reference releases the whole batch at once. Descriptions stay
+// compressed in the batch's tpDescriptionStore until a dialog asks for one.
+class tpNoteBatch {
+public:
+  // About 80 km wide tiles
+  static const int INDEX_ZOOM = 9;
+
+  // Takes over notes and the store their description refs point into. Of
+  // several notes with the same id the last one is kept, as a map would.
+  tpNoteBatch(std::vector<SignalKNote>& notes,
+              tpDescriptionStore& descriptions);
+
+  size_t GetCount() const { return m_notes.size(); }
+  const std::vector<SignalKNote>& GetNotes() const { return m_notes; }
+  const SignalKNote* Find(const wxString& id) const;
+  // Inflates the description of a note of this batch
+  wxString GetDescription(const SignalKNote& note) const;
+  const tpDescriptionStore& GetDescriptions() const { return m_descriptions; }
+  // Notes added, changed (other content hash) and removed since older,
+  // matched by id
+  struct Delta {
+    size_t added = 0;
+    size_t changed = 0;
+    size_t removed = 0;
+
+    bool IsEmpty() const { return added + changed + removed == 0; }
+  };
+  Delta CompareTo(const tpNoteBatch& older) const;
+  // Appends the notes in the tiles of range (at INDEX_ZOOM)
+  void CollectRange(const tpTileRange& range,
+                    std::vector<const SignalKNote*>& out) const;
+  // New batch with only the tiles in one of ranges (at INDEX_ZOOM). The
+  // descriptions it keeps are inflated once and compressed into its own
+  // store.
+  std::shared_ptr<tpNoteBatch> Extract(
+      const std::vector<tpTileRange>& ranges) const;
+
+  // Heap blocks and bytes held, for the debug log
+  size_t GetAllocations() const;
+  size_t GetMemoryUsage() const;
+
+private:
+  typedef std::pair<int, int> TileKey;  // (x, y)
+
+  std::vector<SignalKNote> m_notes;  // by id
+  // Positions in m_notes grouped by tile, and where each tile's group
+  // starts, ordered by tile
+  std::vector<uint32_t> m_byTile;
+  std::vector<std::pair<TileKey, uint32_t>> m_tiles;
+  tpDescriptionStore m_descriptions;
+};
+
+#endif  // _TPNOTEBATCH_H_
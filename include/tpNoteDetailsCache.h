@@ -0,0 +1,59 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Size-bounded LRU cache for note details
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPNOTEDETAILSCACHE_H_
+#define _TPNOTEDETAILSCACHE_H_
+
+#include "tpSignalKNotes.h"
+
+#include <list>
+#include <map>
+
+// Details (name, description, ...) of single notes by note id. The notes list
+// often leaves them out; they are loaded in the background for the notes on
+// screen so a click can open the dialog without a request. Once full, the
+// least recently used entry is dropped. Only used on the UI thread.
+class tpNoteDetailsCache {
+public:
+  static const size_t MAX_ENTRIES = 500;
+
+  // Copies the details into note on a hit; counts hits and misses
+  bool Get(const wxString& id, SignalKNote& note);
+  // Without touching the statistics or the LRU order
+  bool Contains(const wxString& id) const {
+    return m_entries.find(id) != m_entries.end();
+  }
+  void Put(const wxString& id, const SignalKNote& note);
+  void Remove(const wxString& id);
+  void Clear();
+
+  size_t GetSize() const { return m_entries.size(); }
+  unsigned long GetHits() const { return m_hits; }
+  unsigned long GetMisses() const { return m_misses; }
+  double GetHitRatio() const {
+    unsigned long total = m_hits + m_misses;
+    return total ? (double)m_hits / (double)total : 0.0;
+  }
+
+private:
+  struct Entry {
+    SignalKNote note;
+    std::list<wxString>::iterator lruPos;
+  };
+
+  std::map<wxString, Entry> m_entries;
+  std::list<wxString> m_lru;  // most recently used first
+
+  unsigned long m_hits = 0;
+  unsigned long m_misses = 0;
+};
+
+#endif  // _TPNOTEDETAILSCACHE_H_
@@ -0,0 +1,50 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Immutable, versioned view of the notes for the render path
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPNOTESNAPSHOT_H_
+#define _TPNOTESNAPSHOT_H_
+
+#include "tpSignalKNotes.h"
+
+#include <wx/string.h>
+
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+// The notes of all canvases as rendering, hit-testing and the dialogs read
+// them: the tile notes with the canvases showing each, and per canvas the
+// resourceset notes of its window. The manager builds a new snapshot after
+// every change and swaps it in atomically; a published one is never
+// modified. Readers take the current one without a lock and hold it while
+// they use its notes, so a refresh cannot pull a note away under them.
+struct tpNoteSnapshot {
+  struct Note {
+    std::shared_ptr<const SignalKNote> note;
+    uint32_t canvases = 0;  // bit per canvas index showing it
+  };
+
+  // Increases with every published snapshot; usable in cache keys
+  unsigned long version = 0;
+  std::vector<Note> notes;  // by UTF-8 id
+  // Resourceset batches any canvas shows; they own the window notes
+  std::vector<std::shared_ptr<const tpNoteBatch>> batches;
+  // Resourceset notes in each canvas' window, by canvas index
+  std::map<int, std::vector<const SignalKNote*>> windows;
+
+  // Tile or resourceset note; batch, if given, receives the batch holding
+  // a resourceset note and nullptr for a tile note
+  const SignalKNote* Find(const wxString& id,
+                          const tpNoteBatch** batch = nullptr) const;
+};
+
+#endif  // _TPNOTESNAPSHOT_H_
@@ -0,0 +1,159 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Streaming parsers for notes lists and resourcesets
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPNOTESPARSER_H_
+#define _TPNOTESPARSER_H_
+
+#include "signalk_notes_opencpn_pi.h"
+#include "tpSignalKNotes.h"
+#include "tpDescriptionStore.h"
+#include "tpJsonStream.h"
+
+#include <wx/longlong.h>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Turns a notes list ({id: note, ...}) into SignalKNote records while it is
+// downloaded. Each note is captured on its own, handed to
+// tpSignalKNotesManager::ParseNoteValue and stored in notes right away;
+// providers and icons seen are collected in result.
+class tpNotesListParser : public tpJsonStream::Handler {
+public:
+  tpNotesListParser(tpSignalKNotesManager* manager, tpFetchResult& result,
+                    std::map<wxString, SignalKNote>& notes);
+
+  bool Feed(const char* data, size_t size) { return m_json.Feed(data, size); }
+  bool Finish() { return m_json.Finish(); }
+  bool HasError() const { return m_json.HasError(); }
+
+  bool CaptureValue(const tpJsonStream& json) override;
+  void OnValue(const tpJsonStream& json, wxJSONValue& value) override;
+
+private:
+  tpSignalKNotesManager* m_manager;
+  tpFetchResult& m_result;
+  std::map<wxString, SignalKNote>& m_notes;
+  tpJsonStream m_json;
+};
+
+// Streams a resourceset in either layout the server delivers:
+//  - hierarchical: {uuid: {type: "ResourceSet", name, values: {features}}},
+//    one entry per sub-resourceset
+//  - flat: {uuid: {name, description, feature}}, one entry per note
+// No feature is built as a wxJSONValue: the few fields used are picked from
+// the parser events and only converted for notes that are kept. Notes of
+// disabled sub-resourcesets are not built once the sub-resourceset is known
+// to be valid - servers send name and type before values, so that is usually
+// the case after the first feature. The result is written to out by Finish().
+class tpResourceSetParser : public tpJsonStream::Handler {
+public:
+  tpResourceSetParser(
+      tpSignalKNotesManager* manager, const wxString& resourceSetName,
+      const std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
+          configuredSubs,
+      tpResourceSetResult& out);
+
+  bool Feed(const char* data, size_t size);
+  // false if the document is not valid JSON
+  bool Finish();
+  bool HasError() const { return m_json.HasError(); }
+
+  void OnStartObject(const tpJsonStream& json) override;
+  void OnEndObject(const tpJsonStream& json) override;
+  void OnStartArray(const tpJsonStream& json) override;
+  void OnScalar(const tpJsonStream& json, const std::string& text,
+                bool isString) override;
+
+private:
+  // Fields of one GeoJSON feature, UTF-8 until a note is built
+  struct Feature {
+    bool pointType = false;  // geometry.type == "Point"
+    int coordinates = 0;     // scalars in geometry.coordinates
+    double longitude = 0.0;
+    double latitude = 0.0;
+    bool hasProperties = false;
+    bool hasName = false;
+    std::string name;
+    bool hasDescription = false;
+    std::string description;
+
+    bool IsPoint() const { return pointType && coordinates >= 2; }
+  };
+
+  // Feature of a hierarchical entry, id and content hash still missing
+  struct PendingNote {
+    uint64_t identity;         // name and position, see FinishEntry
+    uint64_t descriptionHash;  // the text itself is in m_descriptions
+    SignalKNote note;
+  };
+
+  // Top level entry currently read
+  struct Entry {
+    wxString uuid;
+    wxString type;
+    bool hasName = false;
+    wxString name;
+    bool hasDescription = false;
+    std::string description;  // UTF-8, goes to m_descriptions
+    bool hasFeature = false;  // flat layout
+    Feature feature;
+    bool hasFeatureArray = false;  // hierarchical layout
+    bool hasValidFeature = false;  // a named point, see FinishEntry
+    // Notes built before the entry was known to be valid and enabled
+    std::vector<PendingNote> pending;
+  };
+
+  bool IsSubEnabled(const wxString& subName) const;
+  bool IsFeatureStart(const tpJsonStream& json) const;
+  void ReadFeatureScalar(const tpJsonStream& json, const std::string& text,
+                         bool isString);
+  void ProcessFeature(const Feature& feature);
+  void FinishEntry();
+  void FinishFlatEntry();
+  void CompareWithWxJson();
+  wxString ThroughputText() const;
+
+  tpSignalKNotesManager* m_manager;
+  wxString m_resourceSetName;
+  const std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
+      m_configuredSubs;
+  tpResourceSetResult& m_out;
+  tpJsonStream m_json;
+
+  bool m_anyEnabled = false;
+  bool m_inEntry = false;
+  Entry m_entry;
+  Feature m_feature;
+  size_t m_featureLevel = 0;  // stack level of the feature read, 0: none
+
+  // Durchsatz fürs Debug-Log
+  size_t m_bytes = 0;
+  wxLongLong m_parseMicros = 0;
+  // Nur im Debug-Modus und nur beim ersten Resourceset des Prozesses: der
+  // Body, für den Vergleich mit wxJSONReader
+  bool m_compareWxJson = false;
+  std::string m_body;
+  wxLongLong m_wxJsonMicros = 0;
+
+  // Both layouts are collected, Finish() keeps the one the document has and
+  // hands it over as a tpNoteBatch
+  std::vector<SignalKNote> m_notes;
+  std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>
+      m_discoveredSubs;
+  int m_invalidSubs = 0;
+  bool m_flat = false;
+  std::vector<SignalKNote> m_flatNotes;
+  // Descriptions of the notes of both layouts, compressed while parsing
+  tpDescriptionStore m_descriptions;
+};
+
+#endif  // _TPNOTESPARSER_H_
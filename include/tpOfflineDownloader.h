@@ -0,0 +1,61 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Background download of offline regions
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPOFFLINEDOWNLOADER_H_
+#define _TPOFFLINEDOWNLOADER_H_
+
+#include "tpSignalKNotes.h"
+#include "tpHttpClient.h"
+
+#include <wx/thread.h>
+#include <vector>
+
+class tpOfflineStore;
+
+// Works through the items of an offline download job (see tpOfflineStore)
+// a few at a time and pauses between the batches, so the download does not
+// crowd out the live fetches on a slow marina connection. Items that fail
+// stay in the job and are tried again when the download is resumed.
+class tpOfflineDownloader : public wxThread {
+public:
+  static const size_t BATCH_SIZE = 4;
+  static const long PAUSE_MS = 500;
+
+  tpOfflineDownloader(tpSignalKNotesManager* manager, tpOfflineStore* store,
+                      const tpServerEndpoint& server,
+                      const wxString& authToken,
+                      const std::vector<wxString>& items);
+
+  void RequestStop();
+  void GetProgress(tpOfflineStatus& status);
+
+protected:
+  ExitCode Entry() override;
+
+private:
+  bool IsStopRequested();
+
+  tpSignalKNotesManager* m_manager;
+  tpOfflineStore* m_store;
+  tpServerEndpoint m_server;
+  wxString m_authToken;
+  std::vector<wxString> m_items;
+  tpHttpClient m_http;  // only used from Entry()
+
+  wxMutex m_mutex;  // protects the members below
+  wxCondition m_cond;
+  bool m_stopRequested = false;
+  bool m_running = true;
+  size_t m_done = 0;
+  size_t m_failed = 0;
+};
+
+#endif  // _TPOFFLINEDOWNLOADER_H_
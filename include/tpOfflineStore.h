@@ -0,0 +1,81 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   On-disk store for offline regions
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPOFFLINESTORE_H_
+#define _TPOFFLINESTORE_H_
+
+#include <wx/string.h>
+#include <wx/thread.h>
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Notes and resourcesets downloaded ahead for use without a server
+// connection. The server's answers are kept unparsed as files below the
+// store directory: notes lists per tile at ZOOM (one file per quadkey),
+// resourcesets whole. The download job itself is kept there too, so an
+// interrupted download can be resumed after a restart. Thread safe: written
+// by the download thread, read by the fetch workers and the UI.
+class tpOfflineStore {
+public:
+  // Tiles of about 11 x 11 km at 54° N, small enough for one notes query
+  static const int ZOOM = 11;
+  // Refuse regions larger than this, roughly 800 x 800 km
+  static const size_t MAX_REGION_TILES = 5000;
+
+  explicit tpOfflineStore(const wxString& directory);
+
+  // Tiles at ZOOM covering a box or a corridor (meters each side) along a
+  // route given as (lat, lon) points
+  static void TilesForArea(double latMin, double latMax, double lonMin,
+                           double lonMax, std::set<wxString>& tiles);
+  static void TilesForRoute(
+      const std::vector<std::pair<double, double>>& points, double corridor,
+      std::set<wxString>& tiles);
+
+  bool SaveTile(const wxString& quadKey, const std::string& body);
+  bool LoadTile(const wxString& quadKey, std::string& body);
+  // Stored tiles with notes of quadKey: its ancestor at ZOOM, or all its
+  // stored descendants
+  std::vector<wxString> FindTiles(const wxString& quadKey);
+
+  bool SaveResourceSet(const wxString& name, const std::string& body);
+  bool LoadResourceSet(const wxString& name, std::string& body);
+
+  // Download job: items are "tile:<quadkey>" or "rs:<name>"
+  bool SaveJob(const std::vector<wxString>& items);
+  // Items of the stored job not marked done yet; false without a job
+  bool LoadJob(std::vector<wxString>& pending);
+  void MarkDone(const wxString& item);
+  void FinishJob();
+  bool HasJob();
+
+  size_t GetTileCount();
+  size_t GetResourceSetCount();
+  long long GetSizeBytes();
+  void Clear();
+
+private:
+  wxString TilePath(const wxString& quadKey) const;
+  wxString ResourceSetPath(const wxString& name) const;
+  bool WriteFile(const wxString& path, const std::string& data);
+  void Scan();
+
+  wxString m_dir;              // with trailing separator
+  wxMutex m_mutex;             // protects the members below and the files
+  std::set<wxString> m_tiles;  // quadkeys on disk
+  std::set<wxString> m_resourceSets;
+  long long m_sizeBytes = 0;
+};
+
+#endif  // _TPOFFLINESTORE_H_
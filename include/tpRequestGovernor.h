@@ -0,0 +1,81 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Admission control for requests to the SignalK server
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPREQUESTGOVERNOR_H_
+#define _TPREQUESTGOVERNOR_H_
+
+#include <wx/longlong.h>
+#include <wx/string.h>
+#include <wx/thread.h>
+#include <map>
+
+class signalk_notes_opencpn_pi;
+
+// Sits in front of every request tpHttpClient sends and protects both sides:
+//  - a circuit breaker per endpoint fails requests fast while the endpoint is
+//    down, instead of letting each one wait out its timeout. It opens after
+//    repeated failures, stays open for an exponentially growing, jittered
+//    backoff and then lets a single probe through (half-open).
+//  - a token bucket caps the request rate towards the server, so bursts from
+//    panning on several canvases are spread out instead of hitting the server
+//    at once.
+//  - the timeout of each endpoint follows its observed latency (smoothed
+//    round trip time plus four times its deviation, as TCP does).
+// Shared by all clients, so all methods are thread safe.
+class tpRequestGovernor {
+public:
+  tpRequestGovernor(signalk_notes_opencpn_pi* plugin);
+
+  // Endpoint key of a URL: server plus resource path without ids and query
+  static wxString EndpointOf(const wxString& url);
+
+  // false if the circuit of the endpoint is open; *timeoutSecs receives the
+  // adaptive timeout to use otherwise
+  bool Admit(const wxString& endpoint, long* timeoutSecs);
+  // Takes count tokens from the bucket; returns how many milliseconds the
+  // caller has to wait before sending
+  long Reserve(int count);
+  // latencyMs: until the answer started to arrive, not the whole transfer,
+  // so a large body does not stretch the timeout
+  void Report(const wxString& endpoint, bool success, long latencyMs);
+  // For admitted requests that were cancelled before they got an answer
+  void Release(const wxString& endpoint);
+
+  // Writes the state of all endpoints to the debug log (rate limited)
+  void LogState(bool force = false);
+
+private:
+  enum CircuitState { CLOSED, OPEN, HALF_OPEN };
+
+  struct Endpoint {
+    CircuitState state = CLOSED;
+    int failures = 0;            // consecutive failures
+    wxLongLong openUntil = 0;    // while OPEN
+    bool probeInFlight = false;  // while HALF_OPEN
+    double srttMs = 0.0;         // smoothed latency, 0 = no sample yet
+    double rttvarMs = 0.0;
+    long timeoutSecs = 10;
+  };
+
+  long BackoffMs(int failures);
+  void Refill(wxLongLong now);
+  static const char* StateName(CircuitState state);
+
+  signalk_notes_opencpn_pi* m_plugin;
+
+  wxMutex m_mutex;  // protects everything below
+  std::map<wxString, Endpoint> m_endpoints;
+  double m_tokens;
+  wxLongLong m_lastRefill;
+  wxLongLong m_lastStateLog = 0;
+};
+
+#endif  // _TPREQUESTGOVERNOR_H_
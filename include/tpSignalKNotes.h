@@ -23,63 +23,390 @@
 #include <wx/sstream.h>
 #include <wx/jsonval.h>
 #include <wx/filename.h>
+#include <wx/thread.h>
 #include <vector>
 #include <map>
 #include <wx/string.h>
 #include <set>
+#include <memory>
 
-// Forward declaration
-class signalk_notes_opencpn_pi;
+#include "signalk_notes_opencpn_pi.h"
+#include "tpHttpClient.h"
+#include "tpRequestGovernor.h"
+#include "tpStringPool.h"
 
+// Forward declaration
+class tpFetchWorker;
+class tpSignalKStream;
+class tpNotesListParser;
+class tpResourceSetParser;
+class tpTileCache;
+class tpNoteDetailsCache;
+class tpNoteBatch;
+struct tpNoteSnapshot;
+class tpOfflineStore;
+class tpOfflineDownloader;
+class tpWarmStartFile;
+
+// One note. Texts are stored as UTF-8, values that many notes share (icon,
+// source, server) as tpStringPool handles. Both become wxString only when
+// read, i.e. at the UI boundary.
 class SignalKNote {
 public:
-  wxString id;
-  wxString name;
-  wxString description;
   double latitude;
   double longitude;
-  wxString iconName;
-  wxString url;
-  wxString source;
-  wxString GUID;
   bool isDisplayed;
 
   SignalKNote() : latitude(0.0), longitude(0.0), isDisplayed(false) {}
+
+  wxString GetId() const { return tpStringPool::FromUtf8(m_id); }
+  void SetId(const wxString& id) { m_id = tpStringPool::ToUtf8(id); }
+  const std::string& GetIdUtf8() const { return m_id; }
+  void SetIdUtf8(const std::string& id) { m_id = id; }
+  wxString GetName() const { return tpStringPool::FromUtf8(m_name); }
+  void SetName(const wxString& name) { m_name = tpStringPool::ToUtf8(name); }
+  const std::string& GetNameUtf8() const { return m_name; }
+  void SetNameUtf8(const std::string& name) { m_name = name; }
+  bool HasName() const { return !m_name.empty(); }
+  wxString GetDescription() const {
+    return tpStringPool::FromUtf8(m_description);
+  }
+  void SetDescription(const wxString& description) {
+    m_description = tpStringPool::ToUtf8(description);
+  }
+  const std::string& GetDescriptionUtf8() const { return m_description; }
+  void SetDescriptionUtf8(const std::string& description) {
+    m_description = description;
+  }
+  bool HasDescription() const {
+    return !m_description.empty() || m_descriptionRef != 0;
+  }
+  // Description kept compressed in the tpDescriptionStore of the note's
+  // tpNoteBatch instead of the note itself; read via the batch
+  uint32_t GetDescriptionRef() const { return m_descriptionRef; }
+  void SetDescriptionRef(uint32_t ref) { m_descriptionRef = ref; }
+  wxString GetUrl() const { return tpStringPool::FromUtf8(m_url); }
+  void SetUrl(const wxString& url) { m_url = tpStringPool::ToUtf8(url); }
+  const std::string& GetUrlUtf8() const { return m_url; }
+  void SetUrlUtf8(const std::string& url) { m_url = url; }
+
+  const wxString& GetIconName() const { return tpStringPool::Get(m_iconName); }
+  void SetIconName(const wxString& iconName) {
+    m_iconName = tpStringPool::Intern(iconName);
+  }
+  const wxString& GetSource() const { return tpStringPool::Get(m_source); }
+  void SetSource(const wxString& source) {
+    m_source = tpStringPool::Intern(source);
+  }
+  // tpServerEndpoint::GetId() of the server it came from
+  const wxString& GetServer() const { return tpStringPool::Get(m_server); }
+  void SetServer(const wxString& server) {
+    m_server = tpStringPool::Intern(server);
+  }
+
+  // Hash of the note as the server delivered it, set by the parser once
+  // all fields are read. Details loaded later leave it alone, so a refetch
+  // only counts as a change if the server's data changed.
+  uint64_t GetContentHash() const { return m_contentHash; }
+  // extra: tpHashBytes() of content not kept in the note itself, e.g. a
+  // description that went into a tpDescriptionStore
+  void UpdateContentHash(uint64_t extra = 0);
+  // Hash read back from the warm start file (see tpWarmStartFile)
+  void SetContentHash(uint64_t hash) { m_contentHash = hash; }
+  // Bytes and heap blocks held by this note, and what the same texts take
+  // as wxString members (for the memory statistics in the debug log)
+  size_t GetMemoryUsage() const;
+  size_t GetAllocations() const;
+  size_t GetWideMemoryUsage() const;
+
+private:
+  std::string m_id;
+  std::string m_name;
+  std::string m_description;
+  std::string m_url;
+  tpStringId m_iconName = 0;
+  tpStringId m_source = 0;
+  tpStringId m_server = 0;
+  uint32_t m_descriptionRef = 0;
+  uint64_t m_contentHash = 0;
+};
+
+// 64-bit FNV-1a; pass the previous result as hash to chain several fields
+inline uint64_t tpHashBytes(const void* data, size_t size,
+                            uint64_t hash = 14695981039346656037ULL) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// SignalK server notes are fetched from
+struct tpServerEndpoint {
+  wxString host;
+  int port = 0;
+
+  wxString GetId() const { return wxString::Format("%s:%d", host, port); }
+};
+
+// One notes tile to fetch (see tpTileCache). revalidate is set when the cache
+// still holds data for the tile, so an unchanged tile comes back as 304.
+struct tpTileFetch {
+  wxString quadKey;
+  bool revalidate = false;
+};
+
+// Viewport driven fetch, built on the UI thread and executed by the
+// background fetch worker. Everything the worker needs is copied in here so
+// it never has to touch manager or canvas state.
+struct tpFetchRequest {
+  int canvasIndex = 0;
+  size_t serverIndex = 0;  // 0: primary server
+  double centerLat = 0.0;
+  double centerLon = 0.0;
+  double maxDistance = 0.0;
+  wxString serverHost;
+  int serverPort = 0;
+  wxString authToken;
+  unsigned long fetchSession = 0;  // CanvasState::fetchSession
+  // Increases with every requested viewport, across all canvases
+  unsigned long viewportGeneration = 0;
+  // Look-ahead fetch for where the viewport is heading: notes tiles only,
+  // stored in the tile cache until the viewport gets there
+  bool prefetch = false;
+  bool fetchNotesList = true;
+  // Notes tiles missing from the server's tile cache, one request each
+  std::vector<tpTileFetch> tiles;
+  // Notes whose details are loaded ahead of a click
+  std::vector<wxString> detailIds;
+  bool fetchResourceSets = false;
+  std::map<wxString, signalk_notes_opencpn_pi::ResourceSetConfig> resourceSets;
+};
+
+struct tpResourceSetResult {
+  bool ok = false;
+  bool unchanged = false;  // same data as last time, nothing parsed
+  bool flat = false;       // UUID -> note instead of values.features
+  std::shared_ptr<const tpNoteBatch> notes;  // null: nothing parsed
+  std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>
+      discoveredSubs;
+};
+
+// Last parsed state of a resourceset, shared by all canvases and the
+// sub-resourceset discovery of the config dialog
+struct tpResourceSetSnapshot {
+  wxString configKey;        // enabled sub-resourcesets it was parsed with
+  wxLongLong dataTime = 0;   // when the data was parsed
+  wxLongLong checkTime = 0;  // when the server last confirmed it
+  // Read from the warm start file: shown, but fetched as if never loaded
+  bool restored = false;
+  tpResourceSetResult result;
+  // Circle around a canvas window, radius in meters
+  struct Area {
+    double lat = 0.0;
+    double lon = 0.0;
+    double radius = 0.0;
+  };
+  // A large set is held only around the canvas windows it was fetched for;
+  // a window outside these areas fetches it again. Empty: held in full.
+  std::vector<Area> kept;
+};
+
+struct tpTileResult {
+  // -3: aborted for a newer viewport, -1: failed, >= 0: number of notes
+  int status = -1;
+  bool unchanged = false;  // same data as in the cache, nothing parsed
+  bool offline = false;    // server unreachable, read from the offline store
+  std::map<wxString, SignalKNote> notes;
+};
+
+// Progress of the offline download and contents of the store
+struct tpOfflineStatus {
+  bool running = false;
+  size_t total = 0;  // items of the running or last download
+  size_t done = 0;
+  size_t failed = 0;
+  bool unfinished = false;  // a stored job is left to resume
+  size_t tiles = 0;         // notes tiles in the store
+  size_t resourceSets = 0;
+  long long sizeBytes = 0;
+};
+
+// Server requests of the config dialog, prepared on the UI thread
+struct tpConfigLoadJob {
+  tpServerEndpoint server;
+  wxString authToken;
+  // Fetched for their sub-resourcesets, with the config they are parsed with
+  std::map<wxString, signalk_notes_opencpn_pi::ResourceSetConfig> resourceSets;
+  // Configured resourcesets; others in the server's list are fetched as well
+  std::set<wxString> knownResourceSets;
+};
+
+// One answer for the config dialog, handed over as soon as it arrives
+struct tpConfigLoadResult {
+  enum Kind { PLUGINS, RESOURCE_SET_LIST, RESOURCE_SET, FINISHED };
+  Kind kind = FINISHED;
+  bool ok = false;
+  wxString body;                    // PLUGINS: the /plugins/ list
+  std::set<wxString> resourceSets;  // RESOURCE_SET_LIST
+  wxString resourceSetName;         // RESOURCE_SET
+  signalk_notes_opencpn_pi::ResourceSetConfig config;
+  bool fromSnapshot = false;  // taken from a current snapshot, not fetched
+  tpResourceSetResult rsResult;
+};
+
+// Parsed notes of one fetch, applied to the canvas state on the UI thread
+struct tpFetchResult {
+  int canvasIndex = 0;
+  size_t serverIndex = 0;  // tpFetchRequest::serverIndex
+  bool prefetch = false;  // tpFetchRequest::prefetch
+  // -2: no host, otherwise see tiles
+  int notesStatus = 0;
+  std::map<wxString, tpTileResult> tiles;  // by quadkey
+  std::map<wxString, SignalKNote> details;  // by note id
+  std::set<wxString> detailsFailed;
+  std::set<wxString> providers;
+  std::set<wxString> icons;
+  bool resourceSetsFetched = false;
+  std::map<wxString, tpResourceSetResult> resourceSets;
+};
+
+// One created/updated/deleted resource from the SignalK delta stream
+struct tpStreamDelta {
+  wxString resourceType;  // "notes" or the resourceset name
+  wxString id;
+  bool deleted = false;
+  SignalKNote note;  // parsed note, only for resourceType "notes"
 };
 
 class tpSignalKNotesManager {
 public:
   tpSignalKNotesManager(signalk_notes_opencpn_pi* parent);
-  ~tpSignalKNotesManager() = default;  // Default-Destruktor
+  ~tpSignalKNotesManager();
+
+  signalk_notes_opencpn_pi* GetPlugin() const { return m_parent; }
+  // Shared by the UI thread client and the fetch worker
+  tpRequestGovernor* GetGovernor() { return &m_governor; }
 
-  // Server settings
+  // Server settings. The primary server is used for everything; notes are
+  // also fetched from the additional servers and merged by note id, where
+  // the primary server wins. Set before StartFetchWorker().
   wxString GetServerHost() const { return m_serverHost; }
   int GetServerPort() const { return m_serverPort; }
   void SetServerDetails(const wxString& host, int port);
+  void SetAdditionalServers(const std::vector<tpServerEndpoint>& servers) {
+    m_extraServers = servers;
+  }
+  size_t GetServerCount() const { return 1 + m_extraServers.size(); }
 
   // Notes
   void UpdateDisplayedIcons(double centerLat, double centerLon,
-                            double maxDistance,
-                            signalk_notes_opencpn_pi::CanvasState& state);
-
-  SignalKNote* GetNoteByGUID(signalk_notes_opencpn_pi::CanvasState& state,
-                             const wxString& guid);
-  void GetVisibleNotes(signalk_notes_opencpn_pi::CanvasState& state,
-                       std::vector<const SignalKNote*>& outNotes);
+                            double maxDistance, int canvasIndex);
+  // Posts a resourceset-only fetch for sets that are due, but only while the
+  // fetch worker is idle. Cheap enough to be called on every render.
+  void ScheduleResourceSets(int canvasIndex);
+  // A canvas holds only the resourceset notes of a window around its
+  // viewport. Moves the window once the viewport leaves it.
+  void UpdateResourceSetWindow(int canvasIndex, double centerLat,
+                               double centerLon, double maxDistance);
+  // Poll interval of the notes list in minutes: the shortest interval of the
+  // enabled providers
+  int GetNotesRefreshInterval() const;
+  // Posts a low priority prefetch of the tiles one query radius ahead in pan
+  // direction, or along the ownship's COG while the chart is at rest and
+  // shows the ownship. Only while the fetch worker is idle; any newer
+  // viewport aborts it.
+  void SchedulePrefetch(int canvasIndex);
+  // Posts a low priority fetch of the details of notes in the canvas'
+  // clusters that the list left without name or description, nearest to the
+  // screen center first. Only while the fetch worker is idle.
+  void ScheduleDetailsPrefetch(int canvasIndex);
+  // true if the area needs other notes tiles than the canvas shows
+  bool TileRangeChanged(int canvasIndex, double centerLat, double centerLon,
+                        double maxDistance) const;
+
+  // Background fetching, one worker per server so a slow or dead server
+  // does not hold up the others
+  void StartFetchWorker();
+  void StopFetchWorker();
+  // Notes of the last session (see tpWarmStartFile), read after the config
+  // at Init and written at DeInit
+  void LoadWarmStart();
+  void SaveWarmStart();
+  size_t GetWarmStartNoteCount() const { return m_warmStartNotes; }
+  // Called on the worker thread. isSuperseded tells whether a newer viewport
+  // has been requested for the canvas; notes tiles still loading are then
+  // aborted, finished ones are kept for the cache.
+  void ExecuteFetch(tpHttpClient& http, const tpFetchRequest& request,
+                    tpFetchResult& result,
+                    const std::function<bool()>& isSuperseded =
+                        std::function<bool()>());
+  void PublishFetchResult(tpFetchResult& result);
+  // Called on the UI thread
+  void ApplyPendingFetchResults();
+
+  // Offline regions: the notes tiles (tpOfflineStore::ZOOM) and all enabled
+  // resourcesets are downloaded from the primary server in the background.
+  // Fetches that fail fall back to them.
+  bool StartOfflineDownload(const std::set<wxString>& tiles);
+  bool ResumeOfflineDownload();
+  void StopOfflineDownload();
+  void ClearOfflineStore();
+  void GetOfflineStatus(tpOfflineStatus& status);
+  // Called on the download thread; returns the number of items stored
+  size_t DownloadOfflineItems(tpHttpClient& http,
+                              const tpServerEndpoint& server,
+                              const wxString& authToken,
+                              const std::vector<wxString>& items,
+                              tpOfflineStore& store,
+                              const std::function<bool()>& isCancelled);
+
+  // Push updates from the SignalK delta stream
+  void StartStream();
+  void StopStream();
+  // true while the stream is connected; interval polling is suspended then
+  bool IsStreaming() const { return m_streamConnected; }
+  // Called on the stream thread
+  void ParseNoteValue(const wxString& noteId, wxJSONValue& noteData,
+                      SignalKNote& note);
+  void PublishStreamDeltas(std::vector<tpStreamDelta>& deltas);
+  void PublishStreamState(bool connected);
+  // Called on the UI thread
+  void ApplyPendingStreamUpdates();
+
+  // Notes as the render path sees them, taken without a lock. Pointers
+  // into the snapshot stay valid while it is held.
+  std::shared_ptr<const tpNoteSnapshot> GetNoteSnapshot() const {
+    return std::atomic_load(&m_noteSnapshot);
+  }
+  // Tile or resourceset note from the current snapshot, which the returned
+  // pointer keeps alive
+  std::shared_ptr<const SignalKNote> GetNoteByGUID(const wxString& guid) const;
+  void GetVisibleNotes(const tpNoteSnapshot& snapshot, int canvasIndex,
+                       std::vector<const SignalKNote*>& outNotes) const;
+  // Canvas closed: forgets which notes it showed. The fetched data stays
+  // for the other canvases and a reopened one.
+  void ReleaseCanvas(int canvasIndex);
   bool GetIconBitmapForNote(const SignalKNote& note, wxBitmap& bmp, bool forGL);
 
-  void OnIconClick(const wxString& guid,
-                   signalk_notes_opencpn_pi::CanvasState& state,
-                   int canvasIndex);
+  void OnIconClick(const wxString& guid, int canvasIndex);
   void InvalidateIconCache(const wxString& iconName);
 
   // Provider & Icon mappings
   void SetProviderSettings(const std::map<wxString, bool>& settings);
   void SetIconMappings(const std::map<wxString, wxString>& mappings);
+  // providerId -> minutes, missing or 0: global fetch interval
+  void SetProviderIntervals(const std::map<wxString, int>& intervals) {
+    m_providerIntervals = intervals;
+  }
 
   std::map<wxString, bool> GetProviderSettings() const {
     return m_providerSettings;
   }
+  std::map<wxString, int> GetProviderIntervals() const {
+    return m_providerIntervals;
+  }
   std::map<wxString, wxString> GetIconMappings() const {
     return m_iconMappings;
   }
@@ -129,43 +456,120 @@ public:
   }
   // Resourceset-Unterstützung
   bool FetchAvailableResourceSets(std::set<wxString>& outResourceSets);
-  bool FetchResourceSet(
-      const wxString& resourceSetName,
-      std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
-          subConfigs,
-      signalk_notes_opencpn_pi::CanvasState& state,
-      const std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
-          configuredSubs);
-  bool DiscoverSubResourceSets(
-      const wxString& resourceSetName,
-      std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
-          outSubs);
-  // private:
-  int ParseFlatResourceSetJSON(
-      const wxString& json, const wxString& resourceSetName,
-      signalk_notes_opencpn_pi::CanvasState& state,
-      const signalk_notes_opencpn_pi::SubResourceSetConfig& config);
+  // The body was streamed into parser while it arrived
+  bool ProcessResourceSetResponse(const wxString& resourceSetName,
+                                  const tpHttpRequest& response,
+                                  tpResourceSetParser& parser,
+                                  tpResourceSetResult& out);
+
+  // Config dialog: the job is prepared on the UI thread, resourcesets with a
+  // current snapshot are reported in cached right away. LoadConfigData runs
+  // on a tpConfigLoader thread, sends all other requests at once and hands
+  // every answer to onResult as it arrives; ApplyConfigLoadResult takes it
+  // over on the UI thread.
+  void InitConfigLoadJob(tpConfigLoadJob& job,
+                         std::vector<tpConfigLoadResult>& cached);
+  void LoadConfigData(
+      tpHttpClient& http, const tpConfigLoadJob& job,
+      const std::function<bool()>& isCancelled,
+      const std::function<void(tpConfigLoadResult&)>& onResult);
+  void ApplyConfigLoadResult(tpConfigLoadResult& result);
 
 private:
   signalk_notes_opencpn_pi* m_parent = nullptr;
 
-  int FetchNotesListForCanvas(double centerLat, double centerLon,
-                              double maxDistance,
-                              signalk_notes_opencpn_pi::CanvasState& state);
+  int ProcessNotesListResponse(const tpFetchRequest& request,
+                               const tpHttpRequest& response,
+                               tpNotesListParser& parser,
+                               tpTileResult& result);
   bool FetchNoteDetails(const wxString& noteId, SignalKNote& note);
+  bool ParseInstalledPlugins(const wxString& response,
+                             std::map<wxString, bool>& plugins);
+  void RemoveDisabledProviders(
+      const std::map<wxString, bool>& installedPlugins);
+  bool ParseResourceSetList(const wxString& json,
+                            std::set<wxString>& outResourceSets) const;
+  // From the details cache, otherwise fetched right away
+  bool LoadNoteDetails(SignalKNote& note);
 
   wxString ResolveIconPath(const wxString& skIconName);
   bool DownloadIcon(const wxString& iconName, wxBitmap& bitmap);
   bool CreateNoteIcon(SignalKNote& note);
   bool DeleteNoteIcon(const wxString& guid);
 
-  int ParseNotesListJSON(const wxString& json,
-                         signalk_notes_opencpn_pi::CanvasState& state);
+  // Makes newNotes the notes the canvas shows; returns the changes
+  int ApplyNotesList(int canvasIndex,
+                     std::map<wxString, SignalKNote>& newNotes);
+  // Canvases given as SharedNote::canvases bits rebuild their clusters
+  void MarkNotesDirty(uint32_t canvases);
+  // true if the canvas' notes of the resourceset changed
+  bool ApplyResourceSetResult(
+      signalk_notes_opencpn_pi::CanvasState& state,
+      const wxString& resourceSetName, const tpResourceSetSnapshot& snapshot,
+      const std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
+          configuredSubs);
+  // Cuts a large freshly parsed set to the surroundings of all canvas
+  // windows; kept receives the areas, empty if the set stays whole
+  void TrimResourceSet(const wxString& resourceSetName,
+                       tpResourceSetResult& result,
+                       std::vector<tpResourceSetSnapshot::Area>& kept) const;
+  // Notes of batch in the canvas' resourceset window
+  void CollectResourceSetWindow(
+      const signalk_notes_opencpn_pi::CanvasState& state,
+      const tpNoteBatch& batch, std::vector<const SignalKNote*>& out) const;
+  // Refresh interval of a resourceset in milliseconds
+  long GetResourceSetRefreshMs(
+      const signalk_notes_opencpn_pi::ResourceSetConfig& config) const;
+  // Snapshot still current for config: same sub-resourcesets and checked
+  // within the refresh interval
+  const tpResourceSetSnapshot* FindResourceSetSnapshot(
+      const wxString& resourceSetName,
+      const signalk_notes_opencpn_pi::ResourceSetConfig& config,
+      wxLongLong now) const;
+  void StoreResourceSetSnapshot(
+      const wxString& resourceSetName,
+      const signalk_notes_opencpn_pi::ResourceSetConfig& config,
+      tpResourceSetResult& result, wxLongLong now);
+  // Applies snapshots newer than what the canvas shows; returns their count
+  int TakeResourceSetSnapshots(signalk_notes_opencpn_pi::CanvasState& state);
+  void ApplyFetchResult(tpFetchResult& result);
+  bool InitFetchRequest(int canvasIndex, tpFetchRequest& request,
+                        size_t serverIndex = 0);
+  tpServerEndpoint GetServer(size_t serverIndex) const;
+  // Index of the server with the given id, 0 if unknown
+  size_t FindServer(const wxString& serverId) const;
+  tpFetchWorker* GetFetchWorker(size_t serverIndex) const;
+  // Tile cache of a server, shared by all canvases
+  tpTileCache& GetTileCache(size_t serverIndex);
+  // Merged notes of all servers' tiles in the canvas' range
+  void ShowCachedNotes(int canvasIndex);
+  int CollectDueResourceSets(
+      signalk_notes_opencpn_pi::CanvasState& state, bool withViewport,
+      bool linkIdle,
+      std::map<wxString, signalk_notes_opencpn_pi::ResourceSetConfig>& out);
+  bool UpdateNoteDisplayFlags();
+  // Provider setting of the note's source; unknown sources are shown
+  bool IsProviderEnabled(const SignalKNote& note) const;
+  // Builds the next tpNoteSnapshot from m_notes and the canvases'
+  // resourceset windows and swaps it in, if any of them changed
+  void PublishNotes();
+  // Returns the SharedNote::canvases bits of the canvases it changed
+  uint32_t ApplyNoteDelta(const tpStreamDelta& delta);
   bool ParseNoteDetailsJSON(const wxString& json, SignalKNote& note);
+  // Worker thread fallbacks when the server cannot be reached
+  bool LoadOfflineTile(const wxString& quadKey, tpFetchResult& result,
+                       tpTileResult& tileResult);
+  bool LoadOfflineResourceSet(
+      const wxString& resourceSetName,
+      const std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
+          configuredSubs,
+      tpResourceSetResult& out);
+  bool StartOfflineDownloader(const std::vector<wxString>& items);
 
   // Server data
   wxString m_serverHost;
   int m_serverPort;
+  std::vector<tpServerEndpoint> m_extraServers;
 
   // Authentication data
 
@@ -175,13 +579,66 @@ private:
   wxDateTime m_authRequestTime;
   wxDateTime m_authTokenReceivedTime;
 
-  // Notes
-  std::map<wxString, SignalKNote> m_notes;
+  // Admission control for all requests to the server
+  tpRequestGovernor m_governor;
+  // HTTP client for requests made on the UI thread
+  tpHttpClient m_http;
+
+  // Background fetch worker and the results it handed back
+  tpFetchWorker* m_fetchWorker = nullptr;
+  std::vector<tpFetchWorker*> m_extraWorkers;  // by m_extraServers index
+  unsigned long m_lastFetchSession = 0;
+  unsigned long m_lastViewportGeneration = 0;
+  // Notes tiles by server index, only used on the UI thread
+  std::map<size_t, std::unique_ptr<tpTileCache>> m_tileCaches;
+  // Note details loaded in the background, and notes they failed for
+  std::unique_ptr<tpNoteDetailsCache> m_detailsCache;
+  std::set<wxString> m_detailsFailed;
+  // Every resourceset is fetched and parsed once per refresh, whichever
+  // canvas or dialog asks first; the others take the snapshot
+  std::map<wxString, tpResourceSetSnapshot> m_rsSnapshots;
+  std::map<wxString, wxLongLong> m_rsInFlight;  // by name: request time
+  // Failed resourcesets by name: when to try again, before their interval
+  std::map<wxString, wxLongLong> m_rsRetryTimes;
+  std::unique_ptr<tpOfflineStore> m_offlineStore;
+  std::unique_ptr<tpWarmStartFile> m_warmStartFile;
+  // Notes tiles of the last session by server id and quadkey. Every new
+  // tile cache of a server starts with them until the server answered.
+  std::map<wxString, std::map<wxString, std::map<wxString, SignalKNote>>>
+      m_warmTiles;
+  size_t m_warmStartNotes = 0;
+  tpOfflineDownloader* m_offlineDownloader = nullptr;
+  wxMutex m_fetchResultsMutex;
+  std::vector<tpFetchResult> m_fetchResults;
+  wxEvtHandler m_uiNotifier;  // marshals finished fetches to the UI thread
+
+  // Delta stream and the updates it handed back
+  tpSignalKStream* m_stream = nullptr;
+  bool m_streamConnected = false;
+  wxMutex m_streamMutex;  // protects the members below
+  std::vector<tpStreamDelta> m_streamDeltas;
+  int m_pendingStreamState = -1;  // -1: unchanged, 0/1: (dis)connected
+  bool m_streamReconnected = false;
+
+  // Notes of the tiles all canvases show, each held once. A note nobody
+  // shows any more is dropped; its tile stays in the cache. Only used on the
+  // UI thread; a changed note is replaced, never modified, since published
+  // snapshots share it.
+  struct SharedNote {
+    std::shared_ptr<const SignalKNote> note;
+    uint32_t canvases = 0;  // bit per canvas index showing it
+  };
+  std::map<wxString, SharedNote> m_notes;
+  // Set by everything that changes m_notes or a canvas' resourceset window
+  bool m_notesChanged = false;
+  unsigned long m_notesVersion = 0;
+  std::shared_ptr<const tpNoteSnapshot> m_noteSnapshot;  // atomic access
   std::vector<wxString> m_displayedGUIDs;
 
   std::map<wxString, wxBitmap> m_iconCache;
 
   std::map<wxString, bool> m_providerSettings;
+  std::map<wxString, int> m_providerIntervals;
   std::map<wxString, wxString> m_iconMappings;  // iconName -> filePath
 
   std::set<wxString> m_discoveredProviders;
@@ -204,13 +661,5 @@ private:
   void RenderWithHtmlWindow(wxDialog* dlg, wxBoxSizer* sizer,
                             const wxString& htmlContent);
   wxString FixBrokenLinksInDescription(const wxString& html);
-  bool IsValidResourceSet(wxJSONValue rsJson);
-  int ParseResourceSetJSON(
-      const wxString& json, const wxString& resourceSetName,
-      signalk_notes_opencpn_pi::CanvasState& state,
-      const std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
-          configuredSubs,
-      std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
-          outDiscoveredSubs);
 };
 #endif  // _TPSIGNALKNOTES_H_
\ No newline at end of file
@@ -0,0 +1,62 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   SignalK WebSocket delta stream for push based note updates
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPSIGNALKSTREAM_H_
+#define _TPSIGNALKSTREAM_H_
+
+#include "tpSignalKNotes.h"
+
+#include <wx/socket.h>
+#include <wx/thread.h>
+#include <string>
+#include <vector>
+
+// Keeps a WebSocket connection to /signalk/v1/stream open and subscribes to
+// resources.notes.* and resources.<set>.* for the given resourcesets. Deltas
+// are handed to the manager, which applies them on the UI thread. When the
+// server is unreachable or drops the connection the stream reports itself
+// disconnected - the manager then keeps polling - and reconnects after a
+// pause.
+class tpSignalKStream : public wxThread {
+public:
+  tpSignalKStream(tpSignalKNotesManager* manager, const wxString& host,
+                  int port, const wxString& authToken,
+                  const std::vector<wxString>& resourceSets);
+
+  void RequestStop();
+
+protected:
+  ExitCode Entry() override;
+
+private:
+  bool Connect(wxSocketClient& socket);
+  bool SendFrame(wxSocketClient& socket, int opcode,
+                 const std::string& payload);
+  bool ReadFrame(wxSocketClient& socket, int& opcode, bool& fin,
+                 std::string& payload);
+  bool ReadExact(wxSocketClient& socket, void* buffer, size_t size);
+  bool RunSession(wxSocketClient& socket);
+  void HandleMessage(const std::string& text);
+  bool WaitForStop(int milliseconds);
+  bool IsStopRequested();
+
+  tpSignalKNotesManager* m_manager;
+  wxString m_host;
+  int m_port;
+  wxString m_authToken;
+  std::vector<wxString> m_resourceSets;
+
+  wxMutex m_mutex;  // protects m_stopRequested
+  wxCondition m_cond;
+  bool m_stopRequested = false;
+};
+
+#endif  // _TPSIGNALKSTREAM_H_
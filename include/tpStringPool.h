@@ -0,0 +1,39 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Intern table for strings shared by many notes
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPSTRINGPOOL_H_
+#define _TPSTRINGPOOL_H_
+
+#include <wx/string.h>
+#include <stdint.h>
+#include <string>
+
+// Handle of an interned string; 0 is the empty string
+typedef uint32_t tpStringId;
+
+// Values that thousands of notes repeat (icon name, source, server) are
+// stored once here and referenced by handle. The set of distinct values is
+// small, so entries are never released and a handle stays valid for the
+// lifetime of the plugin. Thread safe: notes are built on worker threads.
+class tpStringPool {
+public:
+  static tpStringId Intern(const wxString& value);
+  static const wxString& Get(tpStringId id);
+  static size_t GetCount();
+
+  // Per-note texts are kept as UTF-8 and converted at the UI boundary
+  static std::string ToUtf8(const wxString& text);
+  static wxString FromUtf8(const std::string& text) {
+    return wxString::FromUTF8(text.data(), text.size());
+  }
+};
+
+#endif  // _TPSTRINGPOOL_H_
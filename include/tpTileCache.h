@@ -0,0 +1,143 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Tile-keyed cache for the notes list
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPTILECACHE_H_
+#define _TPTILECACHE_H_
+
+#include "tpSignalKNotes.h"
+
+#include <wx/longlong.h>
+#include <map>
+#include <vector>
+
+// Block of Web Mercator tiles at one zoom level. x1 < x0 means the range
+// wraps around the antimeridian.
+struct tpTileRange {
+  int zoom = -1;
+  int x0 = 0;
+  int x1 = -1;
+  int y0 = 0;
+  int y1 = -1;
+
+  bool IsValid() const { return zoom >= 0; }
+  bool Contains(int x, int y) const {
+    if (!IsValid() || y < y0 || y > y1) return false;
+    return x0 <= x1 ? x >= x0 && x <= x1 : x >= x0 || x <= x1;
+  }
+  bool operator==(const tpTileRange& other) const {
+    return zoom == other.zoom && x0 == other.x0 && x1 == other.x1 &&
+           y0 == other.y0 && y1 == other.y1;
+  }
+  bool operator!=(const tpTileRange& other) const { return !(*this == other); }
+};
+
+// Notes of one server, split into fixed geographic tiles (Bing quadkeys).
+// The zoom level follows the query radius, so a viewport always spans a few
+// tiles. Every tile is fetched once and reused across pans and by all
+// canvases; after a zoom a tile counts as present if its parent or all four
+// of its children are. Tiles expire individually and are evicted least
+// recently used first. Only used on the UI thread.
+class tpTileCache {
+public:
+  static const int MIN_ZOOM = 2;
+  static const int MAX_ZOOM = 18;
+  static const size_t MAX_TILES = 256;
+
+  // Tiles covering the circle, at a zoom where a tile is about as wide as
+  // the radius
+  static tpTileRange RangeForArea(double lat, double lon, double radius);
+  static tpTileRange RangeAtZoom(double lat, double lon, double radius,
+                                 int zoom);
+  static void TileAt(double lat, double lon, int zoom, int& x, int& y);
+  static wxString QuadKey(int x, int y, int zoom);
+  static void TileBounds(const wxString& quadKey, double& latMin,
+                         double& latMax, double& lonMin, double& lonMax);
+  // Position/distance query that contains the whole tile
+  static void QueryCircle(const wxString& quadKey, double& lat, double& lon,
+                          double& radius);
+  // Drops notes outside the tile: the query circle overlaps the neighbours
+  static void ClipToTile(const wxString& quadKey,
+                         std::map<wxString, SignalKNote>& notes);
+
+  // Tiles of range without fresh data. maxAgeMs < 0: data never expires.
+  // With countStats, hits and misses are recorded for the statistics. Does
+  // not count as a use of the tiles.
+  void CollectMissing(const tpTileRange& range, wxLongLong now, long maxAgeMs,
+                      std::vector<tpTileFetch>& missing, bool countStats);
+  // Notes of all tiles in range, stale data included. For the range a
+  // canvas shows: the tiles read count as used, prefetched ones as shown.
+  void CollectNotes(const tpTileRange& range, wxLongLong now,
+                    std::map<wxString, SignalKNote>& notes);
+
+  void Store(const wxString& quadKey, std::map<wxString, SignalKNote>& notes,
+             wxLongLong now, bool prefetched);
+  // Server confirmed the data (304); ignored if the tile was evicted
+  void Touch(const wxString& quadKey, wxLongLong now);
+  // Data of the last session (see tpWarmStartFile): shown like an expired
+  // tile until fetched again
+  void Restore(const wxString& quadKey,
+               const std::map<wxString, SignalKNote>& notes);
+  // Calls f(quadKey, notes) for every tile held
+  template <typename F>
+  void ForEachStored(F f) const {
+    for (const auto& kv : m_tiles) f(kv.first, kv.second.notes);
+  }
+  // Keeps the data, but everything is fetched again on next use
+  void Expire();
+  void Clear();
+  // Created, updated (note != nullptr) or deleted note from the stream
+  void ApplyNoteDelta(const wxString& id, const SignalKNote* note);
+
+  // Range a canvas currently shows
+  const tpTileRange& GetRange(int canvasIndex) const;
+  void SetRange(int canvasIndex, const tpTileRange& range);
+  // Range of the canvas' last prefetch, not requested twice: false if it
+  // is the same
+  bool SetPrefetchRange(int canvasIndex, const tpTileRange& range);
+  // Canvas closed; its tiles stay for the others
+  void RemoveCanvas(int canvasIndex);
+
+  unsigned long GetHits() const { return m_hits; }
+  unsigned long GetMisses() const { return m_misses; }
+  size_t GetTileCount() const { return m_tiles.size(); }
+  unsigned long GetPrefetchedNotes() const { return m_prefetchedNotes; }
+  unsigned long GetPrefetchedShown() const { return m_prefetchedShown; }
+
+private:
+  struct Tile {
+    std::map<wxString, SignalKNote> notes;
+    wxLongLong fetchTime = 0;  // 0: expired
+    wxLongLong lastUsed = 0;
+    bool prefetched = false;   // stored by a prefetch, not used yet
+  };
+
+  template <typename F>
+  static void ForEachTile(const tpTileRange& range, F f);
+  bool IsFresh(const Tile& tile, wxLongLong now, long maxAgeMs) const;
+  bool HasFresh(const wxString& quadKey, wxLongLong now, long maxAgeMs) const;
+  void Use(Tile& tile, wxLongLong now);
+  void Evict();
+
+  struct CanvasRanges {
+    tpTileRange shown;
+    tpTileRange prefetch;
+  };
+
+  std::map<wxString, Tile> m_tiles;        // by quadkey
+  std::map<int, CanvasRanges> m_canvases;  // by canvas index
+
+  unsigned long m_hits = 0;
+  unsigned long m_misses = 0;
+  unsigned long m_prefetchedNotes = 0;
+  unsigned long m_prefetchedShown = 0;
+};
+
+#endif  // _TPTILECACHE_H_
@@ -0,0 +1,135 @@
+/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Notes of the last session for an instant start
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+#ifndef _TPWARMSTARTFILE_H_
+#define _TPWARMSTARTFILE_H_
+
+#include "tpSignalKNotes.h"
+
+#include <wx/longlong.h>
+#include <wx/string.h>
+
+#include <stdint.h>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+// Appends values in the byte order of this machine; the file is never
+// shared between machines
+class tpBinaryWriter {
+public:
+  explicit tpBinaryWriter(std::string& out) : m_out(out) {}
+
+  template <typename T>
+  void Put(T value) {
+    m_out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+  void PutString(const std::string& text) {
+    Put((uint32_t)text.size());
+    m_out += text;
+  }
+
+private:
+  std::string& m_out;
+};
+
+// Reads what tpBinaryWriter wrote. Past the end every read fails and
+// IsOk() turns false, so callers only check once at the end.
+class tpBinaryReader {
+public:
+  tpBinaryReader(const char* data, size_t size)
+      : m_pos(data), m_end(data + size) {}
+
+  template <typename T>
+  T Get() {
+    T value = T();
+    if (!Have(sizeof(T))) return value;
+    std::memcpy(&value, m_pos, sizeof(T));
+    m_pos += sizeof(T);
+    return value;
+  }
+  std::string GetString() {
+    uint32_t size = Get<uint32_t>();
+    if (!Have(size)) return std::string();
+    std::string text(m_pos, size);
+    m_pos += size;
+    return text;
+  }
+  // Element count that cannot exceed the bytes left, so a damaged file
+  // cannot make the caller reserve gigabytes
+  uint32_t GetCount(size_t minBytesEach) {
+    uint32_t count = Get<uint32_t>();
+    if (minBytesEach > 0 && count > (size_t)(m_end - m_pos) / minBytesEach)
+      m_ok = false;
+    return m_ok ? count : 0;
+  }
+  bool IsOk() const { return m_ok; }
+
+private:
+  bool Have(size_t size) {
+    if (m_ok && (size_t)(m_end - m_pos) >= size) return true;
+    m_ok = false;
+    return false;
+  }
+
+  const char* m_pos;
+  const char* m_end;
+  bool m_ok = true;
+};
+
+// Notes shown in the last session, written at DeInit and read at Init, so
+// the chart shows them on the first frame and, with the server unreachable,
+// at all. Holds the notes tiles of every server, the parsed resourcesets
+// with their still deflated descriptions, and the discovered providers and
+// icons. Values the notes share (icon, source, server) are written once
+// into a string table. Everything read counts as stale: the fetches run as
+// without it and replace the data as deltas.
+class tpWarmStartFile {
+public:
+  static const uint32_t VERSION = 1;
+
+  struct Tile {
+    wxString server;  // tpServerEndpoint::GetId()
+    wxString quadKey;
+    std::map<wxString, SignalKNote> notes;
+  };
+
+  struct ResourceSet {
+    wxString name;
+    wxString configKey;  // see tpResourceSetSnapshot
+    bool flat = false;
+    wxLongLong dataTime = 0;
+    std::shared_ptr<const tpNoteBatch> notes;
+  };
+
+  struct Contents {
+    wxString server;  // primary server the resourcesets came from
+    std::vector<Tile> tiles;
+    std::vector<ResourceSet> resourceSets;
+    std::set<wxString> providers;
+    std::set<wxString> icons;
+  };
+
+  explicit tpWarmStartFile(const wxString& path) : m_path(path) {}
+
+  bool Save(const Contents& contents);
+  // false if there is no file or it is damaged or of another version
+  bool Load(Contents& contents);
+  void Remove();
+
+private:
+  wxString m_path;
+};
+
+#endif  // _TPWARMSTARTFILE_H_
@@ -33,6 +33,7 @@
 #include "version.h"
 #include "signalk_notes_opencpn_pi.h"
 #include "tpSignalKNotes.h"
+#include "tpNoteSnapshot.h"
 #include "tpicons.h"
 #include "tpConfigDialog.h"
 
@@ -170,11 +171,17 @@ int signalk_notes_opencpn_pi::Init(void) {
   //             "Debug", wxOK);
   m_parent_window = GetOCPNCanvasWindow();
   m_pTPConfig = GetOCPNConfigObject();
+  m_initTime = wxGetLocalTimeMillis();
 
   if (!LoadConfig()) {
     return false;
   }
 
+  // Notes der letzten Sitzung, bevor der erste Abruf startet
+  m_pSignalKNotesManager->LoadWarmStart();
+  m_pSignalKNotesManager->StartFetchWorker();
+  if (m_streamUpdates) m_pSignalKNotesManager->StartStream();
+
 #ifdef PLUGIN_USE_SVG
   m_signalk_notes_opencpn_button_id = InsertPlugInToolSVG(
       _("SignalK Notes"), m_ptpicons->m_s_signalk_notes_opencpn_grey_pi,
@@ -192,7 +199,7 @@ int signalk_notes_opencpn_pi::Init(void) {
           INSTALLS_TOOLBOX_PAGE | WANTS_OVERLAY_CALLBACK |
           WANTS_OPENGL_OVERLAY_CALLBACK | WANTS_PLUGIN_MESSAGING |
           WANTS_LATE_INIT | WANTS_MOUSE_EVENTS | WANTS_KEYBOARD_EVENTS |
-          WANTS_ONPAINT_VIEWPORT | WANTS_PREFERENCES);
+          WANTS_ONPAINT_VIEWPORT | WANTS_PREFERENCES | WANTS_NMEA_EVENTS);
 }
 
 void signalk_notes_opencpn_pi::LateInit(void) {
@@ -200,6 +207,12 @@ void signalk_notes_opencpn_pi::LateInit(void) {
 }
 
 bool signalk_notes_opencpn_pi::DeInit(void) {
+  if (m_pSignalKNotesManager) {
+    m_pSignalKNotesManager->StopStream();
+    m_pSignalKNotesManager->StopFetchWorker();
+    m_pSignalKNotesManager->SaveWarmStart();
+  }
+
   if (m_pOverviewDialog) {
     m_pOverviewDialog->Destroy();
     m_pOverviewDialog = nullptr;
@@ -214,18 +227,6 @@ bool signalk_notes_opencpn_pi::DeInit(void) {
 // -----------------------------------------------------------------------------
 
 void signalk_notes_opencpn_pi::OnToolbarToolCallback(int id) {
-  if (!m_pSignalKNotesManager->GetAuthToken().IsEmpty()) {
-    if (!m_pSignalKNotesManager->ValidateToken()) {
-      m_pSignalKNotesManager->SetAuthToken("");
-      m_pSignalKNotesManager->ClearAuthRequest();
-      SaveConfig();
-    }
-  }
-
-  if (m_pSignalKNotesManager) {
-    m_pSignalKNotesManager->CleanupDisabledProviders();
-  }
-
   if (m_pConfigDialog) {
     m_pConfigDialog->Destroy();
     m_pConfigDialog = nullptr;
@@ -233,43 +234,16 @@ void signalk_notes_opencpn_pi::OnToolbarToolCallback(int id) {
 
   m_pConfigDialog = new tpConfigDialog(this, GetOCPNCanvasWindow());
 
-  // Resourcesets von SignalK abfragen und Tab befüllen
-  if (m_pSignalKNotesManager) {
-    std::set<wxString> available;
-    if (m_pSignalKNotesManager->FetchAvailableResourceSets(available)) {
-      m_availableResourceSets = available;
-
-      for (const auto& rsName : available) {
-        if (m_resourceSetConfigs.find(rsName) == m_resourceSetConfigs.end()) {
-          ResourceSetConfig cfg;
-          cfg.name = rsName;
-          cfg.enabled = false;
-          m_resourceSetConfigs[rsName] = cfg;
-        }
-      }
-
-      for (auto& rsKv : m_resourceSetConfigs) {
-        std::map<wxString, SubResourceSetConfig> discovered;
-        if (m_pSignalKNotesManager->DiscoverSubResourceSets(rsKv.first, discovered)) {
-          for (auto& sub : discovered) {
-            if (rsKv.second.subSets.find(sub.first) == rsKv.second.subSets.end()) {
-              rsKv.second.subSets[sub.first] = sub.second;
-            }
-          }
-        }
-      }
-
-      if (!m_resourceSetConfigs.empty()) {
-        m_pConfigDialog->UpdateResourceSetTab(m_resourceSetConfigs);
-      }
-    }
-  }
+  // Token-Prüfung, Provider und Resourcesets lädt der Dialog im Hintergrund
+  m_pConfigDialog->StartLoading();
 
   m_pConfigDialog->ShowModal();
 
   if (m_pConfigDialog->GetReturnCode() == wxID_OK) {
     m_pSignalKNotesManager->SetProviderSettings(
         m_pConfigDialog->GetProviderSettings());
+    m_pSignalKNotesManager->SetProviderIntervals(
+        m_pConfigDialog->GetProviderIntervals());
 
     m_pSignalKNotesManager->SetIconMappings(m_pConfigDialog->GetIconMappings());
 
@@ -277,6 +251,9 @@ void signalk_notes_opencpn_pi::OnToolbarToolCallback(int id) {
 
     SaveConfig();
 
+    // Stream-Einstellung und Abonnement der Resourcesets übernehmen
+    RestartStream();
+
     // UPDATE für ALLE Canvas
     for (auto& pair : m_canvasStates) {
       CanvasState& state = pair.second;
@@ -285,7 +262,7 @@ void signalk_notes_opencpn_pi::OnToolbarToolCallback(int id) {
         double centerLon = state.viewPort.clon;
         double maxDistance = CalculateMaxDistance(state);
         m_pSignalKNotesManager->UpdateDisplayedIcons(centerLat, centerLon,
-                                                     maxDistance, state);
+                                                     maxDistance, pair.first);
       }
     }
 
@@ -313,7 +290,7 @@ void signalk_notes_opencpn_pi::UpdateOverviewDialog() {
       double maxDistance = CalculateMaxDistance(state);
 
       m_pSignalKNotesManager->UpdateDisplayedIcons(centerLat, centerLon,
-                                                   maxDistance, state);
+                                                   maxDistance, pair.first);
     }
   }
 
@@ -322,11 +299,11 @@ void signalk_notes_opencpn_pi::UpdateOverviewDialog() {
       int left = 0, right = 0;
       auto it = m_canvasStates.begin();
       if (it != m_canvasStates.end()) {
-        left = GetVisibleNoteCount(it->second);
+        left = GetVisibleNoteCount(it->first);
         ++it;
       }
       if (it != m_canvasStates.end()) {
-        right = GetVisibleNoteCount(it->second);
+        right = GetVisibleNoteCount(it->first);
       }
       m_pOverviewDialog->UpdateVisibleCount(left, right);
     } else {
@@ -375,6 +352,7 @@ bool signalk_notes_opencpn_pi::DoRenderCommon(PlugIn_ViewPort* vp,
   state.lastViewPort = state.viewPort;
   state.viewPort = *vp;
   state.valid = true;
+  UpdatePanVelocity(state);
 
   // Cluster-Zoom prüfen
   if (!ProcessClusterZoom(state, canvasIndex)) return false;
@@ -383,40 +361,70 @@ bool signalk_notes_opencpn_pi::DoRenderCommon(PlugIn_ViewPort* vp,
   double centerLat = state.viewPort.clat;
   double centerLon = state.viewPort.clon;
   double maxDistance = CalculateMaxDistance(state);
-
-  // Fetch-Update nur wenn kein Dialog offen ist
+  m_pSignalKNotesManager->UpdateResourceSetWindow(canvasIndex, centerLat,
+                                                  centerLon, maxDistance);
+
+  // Fetch-Update nur wenn kein Dialog offen ist. Der Abruf läuft im
+  // Hintergrund-Thread, das Ergebnis wird per RequestRefresh nachgereicht.
+  // Bei verbundenem Stream entfällt das Intervall: Änderungen kommen als
+  // Delta, abgefragt wird nur noch, wenn der Sichtbereich andere Kacheln
+  // braucht. Weitere Server streamen nicht und brauchen es weiterhin.
   wxLongLong now = wxGetLocalTimeMillis();
-  bool updateClusters = false;
+  bool intervalDue =
+      (!m_pSignalKNotesManager->IsStreaming() ||
+       m_pSignalKNotesManager->GetServerCount() > 1) &&
+      (now - state.lastFetchTime).ToLong() >
+          (long)(m_pSignalKNotesManager->GetNotesRefreshInterval() * 60 * 1000);
   if (!m_dialogOpen &&
-      (state.lastFetchTime == 0 ||
-       (now - state.lastFetchTime).ToLong() >
-           (long)(m_fetchInterval * 60 * 1000) ||
-       fabs(centerLat - state.lastFetchCenterLat) > 0.01 ||
-       fabs(centerLon - state.lastFetchCenterLon) > 0.01 ||
-       fabs(maxDistance - state.lastFetchDistance) > maxDistance * 0.2)) {
+      (state.lastFetchTime == 0 || intervalDue ||
+       m_pSignalKNotesManager->TileRangeChanged(canvasIndex, centerLat,
+                                                centerLon, maxDistance))) {
     m_pSignalKNotesManager->UpdateDisplayedIcons(centerLat, centerLon,
-                                                 maxDistance, state);
+                                                 maxDistance, canvasIndex);
 
     state.lastFetchCenterLat = centerLat;
     state.lastFetchCenterLon = centerLon;
     state.lastFetchDistance = maxDistance;
     state.lastFetchTime = now;
-    updateClusters = true;
-  } else {
-    updateClusters = ViewPortsDiffer(state.viewPort, state.lastViewPort);
+  } else if (!m_dialogOpen) {
+    // Ohne Viewport-Abruf: fällige Resourcesets nachholen, in Schwenk- bzw.
+    // Fahrtrichtung vorausladen und Details der sichtbaren Notes holen,
+    // sobald die Leitung frei ist
+    m_pSignalKNotesManager->ScheduleResourceSets(canvasIndex);
+    m_pSignalKNotesManager->SchedulePrefetch(canvasIndex);
+    m_pSignalKNotesManager->ScheduleDetailsPrefetch(canvasIndex);
   }
+
+  bool updateClusters =
+      state.notesDirty || ViewPortsDiffer(state.viewPort, state.lastViewPort);
+  state.notesDirty = false;
+
   if (updateClusters) {
     // Cluster neu berechnen, wenn sich der ViewPort geändert hat oder neue
     // Daten geladen wurden
     // Sichtbare Notes holen
+    std::shared_ptr<const tpNoteSnapshot> snapshot =
+        m_pSignalKNotesManager->GetNoteSnapshot();
     std::vector<const SignalKNote*> visibleNotes;
-    m_pSignalKNotesManager->GetVisibleNotes(state, visibleNotes);
+    m_pSignalKNotesManager->GetVisibleNotes(*snapshot, canvasIndex,
+                                            visibleNotes);
 
-    if (visibleNotes.empty()) return false;
+    if (visibleNotes.empty()) {
+      state.clusters.clear();
+      return false;
+    }
 
     // Cluster berechnen
     state.clusters = BuildClusters(visibleNotes, state);
   }
+
+  // Einmal je Sitzung: Zeit vom Init bis zu den ersten Icons
+  if (!m_firstIconsLogged && !state.clusters.empty()) {
+    m_firstIconsLogged = true;
+    SKN_LOG(this, "First icons %ld ms after Init, %zu notes from last session",
+            (now - m_initTime).ToLong(),
+            m_pSignalKNotesManager->GetWarmStartNoteCount());
+  }
   return !state.clusters.empty();
 }
 
@@ -429,12 +437,14 @@ bool signalk_notes_opencpn_pi::DoRenderOverlay(wxDC& dc, PlugIn_ViewPort* vp,
     return false;
 
   CanvasState& state = m_canvasStates[canvasIndex];
+  // Ein Stand für das ganze Frame, ohne Lock
+  std::shared_ptr<const tpNoteSnapshot> snapshot =
+      m_pSignalKNotesManager->GetNoteSnapshot();
   bool drewSomething = false;
 
   for (const auto& cluster : state.clusters) {
     if (cluster.noteIds.size() == 1) {
-      const SignalKNote* note =
-          m_pSignalKNotesManager->GetNoteByGUID(state, cluster.noteIds[0]);
+      const SignalKNote* note = snapshot->Find(cluster.noteIds[0]);
       if (!note) continue;
 
       wxBitmap bmp;
@@ -470,12 +480,14 @@ bool signalk_notes_opencpn_pi::DoRenderGLOverlay(wxGLContext* pcontext,
   if (!DoRenderCommon(vp, canvasIndex, priority)) return false;
 
   CanvasState& state = m_canvasStates[canvasIndex];
+  // Ein Stand für das ganze Frame, ohne Lock
+  std::shared_ptr<const tpNoteSnapshot> snapshot =
+      m_pSignalKNotesManager->GetNoteSnapshot();
   bool drewSomething = false;
 
   for (const auto& cluster : state.clusters) {
     if (cluster.noteIds.size() == 1) {
-      const SignalKNote* note =
-          m_pSignalKNotesManager->GetNoteByGUID(state, cluster.noteIds[0]);
+      const SignalKNote* note = snapshot->Find(cluster.noteIds[0]);
       if (!note) continue;
 
       wxBitmap bmp;
@@ -551,17 +563,21 @@ bool signalk_notes_opencpn_pi::MouseEventHook(wxMouseEvent& event) {
   };
 
   auto noteIsInMultiCluster = [&](const SignalKNote* note) {
+    wxString noteId = note->GetId();
     for (const auto& c : state.clusters) {
       if (c.noteIds.size() <= 1) continue;
       for (const auto& id : c.noteIds) {
-        if (id == note->id) return true;
+        if (id == noteId) return true;
       }
     }
     return false;
   };
 
+  std::shared_ptr<const tpNoteSnapshot> snapshot =
+      m_pSignalKNotesManager->GetNoteSnapshot();
   std::vector<const SignalKNote*> visibleNotes;
-  m_pSignalKNotesManager->GetVisibleNotes(state, visibleNotes);
+  m_pSignalKNotesManager->GetVisibleNotes(*snapshot, m_activeCanvasIndex,
+                                          visibleNotes);
 
   double noteTolerance = GetIconSize() / 2;
   double clusterTolerance = GetClusterSize() / 2;
@@ -608,9 +624,9 @@ bool signalk_notes_opencpn_pi::MouseEventHook(wxMouseEvent& event) {
       ClickableElement elem;
       elem.type = ClickableElement::NOTE;
       elem.distancePixels = distPx;
-      elem.noteGuid = note->id;
+      elem.noteGuid = note->GetId();
       elem.description =
-          wxString::Format("Note '%s' at %.1f px", note->id, distPx);
+          wxString::Format("Note '%s' at %.1f px", elem.noteGuid, distPx);
       hitElements.push_back(elem);
 
       SKN_LOG(this, "Note HIT: %s (tolerance=%.1f px)",
@@ -641,8 +657,7 @@ bool signalk_notes_opencpn_pi::MouseEventHook(wxMouseEvent& event) {
   }
 
   SKN_LOG(this, "Note clicked: %s", winner.noteGuid.mb_str());
-  m_pSignalKNotesManager->OnIconClick(winner.noteGuid, state,
-                                      m_activeCanvasIndex);
+  m_pSignalKNotesManager->OnIconClick(winner.noteGuid, m_activeCanvasIndex);
   return true;
 }
 
@@ -662,6 +677,13 @@ void signalk_notes_opencpn_pi::SaveConfig() {
   for (auto& it : m_pSignalKNotesManager->GetProviderSettings())
     pConf->Write(it.first, it.second);
 
+  pConf->SetPath("/Settings/signalk_notes_opencpn_pi");
+  pConf->DeleteGroup("ProviderIntervals");
+  pConf->SetPath("/Settings/signalk_notes_opencpn_pi/ProviderIntervals");
+
+  for (auto& it : m_pSignalKNotesManager->GetProviderIntervals())
+    if (it.second > 0) pConf->Write(it.first, (long)it.second);
+
   pConf->SetPath("/Settings/signalk_notes_opencpn_pi/IconMappings");
 
   for (auto& it : m_pSignalKNotesManager->GetIconMappings())
@@ -703,6 +725,7 @@ void signalk_notes_opencpn_pi::SaveConfig() {
                        m_pConfigDialog->GetClusterFontSize());
 
     m_pTPConfig->Write("DisplaySettings/DebugMode", (long)m_debugMode);
+    m_pTPConfig->Write("DisplaySettings/StreamUpdates", (long)m_streamUpdates);
 
     m_pTPConfig->Write("DisplaySettings/ClusterMaxScale",
                        m_pConfigDialog->GetClusterMaxScale());
@@ -738,20 +761,39 @@ bool signalk_notes_opencpn_pi::LoadConfig() {
 
   wxArrayString entries = wxSplit(data, '|');
   bool found = false;
+  // Weitere SignalK-Verbindungen liefern nur zusätzliche Notes
+  std::vector<tpServerEndpoint> extraServers;
 
   for (auto& entry : entries) {
     if (entry.StartsWith("1;3;")) {
       wxArrayString fields = wxSplit(entry, ';');
 
       if (fields.size() >= 4) {
-        host = fields[2];
         long portLong = 0;
         fields[3].ToLong(&portLong);
-        port = (int)portLong;
 
-        SKN_LOG(this, "FOUND: host=%s port=%d", host, port);
-        found = true;
-        break;
+        if (!found) {
+          host = fields[2];
+          port = (int)portLong;
+          SKN_LOG(this, "FOUND: host=%s port=%d", host, port);
+          found = true;
+          continue;
+        }
+
+        tpServerEndpoint server;
+        server.host = fields[2];
+        server.port = (int)portLong;
+        if (server.host.IsEmpty() || server.port <= 0) continue;
+        if (server.host == host && server.port == port) continue;
+
+        bool duplicate = false;
+        for (const auto& other : extraServers)
+          duplicate = duplicate || other.GetId() == server.GetId();
+        if (duplicate) continue;
+
+        SKN_LOG(this, "FOUND additional server: host=%s port=%d",
+                server.host, server.port);
+        extraServers.push_back(server);
       }
     }
   }
@@ -777,6 +819,7 @@ bool signalk_notes_opencpn_pi::LoadConfig() {
   }
 
   m_pSignalKNotesManager->SetServerDetails(host, port);
+  m_pSignalKNotesManager->SetAdditionalServers(extraServers);
   std::map<wxString, bool> providers;
 
   pConf->SetPath("/Settings/signalk_notes_opencpn_pi/Providers");
@@ -795,6 +838,21 @@ bool signalk_notes_opencpn_pi::LoadConfig() {
 
   m_pSignalKNotesManager->SetProviderSettings(providers);
 
+  std::map<wxString, int> providerIntervals;
+
+  pConf->SetPath("/Settings/signalk_notes_opencpn_pi/ProviderIntervals");
+
+  hasMore = pConf->GetFirstEntry(providerName, providerIndex);
+
+  while (hasMore) {
+    long minutes = 0;
+    pConf->Read(providerName, &minutes, 0L);
+    if (minutes > 0) providerIntervals[providerName] = (int)minutes;
+    hasMore = pConf->GetNextEntry(providerName, providerIndex);
+  }
+
+  m_pSignalKNotesManager->SetProviderIntervals(providerIntervals);
+
   std::map<wxString, wxString> iconMappings;
 
   pConf->SetPath("/Settings/signalk_notes_opencpn_pi/IconMappings");
@@ -899,6 +957,8 @@ bool signalk_notes_opencpn_pi::LoadConfig() {
                         (long)tpConfigDialog::DEFAULT_CLUSTER_FONT_SIZE);
 
   m_debugMode = m_pTPConfig->Read("DisplaySettings/DebugMode", (long)0);
+  m_streamUpdates =
+      m_pTPConfig->Read("DisplaySettings/StreamUpdates", (long)0) != 0;
 
   m_clusterMaxScale =
       m_pTPConfig->Read("DisplaySettings/ClusterMaxScale",
@@ -945,6 +1005,14 @@ void signalk_notes_opencpn_pi::LoadResourceSetConfig(wxFileConfig* pConf) {
         subCfg.enabled  = true;
         cfg.subSets[subCfg.name] = subCfg;
       }
+
+      // Zeitplan (ab Version mit Quellen-Scheduler): Intervall|Priorität|Alter
+      if (parts.GetCount() >= 6) {
+        long v;
+        if (parts[3].ToLong(&v)) cfg.refreshMinutes = (int)v;
+        if (parts[4].ToLong(&v)) cfg.priority = (int)v;
+        if (parts[5].ToLong(&v)) cfg.maxStaleMinutes = (int)v;
+      }
       m_resourceSetConfigs[cfg.name] = cfg;
     }
     hasMore = pConf->GetNextEntry(key, idx);
@@ -974,7 +1042,10 @@ void signalk_notes_opencpn_pi::SaveResourceSetConfig(wxFileConfig* pConf) {
 
     pConf->Write(rsKey, wxString::Format("%d", (int)rsKv.second.enabled)
                  + "|" + rsKv.first
-                 + "|" + wxJoin(subEntries, ','));
+                 + "|" + wxJoin(subEntries, ',')
+                 + wxString::Format("|%d|%d|%d", rsKv.second.refreshMinutes,
+                                    rsKv.second.priority,
+                                    rsKv.second.maxStaleMinutes));
   }
 
   pConf->SetPath("/");
@@ -991,6 +1062,14 @@ wxBitmap* signalk_notes_opencpn_pi::GetPlugInBitmap() {
   return &m_ptpicons->m_bm_signalk_notes_opencpn_pi;
 }
 
+void signalk_notes_opencpn_pi::RestartStream() {
+  if (!m_pSignalKNotesManager) return;
+
+  // Neu starten übernimmt Server, Token und aktivierte Resourcesets
+  m_pSignalKNotesManager->StopStream();
+  if (m_streamUpdates) m_pSignalKNotesManager->StartStream();
+}
+
 double signalk_notes_opencpn_pi::CalculateMaxDistance(
     const CanvasState& state) {
   const PlugIn_ViewPort& vp = state.viewPort;
@@ -1009,9 +1088,10 @@ double signalk_notes_opencpn_pi::CalculateMaxDistance(
 }
 
 // Für einen spezifischen Canvas
-int signalk_notes_opencpn_pi::GetVisibleNoteCount(CanvasState& state) const {
+int signalk_notes_opencpn_pi::GetVisibleNoteCount(int canvasIndex) const {
   std::vector<const SignalKNote*> notes;
-  m_pSignalKNotesManager->GetVisibleNotes(state, notes);
+  m_pSignalKNotesManager->GetVisibleNotes(
+      *m_pSignalKNotesManager->GetNoteSnapshot(), canvasIndex, notes);
   return notes.size();
 }
 
@@ -1020,10 +1100,7 @@ int signalk_notes_opencpn_pi::GetVisibleNoteCount() const {
   int totalCount = 0;
 
   for (const auto& pair : m_canvasStates) {
-    const CanvasState& state = pair.second;
-    if (state.valid) {
-      totalCount += GetVisibleNoteCount(const_cast<CanvasState&>(state));
-    }
+    if (pair.second.valid) totalCount += GetVisibleNoteCount(pair.first);
   }
 
   return totalCount;
@@ -1045,8 +1122,9 @@ signalk_notes_opencpn_pi::BuildClusters(
     GetCanvasPixLL(&vpCopy, &p1, notes[i]->latitude, notes[i]->longitude);
 
     NoteCluster cluster;
-    cluster.noteIds.push_back(notes[i]->id);
+    cluster.noteIds.push_back(notes[i]->GetId());
     clustered[i] = true;
+    double sumLat = notes[i]->latitude, sumLon = notes[i]->longitude;
 
     for (size_t j = i + 1; j < notes.size(); j++) {
       if (clustered[j]) continue;
@@ -1060,19 +1138,10 @@ signalk_notes_opencpn_pi::BuildClusters(
       double dist = std::sqrt(dx * dx + dy * dy);
 
       if (dist < clusterRadius) {
-        cluster.noteIds.push_back(notes[j]->id);
+        cluster.noteIds.push_back(notes[j]->GetId());
         clustered[j] = true;
-      }
-    }
-
-    double sumLat = 0, sumLon = 0;
-
-    for (const auto& id : cluster.noteIds) {
-      const SignalKNote* note =
-          m_pSignalKNotesManager->GetNoteByGUID(state, id);
-      if (note) {
-        sumLat += note->latitude;
-        sumLon += note->longitude;
+        sumLat += notes[j]->latitude;
+        sumLon += notes[j]->longitude;
       }
     }
 
@@ -1328,26 +1397,8 @@ void signalk_notes_opencpn_pi::DrawGLBitmap(const wxBitmap&, int, int) {
 void signalk_notes_opencpn_pi::ShowPreferencesDialog(wxWindow* parent) {
   tpConfigDialog dlg(this, parent);
 
-  // Resourcesets von SignalK abfragen und Tab befüllen
-  // (muss NACH dem Konstruktor passieren, da FetchAvailableResourceSets
-  //  eine Netzwerk-Anfrage macht, die beim Konstruktor noch nicht sinnvoll ist)
-  if (m_pSignalKNotesManager) {
-    std::set<wxString> available;
-    if (m_pSignalKNotesManager->FetchAvailableResourceSets(available)) {
-      m_availableResourceSets = available;
-      for (const auto& rsName : available) {
-        if (m_resourceSetConfigs.find(rsName) == m_resourceSetConfigs.end()) {
-          ResourceSetConfig cfg;
-          cfg.name = rsName;
-          cfg.enabled = false;
-          m_resourceSetConfigs[rsName] = cfg;
-        }
-      }
-      if (!m_resourceSetConfigs.empty()) {
-        dlg.UpdateResourceSetTab(m_resourceSetConfigs);
-      }
-    }
-  }
+  // Resourcesets von SignalK abfragen und Tab befüllen, im Hintergrund
+  dlg.StartLoading();
 
   m_resourceSetConfigsBackup = m_resourceSetConfigs;
 
@@ -1454,6 +1505,9 @@ void signalk_notes_opencpn_pi::ShowPreferencesDialog(wxWindow* parent) {
     
     m_resourceSetConfigs = newConfigs;
     SaveConfig();
+
+    // Stream-Einstellung und Abonnement der Resourcesets übernehmen
+    RestartStream();
   }
 }
 
@@ -1482,10 +1536,10 @@ void signalk_notes_opencpn_pi::ShowClusterSelectionDialog(NoteCluster cluster,
   listCtrl->AssignImageList(imgList, wxIMAGE_LIST_SMALL);
 
   for (size_t i = 0; i < cluster.noteIds.size(); i++) {
-    const SignalKNote* note =
-        m_pSignalKNotesManager->GetNoteByGUID(state, cluster.noteIds[i]);
+    std::shared_ptr<const SignalKNote> note =
+        m_pSignalKNotesManager->GetNoteByGUID(cluster.noteIds[i]);
     if (!note) continue;
-    wxString label = note->name.IsEmpty() ? note->id : note->name;
+    wxString label = note->HasName() ? note->GetName() : note->GetId();
 
     int imgIdx = -1;
     wxBitmap bmp;
@@ -1535,7 +1589,7 @@ void signalk_notes_opencpn_pi::ShowClusterSelectionDialog(NoteCluster cluster,
   }
 
   if (!selectedNoteId.IsEmpty()) {
-    m_pSignalKNotesManager->OnIconClick(selectedNoteId, state, canvasIndex);
+    m_pSignalKNotesManager->OnIconClick(selectedNoteId, canvasIndex);
     return;
   }
 }
@@ -1544,6 +1598,49 @@ void signalk_notes_opencpn_pi::SetCurrentViewPort(PlugIn_ViewPort& vp) {
   return;
 }
 
+void signalk_notes_opencpn_pi::SetPositionFixEx(PlugIn_Position_Fix_Ex& pfix) {
+  m_ownship.valid = true;
+  m_ownship.lat = pfix.Lat;
+  m_ownship.lon = pfix.Lon;
+  m_ownship.cog = pfix.Cog;
+  m_ownship.sog = pfix.Sog;
+  m_ownship.fixTime = wxGetLocalTimeMillis();
+}
+
+static const double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+// Schwenkgeschwindigkeit höchstens alle 100 ms messen - bei mehreren
+// Render-Durchläufen pro Bild wäre der Zeitabstand sonst nahe null. Nach
+// einer Pause von über einer Sekunde gilt der Schwenk als beendet.
+void signalk_notes_opencpn_pi::UpdatePanVelocity(CanvasState& state) {
+  wxLongLong now = wxGetLocalTimeMillis();
+  long dtMs =
+      state.panSampleTime == 0 ? -1 : (now - state.panSampleTime).ToLong();
+  if (dtMs >= 0 && dtMs < 100) return;
+
+  double lat = state.viewPort.clat;
+  double lon = state.viewPort.clon;
+
+  if (dtMs < 0 || dtMs > 1000) {
+    state.panNorthMps = 0.0;
+    state.panEastMps = 0.0;
+  } else {
+    double dLon = lon - state.panSampleLon;
+    if (dLon > 180.0) dLon -= 360.0;
+    if (dLon < -180.0) dLon += 360.0;
+
+    double north = (lat - state.panSampleLat) * 111120.0 * 1000.0 / dtMs;
+    double east =
+        dLon * 111120.0 * std::cos(lat * DEG_TO_RAD) * 1000.0 / dtMs;
+    state.panNorthMps = 0.6 * state.panNorthMps + 0.4 * north;
+    state.panEastMps = 0.6 * state.panEastMps + 0.4 * east;
+  }
+
+  state.panSampleTime = now;
+  state.panSampleLat = lat;
+  state.panSampleLon = lon;
+}
+
 int ComputeScale(const PlugIn_ViewPort& vp) {
   if (vp.view_scale_ppm <= 0) {
     return 1;
@@ -1568,9 +1665,11 @@ bool signalk_notes_opencpn_pi::ProcessClusterZoom(CanvasState& state,
           currentScale);
 
   // FIND THE NOTES USING THE IDS
+  std::shared_ptr<const tpNoteSnapshot> snapshot =
+      m_pSignalKNotesManager->GetNoteSnapshot();
   std::vector<const SignalKNote*> originalNotes;
   for (const auto& id : state.clusterZoom.noteIds) {
-    SignalKNote* note = m_pSignalKNotesManager->GetNoteByGUID(state, id);
+    const SignalKNote* note = snapshot->Find(id);
     if (note) {
       originalNotes.push_back(note);
     }
@@ -1666,14 +1765,21 @@ void signalk_notes_opencpn_pi::InvalidateAllBmpCaches() {
   InvalidateBmpClusterCache();
 }
 
+// Nur der leichte Zustand der Canvas fällt weg; Kacheln und Resourcesets
+// hält der Manager für alle, ein wieder geöffneter Canvas zeigt sie sofort
 void signalk_notes_opencpn_pi::PruneCanvasStates(int canvasIndex) {
   if (m_canvasStates.size() > 1 &&
       m_canvasStates.size() != static_cast<size_t>(GetCanvasCount())) {
     for (auto it = m_canvasStates.begin(); it != m_canvasStates.end();) {
-      if (it->first != canvasIndex)
+      if (it->first != canvasIndex) {
+        // Erst entfernen, damit der neue Snapshot sein Fenster nicht mehr
+        // enthält
+        int closedIndex = it->first;
         it = m_canvasStates.erase(it);
-      else
+        m_pSignalKNotesManager->ReleaseCanvas(closedIndex);
+      } else {
         ++it;
+      }
     }
   }
 }
@@ -12,6 +12,8 @@
 #include "signalk_notes_opencpn_pi.h"
 #include "tpConfigDialog.h"
 #include "tpSignalKNotes.h"
+#include "tpConfigLoader.h"
+#include "tpOfflineStore.h"
 #include "ocpn_plugin.h"
 
 #include <wx/sizer.h>
@@ -26,6 +28,8 @@
 #include <wx/timer.h>
 #include <wx/artprov.h>
 
+#include <algorithm>
+
 BEGIN_EVENT_TABLE(tpConfigDialog, wxDialog)
 EVT_BUTTON(wxID_OK, tpConfigDialog::OnOK)
 EVT_BUTTON(wxID_CANCEL, tpConfigDialog::OnCancel)
@@ -73,13 +77,11 @@ void tpConfigDialog::CreateControls() {
       int left = 0, right = 0;
       auto it = m_parent->m_canvasStates.begin();
       if (it != m_parent->m_canvasStates.end()) {
-        left = m_parent->GetVisibleNoteCount(
-            const_cast<signalk_notes_opencpn_pi::CanvasState&>(it->second));
+        left = m_parent->GetVisibleNoteCount(it->first);
         ++it;
       }
       if (it != m_parent->m_canvasStates.end()) {
-        right = m_parent->GetVisibleNoteCount(
-            const_cast<signalk_notes_opencpn_pi::CanvasState&>(it->second));
+        right = m_parent->GetVisibleNoteCount(it->first);
       }
       UpdateVisibleCount(left, right);
     } else {
@@ -106,6 +108,27 @@ void tpConfigDialog::CreateControls() {
 
   m_providerList = new wxCheckListBox(providerPanel, wxID_ANY);
   providerSizer->Add(m_providerList, 1, wxALL | wxEXPAND, 5);
+  m_providerList->Bind(wxEVT_LISTBOX, &tpConfigDialog::OnProviderSelected,
+                       this);
+
+  // Eigenes Intervall für den markierten Provider
+  wxBoxSizer* providerIntervalSizer = new wxBoxSizer(wxHORIZONTAL);
+  providerIntervalSizer->Add(
+      new wxStaticText(providerPanel, wxID_ANY,
+                       _("Update interval of the selected provider (minutes, "
+                         "0 = API update interval)")),
+      0, wxALIGN_CENTER_VERTICAL | wxALL, 5);
+
+  m_providerIntervalCtrl = new wxSpinCtrl(providerPanel, wxID_ANY);
+  m_providerIntervalCtrl->SetRange(0, 1440);
+  m_providerIntervalCtrl->SetValue(0);
+  m_providerIntervalCtrl->Enable(false);
+  m_providerIntervalCtrl->Bind(wxEVT_SPINCTRL,
+                               &tpConfigDialog::OnProviderIntervalChanged,
+                               this);
+  providerIntervalSizer->Add(m_providerIntervalCtrl, 0,
+                             wxALIGN_CENTER_VERTICAL | wxALL, 5);
+  providerSizer->Add(providerIntervalSizer, 0, wxLEFT | wxRIGHT, 5);
 
   // Auth-Status-Anzeige + Fetch-Intervall in einer Zeile
   wxBoxSizer* authStatusSizer = new wxBoxSizer(wxHORIZONTAL);
@@ -131,6 +154,12 @@ void tpConfigDialog::CreateControls() {
 
   providerSizer->Add(authStatusSizer, 0, wxALL | wxEXPAND, 5);
 
+  // Push-Updates: Intervall gilt dann nur noch als Rückfall ohne Stream
+  m_streamCheckbox = new wxCheckBox(
+      providerPanel, wxID_ANY,
+      _("Live updates via SignalK stream (interval is used as fallback)"));
+  providerSizer->Add(m_streamCheckbox, 0, wxALL, 10);
+
   providerPanel->SetSizer(providerSizer);
   m_notebook->AddPage(providerPanel, _("Provider"));
 
@@ -164,6 +193,9 @@ void tpConfigDialog::CreateControls() {
   CreateDisplayTab();
   m_notebook->AddPage(m_displayPanel, _("Deciption"));
 
+  // ========== Tab Offline ==========
+  CreateOfflineTab();
+
   mainSizer->Add(m_notebook, 1, wxALL | wxEXPAND, 5);
 
   // ========== BUTTON-BEREICH ==========
@@ -208,6 +240,7 @@ void tpConfigDialog::CreateControls() {
     m_providerList->Check(index, pair.second);
     m_providerList->SetClientData(index, new wxString(pair.first));
   }
+  m_providerIntervals = mgr->GetProviderIntervals();
 
   // --- Icon-Mappings laden ---
   m_currentIconMappings = mgr->GetIconMappings();
@@ -227,12 +260,15 @@ void tpConfigDialog::CreateControls() {
 
   if (m_fetchIntervalCtrl)
     m_fetchIntervalCtrl->SetValue(m_parent->GetFetchInterval());
+  if (m_streamCheckbox)
+    m_streamCheckbox->SetValue(m_parent->IsStreamUpdates());
 
   //  ---Auth status setzen ---
   InitializeAuthUI();
   if (!m_authCheckTimer->IsRunning()) {
     m_authCheckTimer->Start(2000);
   }
+  UpdateOfflineStatus();
   m_settingsLoaded = true;
   Layout();
 }
@@ -431,6 +467,39 @@ std::map<wxString, bool> tpConfigDialog::GetProviderSettings() const {
   return settings;
 }
 
+std::map<wxString, int> tpConfigDialog::GetProviderIntervals() const {
+  std::map<wxString, int> intervals;
+  for (const auto& pair : m_providerIntervals) {
+    if (pair.second > 0) intervals[pair.first] = pair.second;
+  }
+  return intervals;
+}
+
+// Provider-ID des markierten Eintrags, leer wenn keiner markiert ist
+wxString tpConfigDialog::GetSelectedProviderId() const {
+  int sel = m_providerList->GetSelection();
+  if (sel == wxNOT_FOUND) return wxEmptyString;
+  wxString* idPtr = (wxString*)m_providerList->GetClientData(sel);
+  return idPtr ? *idPtr : m_providerList->GetString(sel);
+}
+
+void tpConfigDialog::OnProviderSelected(wxCommandEvent& event) {
+  wxString providerId = GetSelectedProviderId();
+  m_providerIntervalCtrl->Enable(!providerId.IsEmpty());
+
+  auto it = m_providerIntervals.find(providerId);
+  m_providerIntervalCtrl->SetValue(it != m_providerIntervals.end() ? it->second
+                                                                   : 0);
+  event.Skip();
+}
+
+void tpConfigDialog::OnProviderIntervalChanged(wxSpinEvent& event) {
+  wxString providerId = GetSelectedProviderId();
+  if (!providerId.IsEmpty())
+    m_providerIntervals[providerId] = m_providerIntervalCtrl->GetValue();
+  event.Skip();
+}
+
 void tpConfigDialog::SaveProviderSettings() {
   m_enabledProviders.clear();
 
@@ -448,6 +517,8 @@ void tpConfigDialog::OnOK(wxCommandEvent& event) {
   if (m_parent && m_parent->m_pSignalKNotesManager) {
     m_parent->m_pSignalKNotesManager->SetProviderSettings(
         GetProviderSettings());
+    m_parent->m_pSignalKNotesManager->SetProviderIntervals(
+        GetProviderIntervals());
   }
 
   // Icon-Mappings an Manager übergeben
@@ -488,6 +559,8 @@ void tpConfigDialog::OnOK(wxCommandEvent& event) {
         GetIconSize(), GetClusterSize(), GetClusterRadius(), GetClusterColor(),
         GetClusterTextColor(), GetClusterFontSize(), maxScale, minScale);
     m_parent->SetFetchInterval(GetFetchInterval());
+    if (m_streamCheckbox)
+      m_parent->SetStreamUpdates(m_streamCheckbox->GetValue());
   }
 
   // Debug-Einstellungen an Plugin übergeben
@@ -503,6 +576,7 @@ void tpConfigDialog::OnOK(wxCommandEvent& event) {
   if (m_authCheckTimer && m_authCheckTimer->IsRunning()) {
     m_authCheckTimer->Stop();
   }
+  StopLoading();
 
   // Plugin-Konfiguration
   if (m_parent && m_resourceSetScrollWin) {
@@ -514,6 +588,7 @@ void tpConfigDialog::OnOK(wxCommandEvent& event) {
 
 void tpConfigDialog::OnCancel(wxCommandEvent& event) {
   if (m_authCheckTimer->IsRunning()) m_authCheckTimer->Stop();
+  StopLoading();
   EndModal(wxID_CANCEL);
 }
 
@@ -564,6 +639,7 @@ void tpConfigDialog::OnAuthButtonClick(wxCommandEvent& event) {
 
 void tpConfigDialog::OnAuthCheckTimer(wxTimerEvent& event) {
   auto* mgr = m_parent->m_pSignalKNotesManager;
+  UpdateOfflineStatus();
   SKN_LOG(m_parent, "OnAuthCheckTimer fired, IsAuthPending=%d",
           (int)mgr->IsAuthPending());
 
@@ -594,6 +670,9 @@ void tpConfigDialog::OnAuthCheckTimer(wxTimerEvent& event) {
     return;
   }
 
+  // Prüfung des Tokens läuft noch im Hintergrund
+  if (m_providersLoading) return;
+
   wxTimeSpan tokenAge = wxDateTime::Now() - mgr->GetAuthTokenReceivedTime();
 
   if (tokenAge.GetSeconds() < 10) {
@@ -617,6 +696,8 @@ void tpConfigDialog::OnAuthCheckTimer(wxTimerEvent& event) {
 }
 
 tpConfigDialog::~tpConfigDialog() {
+  StopLoading();
+
   // ClientData aufräumen
   for (unsigned int i = 0; i < m_providerList->GetCount(); i++) {
     wxString* idPtr = (wxString*)m_providerList->GetClientData(i);
@@ -638,27 +719,12 @@ void tpConfigDialog::InitializeAuthUI() {
   wxString requestHref = mgr->GetAuthRequestHref();
   bool pending = mgr->IsAuthPending();
 
-  // 1. Token vorhanden → NUR validieren wenn KEINE Anfrage läuft
+  // 1. Token vorhanden und KEINE Anfrage läuft → geprüft wird im
+  // Hintergrund (StartLoading), ein ungültiger Token setzt zurück
   if (!token.IsEmpty() && !pending) {
-    SKN_LOG(m_parent, "Token present, validating...");
-
-    // Kleine Verzögerung falls Token gerade erst empfangen wurde
-    wxMilliSleep(500);
-
-    if (mgr->ValidateToken()) {
-      SKN_LOG(m_parent, "Token is valid → showing authenticated state");
-      ShowAuthenticatedState();
-      return;
-    } else {
-      // Token ungültig → löschen
-      SKN_LOG(m_parent, "Token INVALID → clearing and showing initial state");
-      mgr->SetAuthToken("");
-      mgr->ClearAuthRequest();
-      m_parent->SaveConfig();
-      token.Clear();
-      requestHref.Clear();
-      pending = false;
-    }
+    SKN_LOG(m_parent, "Token present → showing authenticated state");
+    ShowAuthenticatedState();
+    return;
   }
 
   // 2. Authentifizierung läuft
@@ -687,14 +753,11 @@ void tpConfigDialog::ShowAuthenticatedState() {
 
   auto* mgr = m_parent->m_pSignalKNotesManager;
 
-  // Pluginliste und Provider-Namen aktualisieren
-  std::map<wxString, bool> plugins;
-  mgr->FetchInstalledPlugins(plugins);
-
+  // Provider-Namen aus der zuletzt geladenen Pluginliste
   auto providerInfos = mgr->GetProviderInfos();
 
   if (providerInfos.empty()) {
-    SKN_LOG(m_parent, "providerInfos EMPTY → retrying in 500ms");
+    SKN_LOG(m_parent, "providerInfos EMPTY → waiting for plugin list");
     return;
   }
 
@@ -793,6 +856,7 @@ void tpConfigDialog::UpdateProviders(
       // Fallback: ID
       displayText = providerId;
     }
+    if (m_providersLoading) displayText += _(" (loading...)");
 
     int index = m_providerList->Append(displayText);
 
@@ -809,6 +873,9 @@ void tpConfigDialog::UpdateProviders(
     m_providerList->Check(index, checked);
   }
 
+  // Markierung geht beim Neuaufbau verloren
+  m_providerIntervalCtrl->Enable(false);
+
   // Hinweis ausblenden, wenn Provider existieren
   if (m_providerList->GetCount() > 0) {
     m_infoLabel->Hide();
@@ -1070,7 +1137,11 @@ void tpConfigDialog::CreateResourceSetTab() {
 
   wxStaticText* hint = new wxStaticText(
       m_resourceSetPanel, wxID_ANY,
-      _("Enable resource sets and choose an icon for the chart display."));
+      _("Enable resource sets and choose an icon for the chart display.\n"
+        "Interval 0 uses the API update interval. Once due, normal sets wait "
+        "for an idle connection and background sets are fetched on their "
+        "own,\nbut none waits longer than its maximum age (minutes, 0 = not "
+        "at all)."));
 
   mainSizer->Add(hint, 0, wxALL, 5);
 
@@ -1115,8 +1186,49 @@ void tpConfigDialog::UpdateResourceSetTab(
 
     mainRow.enabledCheck = mainCheck;
     grid->Add(mainCheck, 0, wxALL | wxALIGN_CENTER_VERTICAL, 3);
-    grid->AddSpacer(0);
-    grid->AddSpacer(0);
+
+    // Zeitplan: Intervall | Priorität | maximales Alter
+    wxBoxSizer* scheduleSizer = new wxBoxSizer(wxHORIZONTAL);
+    scheduleSizer->Add(
+        new wxStaticText(m_resourceSetScrollWin, wxID_ANY, _("Interval")), 0,
+        wxALIGN_CENTER_VERTICAL | wxRIGHT, 3);
+    mainRow.refreshCtrl = new wxSpinCtrl(
+        m_resourceSetScrollWin, wxID_ANY, wxEmptyString, wxDefaultPosition,
+        wxSize(70, -1), wxSP_ARROW_KEYS, 0, 1440, rsCfg.refreshMinutes);
+    scheduleSizer->Add(mainRow.refreshCtrl, 0,
+                       wxALIGN_CENTER_VERTICAL | wxRIGHT, 8);
+
+    wxArrayString priorities;
+    priorities.Add(_("High"));
+    priorities.Add(_("Normal"));
+    priorities.Add(_("Background"));
+    mainRow.priorityCtrl = new wxChoice(m_resourceSetScrollWin, wxID_ANY,
+                                        wxDefaultPosition, wxDefaultSize,
+                                        priorities);
+    mainRow.priorityCtrl->SetSelection(
+        std::max(0, std::min(2, rsCfg.priority)));
+    scheduleSizer->Add(mainRow.priorityCtrl, 0,
+                       wxALIGN_CENTER_VERTICAL | wxRIGHT, 8);
+
+    scheduleSizer->Add(
+        new wxStaticText(m_resourceSetScrollWin, wxID_ANY, _("Max. age")), 0,
+        wxALIGN_CENTER_VERTICAL | wxRIGHT, 3);
+    mainRow.maxStaleCtrl = new wxSpinCtrl(
+        m_resourceSetScrollWin, wxID_ANY, wxEmptyString, wxDefaultPosition,
+        wxSize(70, -1), wxSP_ARROW_KEYS, 0, 10080, rsCfg.maxStaleMinutes);
+    scheduleSizer->Add(mainRow.maxStaleCtrl, 0, wxALIGN_CENTER_VERTICAL);
+
+    mainRow.refreshCtrl->Enable(rsCfg.enabled);
+    mainRow.priorityCtrl->Enable(rsCfg.enabled);
+    mainRow.maxStaleCtrl->Enable(rsCfg.enabled);
+
+    grid->Add(scheduleSizer, 0, wxALL | wxALIGN_CENTER_VERTICAL, 2);
+
+    mainRow.loadingLabel =
+        new wxStaticText(m_resourceSetScrollWin, wxID_ANY, _("loading..."));
+    mainRow.loadingLabel->SetForegroundColour(*wxBLUE);
+    mainRow.loadingLabel->Show(m_rsLoading.count(rsName) > 0);
+    grid->Add(mainRow.loadingLabel, 0, wxALL | wxALIGN_CENTER_VERTICAL, 2);
 
     // Unter-Resourcesets
     for (auto& subKv : rsCfg.subSets) {
@@ -1170,6 +1282,141 @@ void tpConfigDialog::UpdateResourceSetTab(
   m_resourceSetScrollWin->Layout();
 }
 
+// Neue Resourcesets und Unter-Resourcesets aus einer Antwort übernehmen;
+// true, wenn etwas dazukam
+static bool MergeDiscovered(
+    std::map<wxString, signalk_notes_opencpn_pi::ResourceSetConfig>& configs,
+    const tpConfigLoadResult& result) {
+  std::set<wxString> names = result.resourceSets;
+  if (result.kind == tpConfigLoadResult::RESOURCE_SET)
+    names.insert(result.resourceSetName);
+
+  bool changed = false;
+  for (const auto& rsName : names) {
+    if (configs.find(rsName) != configs.end()) continue;
+    signalk_notes_opencpn_pi::ResourceSetConfig cfg;
+    cfg.name = rsName;
+    cfg.enabled = false;
+    configs[rsName] = cfg;
+    changed = true;
+  }
+  if (result.kind != tpConfigLoadResult::RESOURCE_SET) return changed;
+
+  auto& subSets = configs[result.resourceSetName].subSets;
+  for (const auto& sub : result.rsResult.discoveredSubs) {
+    if (subSets.find(sub.first) != subSets.end()) continue;
+    signalk_notes_opencpn_pi::SubResourceSetConfig cfg;
+    cfg.name = sub.first;
+    cfg.enabled = false;
+    subSets[sub.first] = cfg;
+    changed = true;
+  }
+  return changed;
+}
+
+void tpConfigDialog::StartLoading() {
+  auto* mgr = m_parent->m_pSignalKNotesManager;
+
+  tpConfigLoadJob job;
+  std::vector<tpConfigLoadResult> cached;
+  mgr->InitConfigLoadJob(job, cached);
+
+  // Sofort mit dem bekannten Stand anzeigen
+  std::map<wxString, signalk_notes_opencpn_pi::ResourceSetConfig> configs =
+      m_parent->m_resourceSetConfigs;
+  for (const auto& result : cached) MergeDiscovered(configs, result);
+
+  bool load = !job.server.host.IsEmpty();
+  if (load) {
+    m_providersLoading = true;
+    for (const auto& rsKv : job.resourceSets) m_rsLoading.insert(rsKv.first);
+  }
+  UpdateResourceSetTab(configs);
+  UpdateProviders(mgr->GetDiscoveredProviders());
+  if (!load) return;
+
+  m_loader = new tpConfigLoader(
+      mgr, job, this,
+      [this](tpConfigLoadResult& result) { OnConfigLoadResult(result); });
+  if (m_loader->Create() != wxTHREAD_NO_ERROR ||
+      m_loader->Run() != wxTHREAD_NO_ERROR) {
+    SKN_LOG(m_parent, "Failed to start config loader thread");
+    delete m_loader;
+    m_loader = nullptr;
+
+    tpConfigLoadResult finished;
+    OnConfigLoadResult(finished);
+  }
+}
+
+void tpConfigDialog::StopLoading() {
+  if (!m_loader) return;
+
+  m_loader->RequestStop();
+  m_loader->Wait();
+  delete m_loader;
+  m_loader = nullptr;
+}
+
+void tpConfigDialog::OnConfigLoadResult(tpConfigLoadResult& result) {
+  auto* mgr = m_parent->m_pSignalKNotesManager;
+  mgr->ApplyConfigLoadResult(result);
+
+  switch (result.kind) {
+    case tpConfigLoadResult::PLUGINS:
+      m_providersLoading = false;
+      if (!result.ok && !mgr->GetAuthToken().IsEmpty()) {
+        SKN_LOG(m_parent, "Config dialog: token invalid → resetting auth");
+        mgr->SetAuthToken("");
+        mgr->ClearAuthRequest();
+        m_parent->SaveConfig();
+        ShowInitialState();
+      }
+      UpdateProviders(mgr->GetDiscoveredProviders());
+      return;
+
+    case tpConfigLoadResult::RESOURCE_SET_LIST:
+      if (!result.ok) return;
+      m_parent->m_availableResourceSets = result.resourceSets;
+      // Neue Resourcesets holt der Loader anschließend
+      for (const auto& rsName : result.resourceSets) {
+        bool known = false;
+        for (const auto& mainRow : m_rsRows)
+          known = known || mainRow.rsName == rsName;
+        if (!known) m_rsLoading.insert(rsName);
+      }
+      break;
+
+    case tpConfigLoadResult::RESOURCE_SET:
+      m_rsLoading.erase(result.resourceSetName);
+      break;
+
+    case tpConfigLoadResult::FINISHED: {
+      bool providersLoading = m_providersLoading;
+      m_providersLoading = false;
+      m_rsLoading.clear();
+      if (m_loader) StopLoading();
+      if (providersLoading) UpdateProviders(mgr->GetDiscoveredProviders());
+      UpdateLoadingLabels();
+      return;
+    }
+  }
+
+  // Neuaufbau nur, wenn etwas dazukam; Eingaben bleiben dabei erhalten
+  std::map<wxString, signalk_notes_opencpn_pi::ResourceSetConfig> configs =
+      GetResourceSetConfigs();
+  if (MergeDiscovered(configs, result))
+    UpdateResourceSetTab(configs);
+  else
+    UpdateLoadingLabels();
+}
+
+void tpConfigDialog::UpdateLoadingLabels() {
+  for (auto& mainRow : m_rsRows)
+    mainRow.loadingLabel->Show(m_rsLoading.count(mainRow.rsName) > 0);
+  m_resourceSetScrollWin->Layout();
+}
+
 void tpConfigDialog::OnMainRSToggled(wxCommandEvent& event) {
   wxCheckBox* mainCheck = dynamic_cast<wxCheckBox*>(event.GetEventObject());
   if (!mainCheck) return;
@@ -1181,6 +1428,9 @@ void tpConfigDialog::OnMainRSToggled(wxCommandEvent& event) {
 
   for (auto& mainRow : m_rsRows) {
     if (mainRow.rsName != rsName) continue;
+    mainRow.refreshCtrl->Enable(enabled);
+    mainRow.priorityCtrl->Enable(enabled);
+    mainRow.maxStaleCtrl->Enable(enabled);
     for (auto& subRow : mainRow.subRows) {
       subRow.enabledCheck->Enable(enabled);
       if (!enabled) {
@@ -1202,6 +1452,9 @@ tpConfigDialog::GetResourceSetConfigs() const {
     signalk_notes_opencpn_pi::ResourceSetConfig cfg;
     cfg.name = mainRow.rsName;
     cfg.enabled = mainRow.enabledCheck->GetValue();
+    cfg.refreshMinutes = mainRow.refreshCtrl->GetValue();
+    cfg.priority = mainRow.priorityCtrl->GetSelection();
+    cfg.maxStaleMinutes = mainRow.maxStaleCtrl->GetValue();
 
     for (auto& subRow : mainRow.subRows) {
       signalk_notes_opencpn_pi::SubResourceSetConfig subCfg;
@@ -1217,4 +1470,166 @@ tpConfigDialog::GetResourceSetConfigs() const {
   }
 
   return result;
-}
\ No newline at end of file
+}
+
+void tpConfigDialog::CreateOfflineTab() {
+  wxPanel* offlinePanel = new wxPanel(m_notebook);
+  wxBoxSizer* offlineSizer = new wxBoxSizer(wxVERTICAL);
+
+  offlineSizer->Add(
+      new wxStaticText(
+          offlinePanel, wxID_ANY,
+          _("Download notes and enabled resource sets of an area, so they "
+            "are shown when the SignalK server cannot be reached.")),
+      0, wxALL, 5);
+
+  wxFlexGridSizer* areaSizer = new wxFlexGridSizer(2, 5, 5);
+  areaSizer->Add(new wxStaticText(offlinePanel, wxID_ANY, _("Area")), 0,
+                 wxALIGN_CENTER_VERTICAL);
+  m_offlineAreaChoice = new wxChoice(offlinePanel, wxID_ANY);
+  m_offlineAreaChoice->Append(_("Visible chart area"));
+  m_offlineRouteGuids.Add(wxEmptyString);
+
+  wxArrayString routeGuids = GetRouteGUIDArray();
+  for (const auto& guid : routeGuids) {
+    std::unique_ptr<PlugIn_Route> route = GetRoute_Plugin(guid);
+    if (!route) continue;
+    wxString name = route->m_NameString;
+    if (name.IsEmpty()) name = _("Unnamed route");
+    m_offlineAreaChoice->Append(wxString::Format(_("Route: %s"), name));
+    m_offlineRouteGuids.Add(guid);
+  }
+  m_offlineAreaChoice->SetSelection(0);
+  areaSizer->Add(m_offlineAreaChoice, 1, wxEXPAND);
+
+  areaSizer->Add(new wxStaticText(offlinePanel, wxID_ANY,
+                                  _("Corridor along route (NM each side)")),
+                 0, wxALIGN_CENTER_VERTICAL);
+  m_offlineCorridorCtrl = new wxSpinCtrl(offlinePanel, wxID_ANY);
+  m_offlineCorridorCtrl->SetRange(1, 50);
+  m_offlineCorridorCtrl->SetValue(5);
+  areaSizer->Add(m_offlineCorridorCtrl, 0);
+  areaSizer->AddGrowableCol(1, 1);
+  offlineSizer->Add(areaSizer, 0, wxALL | wxEXPAND, 5);
+
+  wxBoxSizer* offlineButtonSizer = new wxBoxSizer(wxHORIZONTAL);
+  wxButton* downloadButton =
+      new wxButton(offlinePanel, wxID_ANY, _("Download"));
+  downloadButton->Bind(wxEVT_BUTTON, &tpConfigDialog::OnOfflineDownload, this);
+  offlineButtonSizer->Add(downloadButton, 0, wxALL, 5);
+
+  m_offlineResumeButton = new wxButton(offlinePanel, wxID_ANY, _("Resume"));
+  m_offlineResumeButton->Bind(wxEVT_BUTTON, &tpConfigDialog::OnOfflineResume,
+                              this);
+  offlineButtonSizer->Add(m_offlineResumeButton, 0, wxALL, 5);
+
+  m_offlineStopButton = new wxButton(offlinePanel, wxID_ANY, _("Stop"));
+  m_offlineStopButton->Bind(wxEVT_BUTTON, &tpConfigDialog::OnOfflineStop,
+                            this);
+  offlineButtonSizer->Add(m_offlineStopButton, 0, wxALL, 5);
+
+  offlineButtonSizer->AddStretchSpacer();
+  wxButton* clearButton =
+      new wxButton(offlinePanel, wxID_ANY, _("Delete offline data"));
+  clearButton->Bind(wxEVT_BUTTON, &tpConfigDialog::OnOfflineClear, this);
+  offlineButtonSizer->Add(clearButton, 0, wxALL, 5);
+  offlineSizer->Add(offlineButtonSizer, 0, wxEXPAND);
+
+  m_offlineGauge = new wxGauge(offlinePanel, wxID_ANY, 100);
+  offlineSizer->Add(m_offlineGauge, 0, wxALL | wxEXPAND, 5);
+  m_offlineStatusLabel =
+      new wxStaticText(offlinePanel, wxID_ANY, wxEmptyString);
+  m_offlineStatusLabel->SetMinSize(wxSize(-1, 45));
+  offlineSizer->Add(m_offlineStatusLabel, 0, wxALL | wxEXPAND, 5);
+
+  offlinePanel->SetSizer(offlineSizer);
+  m_notebook->AddPage(offlinePanel, _("Offline"));
+}
+
+void tpConfigDialog::UpdateOfflineStatus() {
+  if (!m_offlineStatusLabel) return;
+
+  tpOfflineStatus status;
+  m_parent->m_pSignalKNotesManager->GetOfflineStatus(status);
+
+  wxString text;
+  if (status.running) {
+    m_offlineGauge->SetRange(std::max(1, (int)status.total));
+    m_offlineGauge->SetValue((int)(status.done + status.failed));
+    text = wxString::Format(_("Downloading: %d of %d done, %d failed"),
+                            (int)status.done, (int)status.total,
+                            (int)status.failed);
+  } else {
+    m_offlineGauge->SetValue(0);
+    text = status.unfinished ? _("Download not finished, it can be resumed.")
+                             : _("No download running.");
+  }
+  text += "\n";
+  text += wxString::Format(
+      _("Stored: %d tiles, %d resource sets, %.1f MB"), (int)status.tiles,
+      (int)status.resourceSets, status.sizeBytes / (1024.0 * 1024.0));
+  if (text != m_offlineStatusLabel->GetLabel())
+    m_offlineStatusLabel->SetLabel(text);
+
+  m_offlineResumeButton->Enable(status.unfinished);
+  m_offlineStopButton->Enable(status.running);
+}
+
+void tpConfigDialog::OnOfflineDownload(wxCommandEvent& event) {
+  std::set<wxString> tiles;
+  int selection = m_offlineAreaChoice->GetSelection();
+
+  if (selection <= 0) {
+    auto it = m_parent->m_canvasStates.find(m_parent->m_activeCanvasIndex);
+    if (it == m_parent->m_canvasStates.end() || !it->second.valid) {
+      wxMessageBox(_("No chart area available yet."), _("Offline"),
+                   wxOK | wxICON_INFORMATION);
+      return;
+    }
+    const PlugIn_ViewPort& vp = it->second.viewPort;
+    tpOfflineStore::TilesForArea(vp.lat_min, vp.lat_max, vp.lon_min,
+                                 vp.lon_max, tiles);
+  } else {
+    std::unique_ptr<PlugIn_Route> route =
+        GetRoute_Plugin(m_offlineRouteGuids[selection]);
+    if (!route || !route->pWaypointList) return;
+
+    std::vector<std::pair<double, double>> points;
+    for (auto node = route->pWaypointList->GetFirst(); node;
+         node = node->GetNext()) {
+      PlugIn_Waypoint* wp = node->GetData();
+      points.push_back(std::make_pair(wp->m_lat, wp->m_lon));
+    }
+    tpOfflineStore::TilesForRoute(
+        points, m_offlineCorridorCtrl->GetValue() * 1852.0, tiles);
+  }
+
+  if (tiles.size() > tpOfflineStore::MAX_REGION_TILES) {
+    wxMessageBox(_("The area is too large for an offline download."),
+                 _("Offline"), wxOK | wxICON_WARNING);
+    return;
+  }
+  if (!m_parent->m_pSignalKNotesManager->StartOfflineDownload(tiles)) {
+    wxMessageBox(_("The offline download could not be started."),
+                 _("Offline"), wxOK | wxICON_ERROR);
+  }
+  UpdateOfflineStatus();
+}
+
+void tpConfigDialog::OnOfflineResume(wxCommandEvent& event) {
+  m_parent->m_pSignalKNotesManager->ResumeOfflineDownload();
+  UpdateOfflineStatus();
+}
+
+void tpConfigDialog::OnOfflineStop(wxCommandEvent& event) {
+  m_parent->m_pSignalKNotesManager->StopOfflineDownload();
+  UpdateOfflineStatus();
+}
+
+void tpConfigDialog::OnOfflineClear(wxCommandEvent& event) {
+  if (wxMessageBox(_("Delete all offline data?"), _("Offline"),
+                   wxYES_NO | wxICON_QUESTION) != wxYES)
+    return;
+  m_parent->m_pSignalKNotesManager->ClearOfflineStore();
+  UpdateOfflineStatus();
+}
@@ -0,0 +1,63 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Background requests of the configuration dialog
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "ocpn_plugin.h"
+#include "signalk_notes_opencpn_pi.h"
+#include "tpConfigLoader.h"
+
+#include <memory>
+
+tpConfigLoader::tpConfigLoader(tpSignalKNotesManager* manager,
+                               const tpConfigLoadJob& job,
+                               wxEvtHandler* target, const ResultFn& onResult)
+    : wxThread(wxTHREAD_JOINABLE),
+      m_manager(manager),
+      m_job(job),
+      m_target(target),
+      m_onResult(onResult) {
+  // Eigene Kopien, wxString ist nicht threadsicher
+  m_job.server.host = job.server.host.Clone();
+  m_job.authToken = job.authToken.Clone();
+  m_http.SetGovernor(manager->GetGovernor());
+}
+
+void tpConfigLoader::RequestStop() {
+  wxMutexLocker lock(m_mutex);
+  m_stopRequested = true;
+}
+
+bool tpConfigLoader::IsStopRequested() {
+  wxMutexLocker lock(m_mutex);
+  return m_stopRequested;
+}
+
+void tpConfigLoader::Post(tpConfigLoadResult& result) {
+  if (IsStopRequested()) return;
+
+  std::shared_ptr<tpConfigLoadResult> shared(new tpConfigLoadResult());
+  std::swap(*shared, result);
+  ResultFn onResult = m_onResult;
+  m_target->CallAfter([onResult, shared]() { onResult(*shared); });
+}
+
+wxThread::ExitCode tpConfigLoader::Entry() {
+  SKN_LOG(m_manager->GetPlugin(), "Config dialog: loading from %s",
+          m_job.server.GetId());
+
+  m_manager->LoadConfigData(
+      m_http, m_job, [this]() { return IsStopRequested(); },
+      [this](tpConfigLoadResult& result) { Post(result); });
+
+  tpConfigLoadResult finished;
+  Post(finished);
+  return (ExitCode)0;
+}
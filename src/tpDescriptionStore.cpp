@@ -0,0 +1,180 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Compressed storage for resourceset note descriptions
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "tpDescriptionStore.h"
+#include "tpWarmStartFile.h"
+
+#include <wx/mstream.h>
+#include <wx/zstream.h>
+
+// Mehr packt deflate nicht zusammen
+static const uint64_t MAX_DEFLATE_RATIO = 1032;
+
+uint32_t tpDescriptionStore::Add(const std::string& utf8) {
+  if (utf8.empty()) return 0;
+
+  if (!m_pending.empty() && m_pending.size() + utf8.size() > CHUNK_SIZE)
+    FlushChunk();
+
+  Entry entry;
+  entry.chunk = (uint32_t)m_chunks.size();
+  entry.offset = (uint32_t)m_pending.size();
+  entry.length = (uint32_t)utf8.size();
+  m_entries.push_back(entry);
+
+  m_pending += utf8;
+  m_rawBytes += utf8.size();
+  return (uint32_t)m_entries.size();
+}
+
+void tpDescriptionStore::Finish() {
+  if (!m_pending.empty()) FlushChunk();
+  m_entries.shrink_to_fit();
+  m_chunks.shrink_to_fit();
+}
+
+void tpDescriptionStore::FlushChunk() {
+  wxMemoryOutputStream mem;
+  {
+    wxZlibOutputStream zlib(mem, wxZ_BEST_SPEED, wxZLIB_NO_HEADER);
+    zlib.Write(m_pending.data(), m_pending.size());
+    zlib.Close();
+  }
+
+  std::string chunk(mem.GetLength(), '\0');
+  if (!chunk.empty()) mem.CopyTo(&chunk[0], chunk.size());
+  m_chunks.push_back(std::move(chunk));
+
+  // Puffer freigeben, nicht nur leeren
+  std::string().swap(m_pending);
+}
+
+std::string tpDescriptionStore::Get(uint32_t ref) const {
+  if (ref == 0 || ref > m_entries.size()) return std::string();
+  const Entry& entry = m_entries[ref - 1];
+  if (entry.chunk >= m_chunks.size()) return std::string();
+
+  const std::string& chunk = m_chunks[entry.chunk];
+  wxMemoryInputStream mem(chunk.data(), chunk.size());
+  wxZlibInputStream zlib(mem, wxZLIB_NO_HEADER);
+
+  // Nur bis zum Ende dieses Eintrags entpacken
+  std::string raw((size_t)entry.offset + entry.length, '\0');
+  if (!zlib.ReadAll(&raw[0], raw.size())) return std::string();
+  return raw.substr(entry.offset);
+}
+
+std::vector<uint32_t> tpDescriptionStore::AddFrom(
+    const tpDescriptionStore& source, const std::vector<uint32_t>& refs) {
+  std::vector<uint32_t> added;
+  added.reserve(refs.size());
+  size_t chunkIndex = source.m_chunks.size();
+  std::string raw;
+
+  for (size_t i = 0; i < refs.size(); i++) {
+    if (refs[i] == 0 || refs[i] > source.m_entries.size()) {
+      added.push_back(0);
+      continue;
+    }
+    const Entry& entry = source.m_entries[refs[i] - 1];
+    if (entry.chunk >= source.m_chunks.size()) {
+      added.push_back(0);
+      continue;
+    }
+
+    if (entry.chunk != chunkIndex) {
+      // Block bis zum letzten Eintrag entpacken, der aus ihm gebraucht wird
+      chunkIndex = entry.chunk;
+      size_t end = (size_t)entry.offset + entry.length;
+      for (size_t j = i + 1;
+           j < refs.size() && refs[j] <= source.m_entries.size(); j++) {
+        const Entry& next = source.m_entries[refs[j] - 1];
+        if (next.chunk != chunkIndex) break;
+        end = (size_t)next.offset + next.length;
+      }
+
+      const std::string& chunk = source.m_chunks[chunkIndex];
+      wxMemoryInputStream mem(chunk.data(), chunk.size());
+      wxZlibInputStream zlib(mem, wxZLIB_NO_HEADER);
+      raw.assign(end, '\0');
+      if (!zlib.ReadAll(&raw[0], raw.size())) raw.clear();
+    }
+
+    if ((size_t)entry.offset + entry.length > raw.size()) {
+      added.push_back(0);
+      continue;
+    }
+    added.push_back(Add(raw.substr(entry.offset, entry.length)));
+  }
+  return added;
+}
+
+void tpDescriptionStore::Write(tpBinaryWriter& out) const {
+  out.Put((uint64_t)m_rawBytes);
+  out.Put((uint32_t)m_entries.size());
+  for (const auto& entry : m_entries) {
+    out.Put(entry.chunk);
+    out.Put(entry.offset);
+    out.Put(entry.length);
+  }
+  out.Put((uint32_t)m_chunks.size());
+  for (const auto& chunk : m_chunks) out.PutString(chunk);
+}
+
+bool tpDescriptionStore::Read(tpBinaryReader& in) {
+  m_rawBytes = (size_t)in.Get<uint64_t>();
+  m_entries.resize(in.GetCount(3 * sizeof(uint32_t)));
+  for (auto& entry : m_entries) {
+    entry.chunk = in.Get<uint32_t>();
+    entry.offset = in.Get<uint32_t>();
+    entry.length = in.Get<uint32_t>();
+  }
+  m_chunks.resize(in.GetCount(sizeof(uint32_t)));
+  for (auto& chunk : m_chunks) chunk = in.GetString();
+  m_pending.clear();
+  if (!in.IsOk()) return false;
+
+  // Kein Eintrag darf über seinen Block hinaus zeigen, sonst würde Get()
+  // beim Klick auf die Note Gigabytes anfordern. Über CHUNK_SIZE geht nur
+  // ein einzelner langer Text, der allein im Block steht.
+  for (const auto& entry : m_entries) {
+    if (entry.chunk >= m_chunks.size()) return false;
+    uint64_t end = (uint64_t)entry.offset + entry.length;
+    if (end <= CHUNK_SIZE) continue;
+    if (entry.offset != 0 ||
+        end > m_chunks[entry.chunk].size() * MAX_DEFLATE_RATIO)
+      return false;
+  }
+  return true;
+}
+
+size_t tpDescriptionStore::GetCompressedBytes() const {
+  size_t bytes = 0;
+  for (const auto& chunk : m_chunks) bytes += chunk.size();
+  return bytes;
+}
+
+size_t tpDescriptionStore::GetAllocations() const {
+  size_t count = m_chunks.size();
+  if (m_entries.capacity() > 0) count++;
+  if (m_chunks.capacity() > 0) count++;
+  if (!m_pending.empty()) count++;
+  return count;
+}
+
+size_t tpDescriptionStore::GetMemoryUsage() const {
+  size_t bytes = m_entries.capacity() * sizeof(Entry) +
+                 m_chunks.capacity() * sizeof(std::string) +
+                 m_pending.capacity();
+  for (const auto& chunk : m_chunks) bytes += chunk.capacity();
+  return bytes;
+}
@@ -0,0 +1,115 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Background worker thread for SignalK note fetching
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "ocpn_plugin.h"
+#include "signalk_notes_opencpn_pi.h"
+#include "tpSignalKNotes.h"
+#include "tpFetchWorker.h"
+
+tpFetchWorker::tpFetchWorker(tpSignalKNotesManager* manager)
+    : wxThread(wxTHREAD_JOINABLE), m_manager(manager), m_cond(m_mutex) {
+  m_http.SetGovernor(manager->GetGovernor());
+}
+
+void tpFetchWorker::Post(const tpFetchRequest& request) {
+  wxMutexLocker lock(m_mutex);
+
+  if (request.prefetch) {
+    // Low priority: never queued in place of or next to a real fetch
+    for (const auto& pending : m_pending) {
+      if (pending.canvasIndex == request.canvasIndex) return;
+    }
+    m_pending.push_back(request);
+    m_cond.Signal();
+    return;
+  }
+
+  if (request.fetchNotesList)
+    m_latestGeneration[request.canvasIndex] = request.viewportGeneration;
+
+  for (auto& pending : m_pending) {
+    if (pending.canvasIndex != request.canvasIndex) continue;
+
+    if (pending.prefetch) {
+      pending = request;
+      m_cond.Signal();
+      return;
+    }
+
+    // Newer viewport replaces the queued one, but a notes list or
+    // resourceset refresh that is still due must not get lost on the way.
+    bool fetchNotesList = pending.fetchNotesList || request.fetchNotesList;
+    bool fetchResourceSets =
+        pending.fetchResourceSets || request.fetchResourceSets;
+    std::map<wxString, signalk_notes_opencpn_pi::ResourceSetConfig> sets;
+    sets.swap(pending.resourceSets);
+    for (const auto& rsKv : request.resourceSets) sets[rsKv.first] = rsKv.second;
+
+    // A resourceset-only request carries no viewport
+    if (request.fetchNotesList || !pending.fetchNotesList) pending = request;
+    pending.fetchNotesList = fetchNotesList;
+    pending.fetchResourceSets = fetchResourceSets;
+    pending.resourceSets.swap(sets);
+    m_cond.Signal();
+    return;
+  }
+
+  m_pending.push_back(request);
+  m_cond.Signal();
+}
+
+bool tpFetchWorker::IsSuperseded(const tpFetchRequest& request) {
+  if (!request.fetchNotesList) return false;
+
+  wxMutexLocker lock(m_mutex);
+  if (m_stopRequested) return true;
+  auto it = m_latestGeneration.find(request.canvasIndex);
+  return it != m_latestGeneration.end() &&
+         it->second > request.viewportGeneration;
+}
+
+bool tpFetchWorker::IsIdle() {
+  wxMutexLocker lock(m_mutex);
+  return !m_busy && m_pending.empty();
+}
+
+void tpFetchWorker::RequestStop() {
+  wxMutexLocker lock(m_mutex);
+  m_stopRequested = true;
+  m_pending.clear();
+  m_cond.Broadcast();
+}
+
+wxThread::ExitCode tpFetchWorker::Entry() {
+  while (true) {
+    tpFetchRequest request;
+    {
+      wxMutexLocker lock(m_mutex);
+      while (!m_stopRequested && m_pending.empty()) m_cond.Wait();
+      if (m_stopRequested) break;
+
+      request = m_pending.front();
+      m_pending.erase(m_pending.begin());
+      m_busy = true;
+    }
+
+    tpFetchResult result;
+    m_manager->ExecuteFetch(m_http, request, result,
+                            [&]() { return IsSuperseded(request); });
+    m_manager->PublishFetchResult(result);
+
+    wxMutexLocker lock(m_mutex);
+    m_busy = false;
+  }
+
+  return (ExitCode)0;
+}
@@ -0,0 +1,924 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Pooled HTTP transport for all SignalK server requests
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "tpHttpClient.h"
+#include "tpRequestGovernor.h"
+
+#include <wx/stopwatch.h>
+#include <wx/utils.h>
+
+#include <algorithm>
+#include <cstdint>
+
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+
+// FNV-1a, 64 bit, fortlaufend über alle Teile des Bodys
+static uint64_t HashUpdate(uint64_t hash, const char* data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    hash ^= (unsigned char)data[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// Nimmt dekodierte Body-Bytes entgegen: bei einer 2xx-Antwort direkt an
+// onData, sonst (Fehlertext) in body
+static bool DeliverBody(tpHttpRequest& request, const char* data,
+                        size_t size) {
+  request.bodyBytes += size;
+  request.bodyHash = HashUpdate(request.bodyHash, data, size);
+
+  if (request.onData && !request.deferData && request.status >= 200 &&
+      request.status < 300)
+    return request.onData(data, size);
+
+  request.body.append(data, size);
+  return true;
+}
+
+// Bricht eine Anfrage ab, deren Ergebnis niemand mehr braucht
+static bool CancelIfRequested(tpHttpRequest& request) {
+  if (!request.isCancelled || !request.isCancelled()) return false;
+  request.status = 0;
+  request.error = "Cancelled";
+  request.cancelled = true;
+  return true;
+}
+
+#ifdef TP_HTTP_USE_CURL
+
+#include <curl/curl.h>
+
+// Process wide curl state shared by all clients: DNS and TLS session caches.
+// Connections are deliberately not shared - libcurl does not support sharing
+// the connection cache between concurrently running threads, so each client
+// keeps its own in its multi handle.
+struct tpCurlShared {
+  CURLSH* share = nullptr;
+  int users = 0;
+  wxMutex locks[CURL_LOCK_DATA_LAST];
+};
+
+static tpCurlShared& CurlShared() {
+  static tpCurlShared s_shared;
+  return s_shared;
+}
+
+static wxMutex& CurlSharedInitMutex() {
+  static wxMutex s_mutex;
+  return s_mutex;
+}
+
+static void CurlShareLock(CURL*, curl_lock_data data, curl_lock_access,
+                          void* userptr) {
+  static_cast<tpCurlShared*>(userptr)->locks[data].Lock();
+}
+
+static void CurlShareUnlock(CURL*, curl_lock_data data, void* userptr) {
+  static_cast<tpCurlShared*>(userptr)->locks[data].Unlock();
+}
+
+static size_t CurlWriteCallback(void* contents, size_t size, size_t nmemb,
+                                void* userp) {
+  size_t total = size * nmemb;
+  tpHttpRequest* request = static_cast<tpHttpRequest*>(userp);
+  // Weniger als total zurückgeben bricht den Transfer ab
+  if (!DeliverBody(*request, static_cast<char*>(contents), total)) return 0;
+  return total;
+}
+
+// Picks the validators out of the response headers
+static size_t CurlHeaderCallback(char* buffer, size_t size, size_t nitems,
+                                 void* userp) {
+  size_t total = size * nitems;
+  tpHttpRequest* request = static_cast<tpHttpRequest*>(userp);
+
+  wxString line = wxString::FromUTF8(buffer, total);
+  if (line.StartsWith("HTTP/")) {
+    // Neue Antwort (z.B. nach Redirect) - alte Validatoren verwerfen. Der
+    // Status entscheidet, ob der Body gestreamt wird.
+    request->etag.Clear();
+    request->lastModified.Clear();
+    long status = 0;
+    if (line.AfterFirst(' ').BeforeFirst(' ').ToLong(&status))
+      request->status = status;
+    return total;
+  }
+
+  wxString name = line.BeforeFirst(':').Trim().Lower();
+  wxString value = line.AfterFirst(':').Trim(false).Trim();
+  if (name == "etag")
+    request->etag = value;
+  else if (name == "last-modified")
+    request->lastModified = value;
+
+  return total;
+}
+
+static const size_t MAX_IDLE_HANDLES = 8;
+static const long MAX_HOST_CONNECTIONS = 4;
+
+tpHttpClient::tpHttpClient() {
+  {
+    wxMutexLocker lock(CurlSharedInitMutex());
+    tpCurlShared& shared = CurlShared();
+    if (shared.users++ == 0) {
+      curl_global_init(CURL_GLOBAL_DEFAULT);
+      shared.share = curl_share_init();
+      if (shared.share) {
+        curl_share_setopt(shared.share, CURLSHOPT_LOCKFUNC, CurlShareLock);
+        curl_share_setopt(shared.share, CURLSHOPT_UNLOCKFUNC, CurlShareUnlock);
+        curl_share_setopt(shared.share, CURLSHOPT_USERDATA, &shared);
+        curl_share_setopt(shared.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(shared.share, CURLSHOPT_SHARE,
+                          CURL_LOCK_DATA_SSL_SESSION);
+      }
+    }
+  }
+
+  CURLM* multi = curl_multi_init();
+  if (multi) {
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+                      MAX_HOST_CONNECTIONS);
+  }
+  m_multi = multi;
+}
+
+tpHttpClient::~tpHttpClient() {
+  for (void* handle : m_idleHandles) curl_easy_cleanup((CURL*)handle);
+  m_idleHandles.clear();
+
+  if (m_multi) curl_multi_cleanup((CURLM*)m_multi);
+  m_multi = nullptr;
+
+  wxMutexLocker lock(CurlSharedInitMutex());
+  tpCurlShared& shared = CurlShared();
+  if (--shared.users == 0) {
+    if (shared.share) curl_share_cleanup(shared.share);
+    shared.share = nullptr;
+    curl_global_cleanup();
+  }
+}
+
+void* tpHttpClient::AcquireHandle() {
+  if (!m_idleHandles.empty()) {
+    CURL* handle = (CURL*)m_idleHandles.back();
+    m_idleHandles.pop_back();
+    curl_easy_reset(handle);
+    return handle;
+  }
+  return curl_easy_init();
+}
+
+void tpHttpClient::ReleaseHandle(void* handle) {
+  if (m_idleHandles.size() < MAX_IDLE_HANDLES)
+    m_idleHandles.push_back(handle);
+  else
+    curl_easy_cleanup((CURL*)handle);
+}
+
+static curl_slist* SetupCurlHandle(CURL* curl, tpHttpRequest& request,
+                                   size_t index) {
+  struct curl_slist* headers = NULL;
+
+  if (!request.authHeader.IsEmpty()) {
+    headers = curl_slist_append(headers, request.authHeader.mb_str().data());
+  }
+  if (!request.ifNoneMatch.IsEmpty()) {
+    headers = curl_slist_append(
+        headers, ("If-None-Match: " + request.ifNoneMatch).mb_str().data());
+  }
+  if (!request.ifModifiedSince.IsEmpty()) {
+    headers = curl_slist_append(
+        headers,
+        ("If-Modified-Since: " + request.ifModifiedSince).mb_str().data());
+  }
+
+  curl_easy_setopt(curl, CURLOPT_URL, request.url.mb_str().data());
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, CurlWriteCallback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &request);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, CurlHeaderCallback);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &request);
+  // Leerer String: alle von libcurl unterstützten Verfahren anbieten
+  // (gzip, deflate und - falls eingebaut - br)
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+  // Kein Limit für die ganze Übertragung - ein großes Resourceset darf
+  // dauern, solange Daten fließen. Abgebrochen wird, wenn der Verbindungs-
+  // aufbau oder der Server für timeoutSecs hängt.
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, request.timeoutSecs);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, request.timeoutSecs);
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+  curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, (void*)(uintptr_t)index);
+
+  tpCurlShared& shared = CurlShared();
+  if (shared.share) curl_easy_setopt(curl, CURLOPT_SHARE, shared.share);
+
+  if (!request.postBody.empty()) {
+    wxString contentType = request.contentType.IsEmpty()
+                               ? wxString("application/json")
+                               : request.contentType;
+    headers = curl_slist_append(
+        headers, ("Content-Type: " + contentType).mb_str().data());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE,
+                     (long)request.postBody.size());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request.postBody.data());
+  }
+
+  if (headers) curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  return headers;
+}
+
+void tpHttpClient::PerformBatch(std::vector<tpHttpRequest>& requests,
+                                const CompletionFn& onDone) {
+  CURLM* multi = (CURLM*)m_multi;
+
+  std::vector<CURL*> handles(requests.size(), nullptr);
+  std::vector<curl_slist*> headers(requests.size(), nullptr);
+  size_t active = 0;
+
+  for (size_t i = 0; i < requests.size(); i++) {
+    tpHttpRequest& request = requests[i];
+    request.status = 0;
+    request.error.Clear();
+    request.body.clear();
+
+    if (CancelIfRequested(request)) {
+      if (onDone) onDone(i, request);
+      continue;
+    }
+
+    CURL* curl = multi ? (CURL*)AcquireHandle() : nullptr;
+    if (!curl) {
+      request.status = -1;
+      request.error = "curl_easy_init failed";
+      if (onDone) onDone(i, request);
+      continue;
+    }
+
+    headers[i] = SetupCurlHandle(curl, request, i);
+    curl_multi_add_handle(multi, curl);
+    handles[i] = curl;
+    active++;
+  }
+
+  wxString loopError;
+
+  while (active > 0) {
+    int running = 0;
+    CURLMcode mc = curl_multi_perform(multi, &running);
+    if (mc != CURLM_OK) {
+      loopError = wxString::Format("CURL multi error: %s",
+                                   curl_multi_strerror(mc));
+      break;
+    }
+
+    CURLMsg* msg = nullptr;
+    int msgsLeft = 0;
+    while ((msg = curl_multi_info_read(multi, &msgsLeft)) != nullptr) {
+      if (msg->msg != CURLMSG_DONE) continue;
+
+      CURL* curl = msg->easy_handle;
+      CURLcode res = msg->data.result;
+
+      char* priv = nullptr;
+      curl_easy_getinfo(curl, CURLINFO_PRIVATE, &priv);
+      size_t i = (size_t)(uintptr_t)priv;
+      tpHttpRequest& request = requests[i];
+
+      long httpCode = 0;
+      curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+      request.status = httpCode;
+
+      // Zählt die Body-Bytes vor dem Dekomprimieren
+      curl_off_t wireBytes = 0;
+      if (curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &wireBytes) ==
+          CURLE_OK)
+        request.wireBytes = (long long)wireBytes;
+      curl_off_t totalUs = 0;
+      if (curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &totalUs) == CURLE_OK)
+        request.elapsedMs = (long)(totalUs / 1000);
+      curl_off_t firstByteUs = 0;
+      if (curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T,
+                            &firstByteUs) == CURLE_OK)
+        request.firstByteMs = (long)(firstByteUs / 1000);
+      if (res != CURLE_OK) {
+        request.error =
+            wxString::Format("CURL error: %s", curl_easy_strerror(res));
+      } else if (httpCode < 200 || httpCode >= 300) {
+        request.error = wxString::Format("HTTP error %ld", httpCode);
+      }
+
+      curl_multi_remove_handle(multi, curl);
+      curl_slist_free_all(headers[i]);
+      headers[i] = nullptr;
+      ReleaseHandle(curl);
+      handles[i] = nullptr;
+      active--;
+
+      if (onDone) onDone(i, request);
+    }
+
+    // Überholte Transfers aus dem Multi-Handle nehmen, curl schließt dabei
+    // nur deren Verbindung
+    for (size_t i = 0; i < requests.size(); i++) {
+      if (!handles[i] || !CancelIfRequested(requests[i])) continue;
+
+      curl_multi_remove_handle(multi, handles[i]);
+      curl_slist_free_all(headers[i]);
+      headers[i] = nullptr;
+      ReleaseHandle(handles[i]);
+      handles[i] = nullptr;
+      active--;
+
+      if (onDone) onDone(i, requests[i]);
+    }
+
+    if (active == 0) break;
+
+    mc = curl_multi_wait(multi, NULL, 0, 200, NULL);
+    if (mc != CURLM_OK) {
+      loopError = wxString::Format("CURL multi error: %s",
+                                   curl_multi_strerror(mc));
+      break;
+    }
+  }
+
+  // Only reached with transfers left over when the multi loop failed
+  for (size_t i = 0; i < requests.size(); i++) {
+    if (!handles[i]) continue;
+    curl_multi_remove_handle(multi, handles[i]);
+    curl_slist_free_all(headers[i]);
+    curl_easy_cleanup(handles[i]);
+    requests[i].status = -1;
+    requests[i].error = loopError;
+    if (onDone) onDone(i, requests[i]);
+  }
+}
+
+#endif  // TP_HTTP_USE_CURL
+
+#ifdef _WIN32
+#include <windows.h>
+#include <winhttp.h>
+#pragma comment(lib, "winhttp.lib")
+
+// One WinHTTP session for the whole plugin: WinHTTP pools and reuses the
+// connections of a session, so keeping it open gives keep-alive for free.
+static HINTERNET s_winHttpSession = NULL;
+static int s_winHttpUsers = 0;
+
+static wxMutex& WinHttpSessionMutex() {
+  static wxMutex s_mutex;
+  return s_mutex;
+}
+
+tpHttpClient::tpHttpClient() {
+  wxMutexLocker lock(WinHttpSessionMutex());
+  if (s_winHttpUsers++ == 0) {
+    s_winHttpSession =
+        WinHttpOpen(L"SignalKNotes/1.0", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+                    WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
+    if (s_winHttpSession) {
+      // WinHTTP sendet dann Accept-Encoding selbst und dekomprimiert
+      // transparent (ab Windows 8.1, ältere Systeme ignorieren die Option)
+      DWORD decompression = WINHTTP_DECOMPRESSION_FLAG_ALL;
+      WinHttpSetOption(s_winHttpSession, WINHTTP_OPTION_DECOMPRESSION,
+                       &decompression, sizeof(decompression));
+    }
+  }
+}
+
+tpHttpClient::~tpHttpClient() {
+  wxMutexLocker lock(WinHttpSessionMutex());
+  if (--s_winHttpUsers == 0 && s_winHttpSession) {
+    WinHttpCloseHandle(s_winHttpSession);
+    s_winHttpSession = NULL;
+  }
+}
+
+static wxString WinHttpQueryString(HINTERNET hRequest, DWORD query) {
+  wchar_t buffer[512];
+  DWORD size = sizeof(buffer);
+  if (!WinHttpQueryHeaders(hRequest, query, WINHTTP_HEADER_NAME_BY_INDEX,
+                           buffer, &size, WINHTTP_NO_HEADER_INDEX))
+    return wxEmptyString;
+  return wxString(buffer, size / sizeof(wchar_t));
+}
+
+static void WinHttpExecute(tpHttpRequest& request) {
+  wxStopWatch watch;
+  URL_COMPONENTS uc = {0};
+  uc.dwStructSize = sizeof(uc);
+
+  wchar_t host[256];
+  wchar_t path[2048];
+
+  uc.lpszHostName = host;
+  uc.dwHostNameLength = 256;
+  uc.lpszUrlPath = path;
+  uc.dwUrlPathLength = 2048;
+
+  if (!WinHttpCrackUrl(request.url.wc_str(), 0, 0, &uc)) {
+    request.status = -1;
+    request.error = "WinHttpCrackUrl failed";
+    return;
+  }
+
+  if (!s_winHttpSession) {
+    request.status = -1;
+    request.error = "WinHttpOpen failed";
+    return;
+  }
+
+  DWORD timeoutMs = (DWORD)(request.timeoutSecs * 1000);
+
+  HINTERNET hConnect =
+      WinHttpConnect(s_winHttpSession, uc.lpszHostName, uc.nPort, 0);
+  if (!hConnect) {
+    request.status = -1;
+    request.error = "WinHttpConnect failed";
+    return;
+  }
+
+  bool isPost = !request.postBody.empty();
+  HINTERNET hRequest = WinHttpOpenRequest(
+      hConnect, isPost ? L"POST" : L"GET", uc.lpszUrlPath, NULL,
+      WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES,
+      (uc.nScheme == INTERNET_SCHEME_HTTPS) ? WINHTTP_FLAG_SECURE : 0);
+
+  if (!hRequest) {
+    request.status = -1;
+    request.error = "WinHttpOpenRequest failed";
+    WinHttpCloseHandle(hConnect);
+    return;
+  }
+
+  WinHttpSetTimeouts(hRequest, timeoutMs, timeoutMs, timeoutMs, timeoutMs);
+
+  if (!request.authHeader.IsEmpty()) {
+    std::wstring hdr = std::wstring(request.authHeader.wc_str());
+    WinHttpAddRequestHeaders(
+        hRequest, hdr.c_str(), (DWORD)-1,
+        WINHTTP_ADDREQ_FLAG_ADD | WINHTTP_ADDREQ_FLAG_REPLACE);
+  }
+
+  if (isPost) {
+    wxString contentType = request.contentType.IsEmpty()
+                               ? wxString("application/json")
+                               : request.contentType;
+    std::wstring hdr =
+        std::wstring(("Content-Type: " + contentType).wc_str());
+    WinHttpAddRequestHeaders(
+        hRequest, hdr.c_str(), (DWORD)-1,
+        WINHTTP_ADDREQ_FLAG_ADD | WINHTTP_ADDREQ_FLAG_REPLACE);
+  }
+
+  if (!request.ifNoneMatch.IsEmpty()) {
+    std::wstring hdr =
+        std::wstring(("If-None-Match: " + request.ifNoneMatch).wc_str());
+    WinHttpAddRequestHeaders(
+        hRequest, hdr.c_str(), (DWORD)-1,
+        WINHTTP_ADDREQ_FLAG_ADD | WINHTTP_ADDREQ_FLAG_REPLACE);
+  }
+  if (!request.ifModifiedSince.IsEmpty()) {
+    std::wstring hdr = std::wstring(
+        ("If-Modified-Since: " + request.ifModifiedSince).wc_str());
+    WinHttpAddRequestHeaders(
+        hRequest, hdr.c_str(), (DWORD)-1,
+        WINHTTP_ADDREQ_FLAG_ADD | WINHTTP_ADDREQ_FLAG_REPLACE);
+  }
+
+  BOOL sent =
+      isPost ? WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0,
+                                  (LPVOID)request.postBody.data(),
+                                  (DWORD)request.postBody.size(),
+                                  (DWORD)request.postBody.size(), 0)
+             : WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0,
+                                  WINHTTP_NO_REQUEST_DATA, 0, 0, 0);
+
+  if (!sent) {
+    request.status = -1;
+    request.error = "WinHttpSendRequest failed";
+    WinHttpCloseHandle(hRequest);
+    WinHttpCloseHandle(hConnect);
+    return;
+  }
+
+  if (!WinHttpReceiveResponse(hRequest, NULL)) {
+    request.status = -1;
+    request.error = "WinHttpReceiveResponse failed";
+    WinHttpCloseHandle(hRequest);
+    WinHttpCloseHandle(hConnect);
+    return;
+  }
+  request.firstByteMs = watch.Time();
+
+  DWORD status = 0;
+  DWORD size = sizeof(status);
+
+  if (!WinHttpQueryHeaders(
+          hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+          WINHTTP_HEADER_NAME_BY_INDEX, &status, &size,
+          WINHTTP_NO_HEADER_INDEX)) {
+    request.status = -1;
+    request.error = "WinHttpQueryHeaders failed";
+    WinHttpCloseHandle(hRequest);
+    WinHttpCloseHandle(hConnect);
+    return;
+  }
+
+  request.status = status;
+  request.etag = WinHttpQueryString(hRequest, WINHTTP_QUERY_ETAG);
+
+  // Bei komprimierter Antwort ist Content-Length die Größe auf der Leitung
+  DWORD contentLength = 0;
+  size = sizeof(contentLength);
+  if (WinHttpQueryHeaders(
+          hRequest, WINHTTP_QUERY_CONTENT_LENGTH | WINHTTP_QUERY_FLAG_NUMBER,
+          WINHTTP_HEADER_NAME_BY_INDEX, &contentLength, &size,
+          WINHTTP_NO_HEADER_INDEX))
+    request.wireBytes = contentLength;
+  request.lastModified =
+      WinHttpQueryString(hRequest, WINHTTP_QUERY_LAST_MODIFIED);
+
+  DWORD bytesAvailable = 0;
+
+  do {
+    if (!WinHttpQueryDataAvailable(hRequest, &bytesAvailable)) break;
+    if (bytesAvailable == 0) break;
+
+    std::vector<char> buffer(bytesAvailable);
+    DWORD bytesRead = 0;
+
+    if (!WinHttpReadData(hRequest, buffer.data(), bytesAvailable, &bytesRead))
+      break;
+
+    if (!DeliverBody(request, buffer.data(), bytesRead)) {
+      request.error = "Response rejected by receiver";
+      break;
+    }
+
+  } while (bytesAvailable > 0);
+
+  WinHttpCloseHandle(hRequest);
+  WinHttpCloseHandle(hConnect);
+
+  if (request.error.IsEmpty() && (status < 200 || status >= 300)) {
+    request.error = wxString::Format("HTTP error %lu", status);
+  }
+}
+
+void tpHttpClient::PerformBatch(std::vector<tpHttpRequest>& requests,
+                                const CompletionFn& onDone) {
+  for (size_t i = 0; i < requests.size(); i++) {
+    requests[i].status = 0;
+    requests[i].error.Clear();
+    requests[i].body.clear();
+    if (CancelIfRequested(requests[i])) {
+      if (onDone) onDone(i, requests[i]);
+      continue;
+    }
+    wxStopWatch watch;
+    WinHttpExecute(requests[i]);
+    requests[i].elapsedMs = watch.Time();
+    if (onDone) onDone(i, requests[i]);
+  }
+}
+
+#endif  // _WIN32
+
+#ifdef __OCPN__ANDROID__
+
+#include <wx/protocol/http.h>
+#include <wx/url.h>
+#include <wx/zstream.h>
+
+// Counts the raw bytes read from the socket, below the zlib decoder
+class tpCountingInputStream : public wxFilterInputStream {
+public:
+  tpCountingInputStream(wxInputStream& stream) : wxFilterInputStream(stream) {}
+  long long GetCount() const { return m_count; }
+
+protected:
+  size_t OnSysRead(void* buffer, size_t size) override {
+    m_parent_i_stream->Read(buffer, size);
+    size_t read = m_parent_i_stream->LastRead();
+    m_count += read;
+    if (read == 0) m_lasterror = m_parent_i_stream->GetLastError();
+    return read;
+  }
+
+private:
+  long long m_count = 0;
+};
+
+tpHttpClient::tpHttpClient() {}
+tpHttpClient::~tpHttpClient() {}
+
+static void WxHttpExecute(tpHttpRequest& request) {
+  wxStopWatch watch;
+  wxHTTP http;
+  http.SetTimeout(request.timeoutSecs);
+
+  wxURL wxurl(request.url);
+  if (wxurl.GetError() != wxURL_NOERR) {
+    request.status = -1;
+    request.error = "wxURL parse error";
+    return;
+  }
+
+  wxString host = wxurl.GetServer();
+  long port = 80;
+  wxurl.GetPort().ToLong(&port);
+  wxString path = "/" + wxurl.GetPath();
+  if (!wxurl.GetQuery().IsEmpty()) path += "?" + wxurl.GetQuery();
+
+  if (!request.authHeader.IsEmpty()) {
+    http.SetHeader("Authorization",
+                   request.authHeader.AfterFirst(' ').AfterFirst(' '));
+  }
+
+  http.SetHeader("Accept-Encoding", "gzip, deflate");
+  if (!request.ifNoneMatch.IsEmpty())
+    http.SetHeader("If-None-Match", request.ifNoneMatch);
+  if (!request.ifModifiedSince.IsEmpty())
+    http.SetHeader("If-Modified-Since", request.ifModifiedSince);
+
+  if (!request.postBody.empty()) {
+    wxMemoryBuffer postData;
+    postData.AppendData(request.postBody.data(), request.postBody.size());
+    http.SetPostBuffer(request.contentType.IsEmpty()
+                           ? wxString("application/json")
+                           : request.contentType,
+                       postData);
+  }
+
+  if (!http.Connect(host, (unsigned short)port)) {
+    request.status = -1;
+    request.error = "HTTP connect failed";
+    return;
+  }
+
+  wxInputStream* in = http.GetInputStream(path);
+  request.firstByteMs = watch.Time();
+  request.etag = http.GetHeader("ETag");
+  request.lastModified = http.GetHeader("Last-Modified");
+  if (!in || !in->IsOk()) {
+    request.status = http.GetResponse();
+    request.error = "HTTP input stream failed";
+    delete in;
+    return;
+  }
+
+  request.status = http.GetResponse();
+
+  // wxHTTP dekomprimiert nicht selbst: gzip/deflate beim Lesen entpacken
+  wxString encoding = http.GetHeader("Content-Encoding").Lower();
+  bool compressed = encoding.Contains("gzip") || encoding.Contains("deflate");
+
+  tpCountingInputStream counted(*in);
+  wxZlibInputStream* unzip =
+      compressed ? new wxZlibInputStream(counted, wxZLIB_AUTO) : nullptr;
+  wxInputStream& source =
+      unzip ? static_cast<wxInputStream&>(*unzip) : counted;
+
+  char buf[4096];
+  while (true) {
+    source.Read(buf, sizeof(buf));
+    size_t read = source.LastRead();
+    if (read == 0) break;
+    if (!DeliverBody(request, buf, read)) {
+      request.error = "Response rejected by receiver";
+      break;
+    }
+  }
+  delete unzip;
+  request.wireBytes = counted.GetCount();
+  delete in;
+
+  if (request.error.IsEmpty() &&
+      (request.status < 200 || request.status >= 300)) {
+    request.error = wxString::Format("HTTP error %ld", request.status);
+  }
+}
+
+void tpHttpClient::PerformBatch(std::vector<tpHttpRequest>& requests,
+                                const CompletionFn& onDone) {
+  for (size_t i = 0; i < requests.size(); i++) {
+    requests[i].status = 0;
+    requests[i].error.Clear();
+    requests[i].body.clear();
+    if (CancelIfRequested(requests[i])) {
+      if (onDone) onDone(i, requests[i]);
+      continue;
+    }
+    wxStopWatch watch;
+    WxHttpExecute(requests[i]);
+    requests[i].elapsedMs = watch.Time();
+    if (onDone) onDone(i, requests[i]);
+  }
+}
+
+#endif  // __OCPN__ANDROID__
+
+// Obergrenze für gemerkte Validatoren, danach wird neu angefangen
+static const size_t MAX_VALIDATORS = 1024;
+
+void tpHttpClient::PrepareConditional(tpHttpRequest& request) {
+  request.ifNoneMatch.Clear();
+  request.ifModifiedSince.Clear();
+  request.etag.Clear();
+  request.lastModified.Clear();
+  request.notModified = false;
+  request.wireBytes = -1;
+  request.elapsedMs = 0;
+  request.firstByteMs = 0;
+  request.cancelled = false;
+  request.bodyBytes = 0;
+  request.bodyHash = FNV_OFFSET_BASIS;
+  request.deferData = false;
+
+  if (request.cacheKey.IsEmpty() || !request.postBody.empty()) return;
+
+  auto it = m_validators.find(request.cacheKey);
+  if (it == m_validators.end()) return;
+
+  request.ifNoneMatch = it->second.etag;
+  request.ifModifiedSince = it->second.lastModified;
+
+  // Ohne Validatoren sagt erst der Hash am Ende, ob sich etwas geändert hat.
+  // Den Parser erst dann füttern, sonst wird ein unveränderter Body bei
+  // jedem Intervall komplett geparst.
+  request.deferData = request.onData && request.ifNoneMatch.IsEmpty() &&
+                      request.ifModifiedSince.IsEmpty();
+}
+
+void tpHttpClient::CompleteConditional(tpHttpRequest& request) {
+  if (request.cacheKey.IsEmpty() || !request.postBody.empty()) return;
+
+  if (request.status == 304) {
+    request.notModified = true;
+    request.error.Clear();
+    return;
+  }
+
+  if (!request.IsOk()) return;
+
+  if (m_validators.size() >= MAX_VALIDATORS &&
+      m_validators.find(request.cacheKey) == m_validators.end()) {
+    m_validators.clear();
+  }
+
+  Validators& validators = m_validators[request.cacheKey];
+  uint64_t hash = request.bodyHash;
+
+  // Server ohne ETag/Last-Modified: gleiche Bytes wie beim letzten Mal
+  request.notModified = (validators.bodyHash == hash);
+
+  validators.etag = request.etag;
+  validators.lastModified = request.lastModified;
+  validators.bodyHash = hash;
+
+  if (!request.deferData || request.notModified) return;
+
+  // Zurückgehaltener Body hat sich geändert: jetzt in einem Stück an onData.
+  // Ob das Parsen geklappt hat, prüft der Aufrufer an seinem Parser.
+  request.onData(request.body.data(), request.body.size());
+  std::string().swap(request.body);
+}
+
+void tpHttpClient::ForgetValidators(const wxString& cacheKey) {
+  m_validators.erase(cacheKey);
+}
+
+// Server überlastet oder nicht erreichbar - alles andere, auch 404, zählt
+// als Antwort eines gesunden Endpoints
+static bool IsEndpointFailure(const tpHttpRequest& request) {
+  return request.status <= 0 || request.status >= 500 ||
+         request.status == 429;
+}
+
+static const long RATE_WAIT_STEP_MS = 50;
+
+// Wartet in kurzen Schritten und hört auf, sobald keine der Anfragen mehr
+// gebraucht wird - ein überholter Viewport soll den Worker nicht aufhalten
+static void WaitUnlessCancelled(const std::vector<tpHttpRequest>& requests,
+                                const std::vector<size_t>& indices,
+                                long waitMs) {
+  wxStopWatch watch;
+  long waited = 0;
+  while (waited < waitMs) {
+    bool needed = false;
+    for (size_t i : indices) {
+      const tpHttpRequest& request = requests[i];
+      if (!request.isCancelled || !request.isCancelled()) {
+        needed = true;
+        break;
+      }
+    }
+    if (!needed) return;
+    wxMilliSleep(std::min(RATE_WAIT_STEP_MS, waitMs - waited));
+    waited = watch.Time();
+  }
+}
+
+void tpHttpClient::PerformAll(std::vector<tpHttpRequest>& requests,
+                              const CompletionFn& onDone) {
+  for (auto& request : requests) PrepareConditional(request);
+
+  if (!m_governor) {
+    PerformBatch(requests, [&](size_t index, tpHttpRequest& request) {
+      CompleteConditional(request);
+      if (onDone) onDone(index, request);
+    });
+    return;
+  }
+
+  // Endpoints mit offenem Circuit sofort abweisen, der Rest läuft als
+  // eigener Batch
+  std::vector<wxString> endpoints(requests.size());
+  std::vector<size_t> admitted;
+  for (size_t i = 0; i < requests.size(); i++) {
+    tpHttpRequest& request = requests[i];
+    endpoints[i] = tpRequestGovernor::EndpointOf(request.url);
+
+    long timeoutSecs = request.timeoutSecs;
+    if (!m_governor->Admit(endpoints[i], &timeoutSecs)) {
+      request.status = -1;
+      request.error = "Circuit open for " + endpoints[i];
+      if (onDone) onDone(i, request);
+      continue;
+    }
+    // POSTs (Login) behalten ihr festes Timeout
+    if (request.postBody.empty()) request.timeoutSecs = timeoutSecs;
+    admitted.push_back(i);
+  }
+
+  if (!admitted.empty()) {
+    // Der UI-Thread wartet nie, seine Anfragen stößt der Benutzer an. Die
+    // Tokens zählen trotzdem, Worker und Downloader warten dafür länger.
+    long waitMs = m_governor->Reserve((int)admitted.size());
+    if (waitMs > 0 && !wxThread::IsMain())
+      WaitUnlessCancelled(requests, admitted, waitMs);
+
+    std::vector<tpHttpRequest> batch(admitted.size());
+    for (size_t j = 0; j < admitted.size(); j++)
+      std::swap(batch[j], requests[admitted[j]]);
+
+    PerformBatch(batch, [&](size_t index, tpHttpRequest& request) {
+      size_t i = admitted[index];
+      if (request.cancelled)
+        m_governor->Release(endpoints[i]);
+      else
+        m_governor->Report(endpoints[i], !IsEndpointFailure(request),
+                           request.firstByteMs);
+      std::swap(requests[i], request);
+      CompleteConditional(requests[i]);
+      if (onDone) onDone(i, requests[i]);
+    });
+  }
+
+  m_governor->LogState();
+}
+
+bool tpHttpClient::Perform(tpHttpRequest& request) {
+  std::vector<tpHttpRequest> single(1);
+  std::swap(single[0], request);
+  PerformAll(single);
+  std::swap(single[0], request);
+  return request.IsOk();
+}
+
+wxString tpHttpClient::Get(const wxString& url, const wxString& authHeader,
+                           long* httpStatusOut, wxString* errorOut) {
+  tpHttpRequest request(url, authHeader);
+  Perform(request);
+
+  if (httpStatusOut) *httpStatusOut = request.status;
+
+  if (!request.error.IsEmpty() || request.status != 200) {
+    if (errorOut) {
+      *errorOut = request.error.IsEmpty()
+                      ? wxString::Format("HTTP error %ld", request.status)
+                      : request.error;
+    }
+    return "";
+  }
+
+  return request.GetBodyString();
+}
@@ -0,0 +1,461 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Incremental JSON parser for streamed server responses
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "tpJsonStream.h"
+
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+
+tpJsonStream::tpJsonStream(Handler& handler) : m_handler(handler) {}
+
+bool tpJsonStream::Fail() {
+  m_error = true;
+  return false;
+}
+
+static bool IsWhitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool IsNumberChar(char c) {
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+         c == 'e' || c == 'E';
+}
+
+bool tpJsonStream::Feed(const char* data, size_t size) {
+  for (size_t i = 0; i < size && !m_error; i++) {
+    if (m_token == TOKEN_STRING) {
+      i = ReadString(data, size, i);
+      continue;
+    }
+
+    char c = data[i];
+
+    // Zahl oder true/false/null läuft bis zum ersten fremden Zeichen und
+    // wird am Stück übernommen
+    if (m_token == TOKEN_NUMBER || m_token == TOKEN_LITERAL) {
+      size_t end = i;
+      if (m_token == TOKEN_NUMBER) {
+        while (end < size && IsNumberChar(data[end])) end++;
+      } else {
+        while (end < size && data[end] >= 'a' && data[end] <= 'z') end++;
+      }
+      m_text.append(data + i, end - i);
+      if (end == size) break;
+      i = end;
+      c = data[i];
+      if (!FinishScalarToken()) break;
+    }
+
+    if (IsWhitespace(c)) continue;
+
+    switch (m_state) {
+      case EXPECT_VALUE:
+        BeginValue(c);
+        break;
+      case EXPECT_VALUE_OR_END:
+        if (c == ']')
+          CloseContainer(true);
+        else
+          BeginValue(c);
+        break;
+      case EXPECT_KEY_OR_END:
+        if (c == '}') {
+          CloseContainer(false);
+          break;
+        }
+        if (c != '"') {
+          Fail();
+          break;
+        }
+        m_token = TOKEN_STRING;
+        m_tokenIsKey = true;
+        m_text.clear();
+        break;
+      case EXPECT_KEY:
+        if (c != '"') {
+          Fail();
+          break;
+        }
+        m_token = TOKEN_STRING;
+        m_tokenIsKey = true;
+        m_text.clear();
+        break;
+      case EXPECT_COLON:
+        if (c == ':')
+          m_state = EXPECT_VALUE;
+        else
+          Fail();
+        break;
+      case EXPECT_COMMA_OR_END:
+        if (c == ',')
+          m_state = m_stack.back().isArray ? EXPECT_VALUE : EXPECT_KEY;
+        else if (c == ']' || c == '}')
+          CloseContainer(c == ']');
+        else
+          Fail();
+        break;
+      case EXPECT_NOTHING:
+        Fail();
+        break;
+    }
+  }
+
+  return !m_error;
+}
+
+bool tpJsonStream::Finish() {
+  if (m_error) return false;
+  if (m_token == TOKEN_STRING) return Fail();
+  if (m_token != TOKEN_NONE && !FinishScalarToken()) return false;
+  return m_state == EXPECT_NOTHING;
+}
+
+bool tpJsonStream::BeginValue(char c) {
+  if (!m_stack.empty() && m_stack.back().isArray) m_stack.back().index++;
+
+  if (!m_capturing && m_handler.CaptureValue(*this)) {
+    m_capturing = true;
+    m_captureStack.clear();
+  }
+
+  if (c == '{' || c == '[') {
+    bool isArray = (c == '[');
+    EmitStart(isArray);
+    m_stack.push_back(Frame());
+    m_stack.back().isArray = isArray;
+    m_state = isArray ? EXPECT_VALUE_OR_END : EXPECT_KEY_OR_END;
+    return true;
+  }
+
+  m_text.clear();
+  if (c == '"') {
+    m_token = TOKEN_STRING;
+    m_tokenIsKey = false;
+  } else if (c == '-' || (c >= '0' && c <= '9')) {
+    m_token = TOKEN_NUMBER;
+    m_text += c;
+  } else if (c == 't' || c == 'f' || c == 'n') {
+    m_token = TOKEN_LITERAL;
+    m_text += c;
+  } else {
+    return Fail();
+  }
+  return true;
+}
+
+void tpJsonStream::EndValue() {
+  m_state = m_stack.empty() ? EXPECT_NOTHING : EXPECT_COMMA_OR_END;
+}
+
+bool tpJsonStream::CloseContainer(bool isArray) {
+  if (m_stack.empty() || m_stack.back().isArray != isArray) return Fail();
+  m_stack.pop_back();
+  EmitEnd(isArray);
+  EndValue();
+  return true;
+}
+
+size_t tpJsonStream::ReadString(const char* data, size_t size, size_t pos) {
+  while (pos < size) {
+    char c = data[pos];
+
+    if (m_unicodeDigits >= 0) {
+      int digit;
+      if (c >= '0' && c <= '9')
+        digit = c - '0';
+      else if (c >= 'a' && c <= 'f')
+        digit = c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F')
+        digit = c - 'A' + 10;
+      else {
+        Fail();
+        return pos;
+      }
+      m_unicode = m_unicode * 16 + digit;
+      if (++m_unicodeDigits == 4) {
+        m_unicodeDigits = -1;
+        AppendCodePoint(m_unicode);
+      }
+      pos++;
+      continue;
+    }
+
+    if (m_escape) {
+      m_escape = false;
+      if (!AppendEscape(c)) return pos;
+      pos++;
+      continue;
+    }
+
+    if (c == '\\') {
+      m_escape = true;
+      pos++;
+      continue;
+    }
+
+    if (c == '"') {
+      FinishString();
+      return pos;
+    }
+
+    // Unmaskierte Zeichen am Stück übernehmen
+    FlushSurrogate();
+    size_t start = pos;
+    while (pos < size && data[pos] != '"' && data[pos] != '\\') pos++;
+    m_text.append(data + start, pos - start);
+  }
+  return size - 1;
+}
+
+bool tpJsonStream::AppendEscape(char c) {
+  if (c == 'u') {
+    m_unicodeDigits = 0;
+    m_unicode = 0;
+    return true;
+  }
+
+  FlushSurrogate();
+  switch (c) {
+    case '"':
+    case '\\':
+    case '/':
+      m_text += c;
+      break;
+    case 'b':
+      m_text += '\b';
+      break;
+    case 'f':
+      m_text += '\f';
+      break;
+    case 'n':
+      m_text += '\n';
+      break;
+    case 'r':
+      m_text += '\r';
+      break;
+    case 't':
+      m_text += '\t';
+      break;
+    default:
+      return Fail();
+  }
+  return true;
+}
+
+void tpJsonStream::AppendCodePoint(unsigned int cp) {
+  // UTF-16-Ersatzpaare aus \uD8xx\uDCxx zusammensetzen
+  if (cp >= 0xD800 && cp <= 0xDBFF) {
+    FlushSurrogate();
+    m_highSurrogate = cp;
+    return;
+  }
+  if (cp >= 0xDC00 && cp <= 0xDFFF) {
+    cp = m_highSurrogate
+             ? 0x10000 + ((m_highSurrogate - 0xD800) << 10) + (cp - 0xDC00)
+             : 0xFFFD;
+    m_highSurrogate = 0;
+  } else {
+    FlushSurrogate();
+  }
+  AppendUtf8(cp);
+}
+
+// Hohes Ersatzzeichen ohne Partner
+void tpJsonStream::FlushSurrogate() {
+  if (!m_highSurrogate) return;
+  m_highSurrogate = 0;
+  AppendUtf8(0xFFFD);
+}
+
+void tpJsonStream::AppendUtf8(unsigned int cp) {
+  if (cp < 0x80) {
+    m_text += (char)cp;
+  } else if (cp < 0x800) {
+    m_text += (char)(0xC0 | (cp >> 6));
+    m_text += (char)(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    m_text += (char)(0xE0 | (cp >> 12));
+    m_text += (char)(0x80 | ((cp >> 6) & 0x3F));
+    m_text += (char)(0x80 | (cp & 0x3F));
+  } else {
+    m_text += (char)(0xF0 | (cp >> 18));
+    m_text += (char)(0x80 | ((cp >> 12) & 0x3F));
+    m_text += (char)(0x80 | ((cp >> 6) & 0x3F));
+    m_text += (char)(0x80 | (cp & 0x3F));
+  }
+}
+
+bool tpJsonStream::FinishString() {
+  if (m_unicodeDigits >= 0 || m_escape) return Fail();
+  FlushSurrogate();
+  m_token = TOKEN_NONE;
+
+  if (m_tokenIsKey) {
+    m_stack.back().key.swap(m_text);
+    m_state = EXPECT_COLON;
+  } else {
+    if (m_capturing)
+      AddCaptured(
+          wxJSONValue(wxString::FromUTF8(m_text.data(), m_text.size())));
+    else
+      m_handler.OnScalar(*this, m_text, true);
+    EndValue();
+  }
+  m_text.clear();
+  return true;
+}
+
+bool tpJsonStream::FinishScalarToken() {
+  Token token = m_token;
+  m_token = TOKEN_NONE;
+
+  if (token == TOKEN_LITERAL && m_text != "true" && m_text != "false" &&
+      m_text != "null")
+    return Fail();
+
+  // Außerhalb eines eingefangenen Werts nur prüfen, umwandeln tut der Handler
+  if (!m_capturing) {
+    double number;
+    if (token == TOKEN_NUMBER && !ToDouble(m_text, number)) return Fail();
+    m_handler.OnScalar(*this, m_text, false);
+    EndValue();
+    return true;
+  }
+
+  wxJSONValue value;
+  if (token == TOKEN_LITERAL) {
+    if (m_text == "true")
+      value = wxJSONValue(true);
+    else if (m_text == "false")
+      value = wxJSONValue(false);
+    else
+      value = wxJSONValue(wxJSONTYPE_NULL);
+  } else if (m_text.find_first_of(".eE") == std::string::npos) {
+    // Ganze Zahl: wie wxJSONReader als int, wenn sie hineinpasst
+    errno = 0;
+    char* end = nullptr;
+    long long number = strtoll(m_text.c_str(), &end, 10);
+    if (*end != '\0') return Fail();
+    if (errno == 0 && number >= INT_MIN && number <= INT_MAX)
+      value = wxJSONValue((int)number);
+    else
+      value = wxJSONValue(strtod(m_text.c_str(), nullptr));
+  } else {
+    double number = 0.0;
+    if (!ToDouble(m_text, number)) return Fail();
+    value = wxJSONValue(number);
+  }
+
+  AddCaptured(value);
+  EndValue();
+  return true;
+}
+
+// Gebietsschema-unabhängig (OpenCPN setzt ggf. ein Dezimalkomma) und ohne
+// Umweg über wxString. Bis 19 signifikante Stellen werden exakt gesammelt,
+// das Ergebnis liegt damit höchstens ein, zwei ulp neben strtod.
+bool tpJsonStream::ToDouble(const std::string& text, double& out) {
+  const char* p = text.c_str();
+  const char* end = p + text.size();
+
+  bool negative = (p < end && *p == '-');
+  if (negative) p++;
+  if (p == end || *p < '0' || *p > '9') return false;
+
+  unsigned long long mantissa = 0;
+  int digits = 0;    // signifikante Stellen in mantissa
+  int exponent = 0;  // Zehnerpotenz zu mantissa
+  for (; p < end && *p >= '0' && *p <= '9'; p++) {
+    if (digits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      if (mantissa) digits++;
+    } else {
+      exponent++;
+    }
+  }
+
+  if (p < end && *p == '.') {
+    p++;
+    if (p == end || *p < '0' || *p > '9') return false;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+      if (digits >= 19) continue;
+      mantissa = mantissa * 10 + (*p - '0');
+      if (mantissa) digits++;
+      exponent--;
+    }
+  }
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    p++;
+    bool negativeExp = (p < end && *p == '-');
+    if (p < end && (*p == '-' || *p == '+')) p++;
+    if (p == end || *p < '0' || *p > '9') return false;
+    int e = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+      if (e < 10000) e = e * 10 + (*p - '0');
+    }
+    exponent += negativeExp ? -e : e;
+  }
+  if (p != end) return false;
+
+  double value = (double)mantissa;
+  if (exponent > 0)
+    value *= std::pow(10.0, exponent);
+  else if (exponent < 0)
+    value /= std::pow(10.0, -exponent);
+  out = negative ? -value : value;
+  return true;
+}
+
+void tpJsonStream::EmitStart(bool isArray) {
+  if (m_capturing) {
+    m_captureStack.push_back(
+        wxJSONValue(isArray ? wxJSONTYPE_ARRAY : wxJSONTYPE_OBJECT));
+  } else if (isArray) {
+    m_handler.OnStartArray(*this);
+  } else {
+    m_handler.OnStartObject(*this);
+  }
+}
+
+void tpJsonStream::EmitEnd(bool isArray) {
+  if (m_capturing) {
+    wxJSONValue value = m_captureStack.back();
+    m_captureStack.pop_back();
+    AddCaptured(value);
+  } else if (isArray) {
+    m_handler.OnEndArray(*this);
+  } else {
+    m_handler.OnEndObject(*this);
+  }
+}
+
+void tpJsonStream::AddCaptured(const wxJSONValue& value) {
+  if (m_captureStack.empty()) {
+    // Eingefangener Wert vollständig
+    m_capturing = false;
+    m_captured = value;
+    m_handler.OnValue(*this, m_captured);
+    m_captured = wxJSONValue();
+    return;
+  }
+
+  const Frame& parent = m_stack.back();
+  if (parent.isArray)
+    m_captureStack.back().Append(value);
+  else
+    m_captureStack.back()[wxString::FromUTF8(parent.key.data(),
+                                             parent.key.size())] = value;
+}
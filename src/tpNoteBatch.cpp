@@ -0,0 +1,170 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Immutable block of notes from one resourceset fetch
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "tpNoteBatch.h"
+
+#include <algorithm>
+
+tpNoteBatch::tpNoteBatch(std::vector<SignalKNote>& notes,
+                         tpDescriptionStore& descriptions)
+    : m_descriptions(std::move(descriptions)) {
+  m_descriptions.Finish();
+
+  // Stabil: bei gleicher id liegt die zuletzt geparste Note hinten
+  std::stable_sort(notes.begin(), notes.end(),
+                   [](const SignalKNote& a, const SignalKNote& b) {
+                     return a.GetIdUtf8() < b.GetIdUtf8();
+                   });
+  size_t count = 0;
+  for (size_t i = 0; i < notes.size(); i++) {
+    if (i + 1 < notes.size() &&
+        notes[i + 1].GetIdUtf8() == notes[i].GetIdUtf8())
+      continue;
+    if (count != i) notes[count] = std::move(notes[i]);
+    count++;
+  }
+  notes.erase(notes.begin() + count, notes.end());
+
+  // Ein Block in genau passender Größe
+  m_notes.swap(notes);
+  m_notes.shrink_to_fit();
+
+  std::vector<std::pair<TileKey, uint32_t>> byTile;
+  byTile.reserve(m_notes.size());
+  for (size_t i = 0; i < m_notes.size(); i++) {
+    int x, y;
+    tpTileCache::TileAt(m_notes[i].latitude, m_notes[i].longitude, INDEX_ZOOM,
+                        x, y);
+    byTile.push_back(std::make_pair(std::make_pair(x, y), (uint32_t)i));
+  }
+  std::sort(byTile.begin(), byTile.end());
+
+  m_byTile.reserve(byTile.size());
+  for (size_t i = 0; i < byTile.size(); i++) {
+    if (i == 0 || byTile[i].first != byTile[i - 1].first)
+      m_tiles.push_back(std::make_pair(byTile[i].first, (uint32_t)i));
+    m_byTile.push_back(byTile[i].second);
+  }
+  m_tiles.shrink_to_fit();
+}
+
+const SignalKNote* tpNoteBatch::Find(const wxString& id) const {
+  std::string key = tpStringPool::ToUtf8(id);
+  auto it = std::lower_bound(m_notes.begin(), m_notes.end(), key,
+                             [](const SignalKNote& note, const std::string& k) {
+                               return note.GetIdUtf8() < k;
+                             });
+  if (it == m_notes.end() || it->GetIdUtf8() != key) return nullptr;
+  return &*it;
+}
+
+tpNoteBatch::Delta tpNoteBatch::CompareTo(const tpNoteBatch& older) const {
+  Delta delta;
+  // Beide nach id sortiert: ein gemeinsamer Durchlauf
+  auto oldIt = older.m_notes.begin();
+  auto newIt = m_notes.begin();
+  while (oldIt != older.m_notes.end() || newIt != m_notes.end()) {
+    if (newIt == m_notes.end() ||
+        (oldIt != older.m_notes.end() &&
+         oldIt->GetIdUtf8() < newIt->GetIdUtf8())) {
+      delta.removed++;
+      ++oldIt;
+    } else if (oldIt == older.m_notes.end() ||
+               newIt->GetIdUtf8() < oldIt->GetIdUtf8()) {
+      delta.added++;
+      ++newIt;
+    } else {
+      if (oldIt->GetContentHash() != newIt->GetContentHash()) delta.changed++;
+      ++oldIt;
+      ++newIt;
+    }
+  }
+  return delta;
+}
+
+void tpNoteBatch::CollectRange(const tpTileRange& range,
+                               std::vector<const SignalKNote*>& out) const {
+  for (size_t t = 0; t < m_tiles.size(); t++) {
+    const TileKey& tile = m_tiles[t].first;
+    if (!range.Contains(tile.first, tile.second)) continue;
+
+    size_t end = t + 1 < m_tiles.size() ? m_tiles[t + 1].second
+                                        : m_byTile.size();
+    for (size_t i = m_tiles[t].second; i < end; i++)
+      out.push_back(&m_notes[m_byTile[i]]);
+  }
+}
+
+std::shared_ptr<tpNoteBatch> tpNoteBatch::Extract(
+    const std::vector<tpTileRange>& ranges) const {
+  std::vector<SignalKNote> notes;
+  for (size_t t = 0; t < m_tiles.size(); t++) {
+    const TileKey& tile = m_tiles[t].first;
+    bool keep = false;
+    for (const auto& range : ranges) {
+      if (range.Contains(tile.first, tile.second)) {
+        keep = true;
+        break;
+      }
+    }
+    if (!keep) continue;
+
+    size_t end = t + 1 < m_tiles.size() ? m_tiles[t + 1].second
+                                        : m_byTile.size();
+    for (size_t i = m_tiles[t].second; i < end; i++)
+      notes.push_back(m_notes[m_byTile[i]]);
+  }
+
+  // Beschreibungen in Reihenfolge ihrer Blöcke übernehmen, damit jeder nur
+  // einmal entpackt wird, und die Verweise auf den neuen Speicher umhängen
+  std::vector<std::pair<uint32_t, size_t>> byRef;
+  for (size_t i = 0; i < notes.size(); i++) {
+    if (notes[i].GetDescriptionRef() != 0)
+      byRef.push_back(std::make_pair(notes[i].GetDescriptionRef(), i));
+  }
+  std::sort(byRef.begin(), byRef.end());
+  std::vector<uint32_t> refs;
+  refs.reserve(byRef.size());
+  for (const auto& ref : byRef) refs.push_back(ref.first);
+
+  tpDescriptionStore descriptions;
+  std::vector<uint32_t> added = descriptions.AddFrom(m_descriptions, refs);
+  for (size_t i = 0; i < byRef.size(); i++)
+    notes[byRef[i].second].SetDescriptionRef(added[i]);
+
+  return std::make_shared<tpNoteBatch>(notes, descriptions);
+}
+
+wxString tpNoteBatch::GetDescription(const SignalKNote& note) const {
+  if (note.GetDescriptionRef() == 0) return note.GetDescription();
+  return tpStringPool::FromUtf8(m_descriptions.Get(note.GetDescriptionRef()));
+}
+
+size_t tpNoteBatch::GetAllocations() const {
+  size_t count = 0;
+  if (m_notes.capacity() > 0) count++;
+  if (m_byTile.capacity() > 0) count++;
+  if (m_tiles.capacity() > 0) count++;
+  count += m_descriptions.GetAllocations();
+  for (const auto& note : m_notes) count += note.GetAllocations();
+  return count;
+}
+
+size_t tpNoteBatch::GetMemoryUsage() const {
+  size_t bytes = sizeof(tpNoteBatch) +
+                 (m_notes.capacity() - m_notes.size()) * sizeof(SignalKNote) +
+                 m_byTile.capacity() * sizeof(uint32_t) +
+                 m_tiles.capacity() * sizeof(std::pair<TileKey, uint32_t>) +
+                 m_descriptions.GetMemoryUsage();
+  for (const auto& note : m_notes) bytes += note.GetMemoryUsage();
+  return bytes;
+}
@@ -0,0 +1,58 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Size-bounded LRU cache for note details
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "tpNoteDetailsCache.h"
+
+bool tpNoteDetailsCache::Get(const wxString& id, SignalKNote& note) {
+  auto it = m_entries.find(id);
+  if (it == m_entries.end()) {
+    m_misses++;
+    return false;
+  }
+
+  m_hits++;
+  m_lru.splice(m_lru.begin(), m_lru, it->second.lruPos);
+  note = it->second.note;
+  return true;
+}
+
+void tpNoteDetailsCache::Put(const wxString& id, const SignalKNote& note) {
+  auto it = m_entries.find(id);
+  if (it != m_entries.end()) {
+    it->second.note = note;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lruPos);
+    return;
+  }
+
+  // Voll: am längsten nicht gebrauchten Eintrag verwerfen
+  if (m_entries.size() >= MAX_ENTRIES) {
+    m_entries.erase(m_lru.back());
+    m_lru.pop_back();
+  }
+
+  m_lru.push_front(id);
+  Entry& entry = m_entries[id];
+  entry.note = note;
+  entry.lruPos = m_lru.begin();
+}
+
+void tpNoteDetailsCache::Remove(const wxString& id) {
+  auto it = m_entries.find(id);
+  if (it == m_entries.end()) return;
+  m_lru.erase(it->second.lruPos);
+  m_entries.erase(it);
+}
+
+void tpNoteDetailsCache::Clear() {
+  m_entries.clear();
+  m_lru.clear();
+}
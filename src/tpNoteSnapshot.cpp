@@ -0,0 +1,36 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Immutable, versioned view of the notes for the render path
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "tpNoteSnapshot.h"
+#include "tpNoteBatch.h"
+
+#include <algorithm>
+
+const SignalKNote* tpNoteSnapshot::Find(const wxString& id,
+                                        const tpNoteBatch** batch) const {
+  if (batch) *batch = nullptr;
+
+  std::string key = tpStringPool::ToUtf8(id);
+  auto it = std::lower_bound(notes.begin(), notes.end(), key,
+                             [](const Note& note, const std::string& k) {
+                               return note.note->GetIdUtf8() < k;
+                             });
+  if (it != notes.end() && it->note->GetIdUtf8() == key) return it->note.get();
+
+  for (const auto& rs : batches) {
+    const SignalKNote* note = rs->Find(id);
+    if (!note) continue;
+    if (batch) *batch = rs.get();
+    return note;
+  }
+  return nullptr;
+}
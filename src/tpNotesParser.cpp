@@ -0,0 +1,416 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Streaming parsers for notes lists and resourcesets
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "ocpn_plugin.h"
+#include "signalk_notes_opencpn_pi.h"
+#include "tpSignalKNotes.h"
+#include "tpNoteBatch.h"
+#include "tpNotesParser.h"
+
+#include <wx/jsonreader.h>
+#include <wx/time.h>
+#include <algorithm>
+#include <atomic>
+
+static wxString KeyString(const tpJsonStream& json, size_t level) {
+  const std::string& key = json.GetKey(level);
+  return wxString::FromUTF8(key.data(), key.size());
+}
+
+// Der wxJSONReader-Vergleich puffert und parst einen ganzen Body ein zweites
+// Mal - das reicht einmal je Prozess, nicht bei jeder Aktualisierung
+static std::atomic<bool> s_wxJsonCompared(false);
+
+// ---------------------------------------------------------------------------
+// Notes-Liste
+
+tpNotesListParser::tpNotesListParser(tpSignalKNotesManager* manager,
+                                     tpFetchResult& result,
+                                     std::map<wxString, SignalKNote>& notes)
+    : m_manager(manager), m_result(result), m_notes(notes), m_json(*this) {}
+
+bool tpNotesListParser::CaptureValue(const tpJsonStream& json) {
+  // Jedes Mitglied des Root-Objekts ist eine Note
+  return json.GetDepth() == 1 && !json.IsArray(0);
+}
+
+void tpNotesListParser::OnValue(const tpJsonStream& json, wxJSONValue& value) {
+  wxString noteId = KeyString(json, 0);
+
+  SignalKNote note;
+  m_manager->ParseNoteValue(noteId, value, note);
+
+  if (!note.GetSource().IsEmpty()) m_result.providers.insert(note.GetSource());
+  if (!note.GetIconName().IsEmpty()) m_result.icons.insert(note.GetIconName());
+
+  m_notes[noteId] = note;
+}
+
+// ---------------------------------------------------------------------------
+// Resourcesets
+
+tpResourceSetParser::tpResourceSetParser(
+    tpSignalKNotesManager* manager, const wxString& resourceSetName,
+    const std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
+        configuredSubs,
+    tpResourceSetResult& out)
+    : m_manager(manager),
+      m_resourceSetName(resourceSetName),
+      m_configuredSubs(configuredSubs),
+      m_out(out),
+      m_json(*this),
+      m_compareWxJson(manager->GetPlugin()->IsDebugMode() &&
+                      !s_wxJsonCompared.exchange(true)) {
+  for (const auto& sub : configuredSubs) {
+    if (sub.second.enabled) m_anyEnabled = true;
+  }
+}
+
+bool tpResourceSetParser::IsSubEnabled(const wxString& subName) const {
+  auto it = m_configuredSubs.find(subName);
+  return it != m_configuredSubs.end() && it->second.enabled;
+}
+
+bool tpResourceSetParser::Feed(const char* data, size_t size) {
+  wxLongLong start = wxGetUTCTimeUSec();
+  bool ok = m_json.Feed(data, size);
+  m_parseMicros += wxGetUTCTimeUSec() - start;
+  m_bytes += size;
+  if (m_compareWxJson) m_body.append(data, size);
+  return ok;
+}
+
+// Ebenen: 0 = Root, 1 = Eintrag (uuid), 2 = values, 3 = features,
+// 4 = Feature; im flachen Layout liegt das Feature auf Ebene 2
+bool tpResourceSetParser::IsFeatureStart(const tpJsonStream& json) const {
+  size_t depth = json.GetDepth();
+  if (depth == 2) return !json.IsArray(1) && json.GetKey(1) == "feature";
+  return depth == 4 && m_entry.hasFeatureArray && json.IsArray(3) &&
+         !json.IsArray(1) && !json.IsArray(2) && json.GetKey(1) == "values" &&
+         json.GetKey(2) == "features";
+}
+
+void tpResourceSetParser::OnStartObject(const tpJsonStream& json) {
+  size_t depth = json.GetDepth();
+  if (m_featureLevel) {
+    if (depth == m_featureLevel + 1 &&
+        json.GetKey(m_featureLevel) == "properties")
+      m_feature.hasProperties = true;
+    return;
+  }
+
+  if (depth == 1 && !json.IsArray(0)) {
+    m_entry = Entry();
+    m_entry.uuid = KeyString(json, 0);
+    m_inEntry = true;
+  } else if (m_inEntry && IsFeatureStart(json)) {
+    m_feature = Feature();
+    m_featureLevel = depth;
+  }
+}
+
+void tpResourceSetParser::OnEndObject(const tpJsonStream& json) {
+  size_t depth = json.GetDepth();
+  if (m_featureLevel) {
+    if (depth != m_featureLevel) return;
+    m_featureLevel = 0;
+    if (depth == 2) {
+      m_entry.hasFeature = true;
+      m_entry.feature = m_feature;
+    } else {
+      ProcessFeature(m_feature);
+    }
+    return;
+  }
+
+  if (depth == 1 && m_inEntry) {
+    FinishEntry();
+    m_inEntry = false;
+  }
+}
+
+void tpResourceSetParser::OnStartArray(const tpJsonStream& json) {
+  if (!m_inEntry || m_featureLevel) return;
+
+  if (json.GetDepth() == 3 && !json.IsArray(1) && !json.IsArray(2) &&
+      json.GetKey(1) == "values" && json.GetKey(2) == "features") {
+    m_entry.hasFeatureArray = true;
+  } else if (json.GetDepth() == 2 && !json.IsArray(1) &&
+             json.GetKey(1) == "feature") {
+    m_entry.hasFeature = true;  // kein Objekt, also kein Punkt
+  }
+}
+
+void tpResourceSetParser::OnScalar(const tpJsonStream& json,
+                                   const std::string& text, bool isString) {
+  if (m_featureLevel) {
+    ReadFeatureScalar(json, text, isString);
+    return;
+  }
+  if (!m_inEntry || json.GetDepth() != 2 || json.IsArray(1)) return;
+
+  const std::string& key = json.GetKey(1);
+  if (key == "type") {
+    m_entry.type = tpStringPool::FromUtf8(text);
+  } else if (key == "name") {
+    m_entry.hasName = true;
+    m_entry.name = tpStringPool::FromUtf8(text);
+  } else if (key == "description") {
+    m_entry.hasDescription = true;
+    m_entry.description = text;
+  } else if (key == "feature") {
+    m_entry.hasFeature = true;  // kein Objekt, also kein Punkt
+  }
+}
+
+// Nur geometry.type, geometry.coordinates und properties.name/description
+void tpResourceSetParser::ReadFeatureScalar(const tpJsonStream& json,
+                                            const std::string& text,
+                                            bool isString) {
+  size_t base = m_featureLevel;
+  size_t depth = json.GetDepth();
+  const std::string& member = json.GetKey(base);
+
+  if (depth == base + 1) {
+    if (member == "properties") m_feature.hasProperties = true;
+    return;
+  }
+
+  if (depth == base + 2 && !json.IsArray(base + 1)) {
+    const std::string& key = json.GetKey(base + 1);
+    if (member == "geometry" && key == "type") {
+      m_feature.pointType = isString && text == "Point";
+    } else if (member == "properties" && key == "name") {
+      m_feature.hasName = true;
+      m_feature.name = text;
+    } else if (member == "properties" && key == "description") {
+      m_feature.hasDescription = true;
+      m_feature.description = text;
+    }
+    return;
+  }
+
+  if (depth == base + 3 && member == "geometry" && json.IsArray(base + 2) &&
+      !json.IsArray(base + 1) && json.GetKey(base + 1) == "coordinates") {
+    double value = 0.0;
+    tpJsonStream::ToDouble(text, value);
+    int index = json.GetIndex(base + 2);
+    if (index == 0)
+      m_feature.longitude = value;
+    else if (index == 1)
+      m_feature.latitude = value;
+    m_feature.coordinates++;
+  }
+}
+
+void tpResourceSetParser::ProcessFeature(const Feature& feature) {
+  bool point = feature.IsPoint();
+
+  // Ein Unter-RS ist gültig, sobald es einen Punkt mit Namen enthält
+  if (point && feature.hasProperties && feature.hasName)
+    m_entry.hasValidFeature = true;
+
+  if (!point || !feature.hasProperties) return;
+  if (m_entry.hasName ? !IsSubEnabled(m_entry.name) : !m_anyEnabled) return;
+
+  PendingNote pending;
+  SignalKNote& note = pending.note;
+  note.longitude = feature.longitude;
+  note.latitude = feature.latitude;
+  if (feature.hasName)
+    note.SetNameUtf8(feature.name);
+  else
+    note.SetName(_("Unknown"));
+  if (feature.hasDescription)
+    note.SetDescriptionRef(m_descriptions.Add(feature.description));
+  note.isDisplayed = true;
+
+  pending.identity = tpHashBytes(feature.name.data(), feature.name.size());
+  pending.identity = tpHashBytes(&feature.longitude, sizeof(double),
+                                 pending.identity);
+  pending.identity =
+      tpHashBytes(&feature.latitude, sizeof(double), pending.identity);
+  pending.descriptionHash =
+      tpHashBytes(feature.description.data(), feature.description.size());
+
+  m_entry.pending.push_back(std::move(pending));
+}
+
+void tpResourceSetParser::FinishEntry() {
+  if (m_entry.hasFeature) FinishFlatEntry();
+
+  bool valid = m_entry.type == "ResourceSet" && m_entry.hasFeatureArray &&
+               m_entry.hasValidFeature;
+  if (!valid) {
+    if (!m_entry.hasFeature) m_invalidSubs++;
+    return;
+  }
+
+  const wxString& subName = m_entry.name;
+
+  // Unter-Resourceset als entdeckt markieren (für Config-Dialog)
+  if (m_discoveredSubs.find(subName) == m_discoveredSubs.end()) {
+    signalk_notes_opencpn_pi::SubResourceSetConfig cfg;
+    cfg.name = subName;
+    cfg.enabled = false;
+    auto it = m_configuredSubs.find(subName);
+    if (it != m_configuredSubs.end()) {
+      cfg.enabled = it->second.enabled;
+      cfg.iconName = it->second.iconName;
+    }
+    m_discoveredSubs[subName] = cfg;
+  }
+
+  auto cfgIt = m_configuredSubs.find(subName);
+  if (cfgIt == m_configuredSubs.end() || !cfgIt->second.enabled) return;
+
+  // GUID aus Name und Position statt aus dem Index in values.features: so
+  // behält ein Feature seine GUID, wenn der Server davor etwas einfügt oder
+  // entfernt. Gleiche Features werden in Reihenfolge ihres Auftretens
+  // durchgezählt.
+  std::vector<std::pair<uint64_t, size_t>> order;
+  order.reserve(m_entry.pending.size());
+  for (size_t i = 0; i < m_entry.pending.size(); i++)
+    order.push_back(std::make_pair(m_entry.pending[i].identity, i));
+  std::sort(order.begin(), order.end());
+  std::vector<int> occurrence(m_entry.pending.size(), 0);
+  for (size_t i = 1; i < order.size(); i++) {
+    if (order[i].first == order[i - 1].first)
+      occurrence[order[i].second] = occurrence[order[i - 1].second] + 1;
+  }
+
+  wxString source =
+      wxString::Format("resourceset:%s:%s", m_resourceSetName, subName);
+  for (size_t i = 0; i < m_entry.pending.size(); i++) {
+    PendingNote& pending = m_entry.pending[i];
+    SignalKNote& note = pending.note;
+
+    wxString guid = wxString::Format(
+        "RS_%s_%s_%016" wxLongLongFmtSpec "x", m_resourceSetName, subName,
+        (wxULongLong_t)pending.identity);
+    if (occurrence[i] > 0) guid += wxString::Format("_%d", occurrence[i]);
+    note.SetId(guid);
+    note.SetIconName(cfgIt->second.iconName);
+    note.SetSource(source);
+    note.UpdateContentHash(pending.descriptionHash);
+
+    m_notes.push_back(std::move(note));
+  }
+}
+
+void tpResourceSetParser::FinishFlatEntry() {
+  const Feature& feat = m_entry.feature;
+  if (!feat.IsPoint()) return;
+
+  // Ein einziger Punkt-Eintrag macht das ganze Resourceset flach
+  m_flat = true;
+
+  auto cfgIt = m_configuredSubs.find(m_resourceSetName);
+  if (cfgIt == m_configuredSubs.end() || !cfgIt->second.enabled) return;
+  if (!feat.hasProperties) return;
+
+  wxString guid =
+      wxString::Format("RSF_%s_%s", m_resourceSetName, m_entry.uuid);
+
+  const std::string& description =
+      m_entry.hasDescription ? m_entry.description : feat.description;
+
+  SignalKNote note;
+  note.SetId(guid);
+  if (feat.hasName)
+    note.SetNameUtf8(feat.name);
+  else
+    note.SetName(m_entry.hasName ? m_entry.name : _("Unknown"));
+  note.SetDescriptionRef(m_descriptions.Add(description));
+  note.longitude = feat.longitude;
+  note.latitude = feat.latitude;
+  note.SetIconName(cfgIt->second.iconName);
+  note.SetSource(wxString::Format("resourceset:%s:%s", m_resourceSetName,
+                                  m_resourceSetName));
+  note.isDisplayed = true;
+  note.UpdateContentHash(tpHashBytes(description.data(), description.size()));
+
+  m_flatNotes.push_back(std::move(note));
+}
+
+// Derselbe Body noch einmal wie vor dem Streaming-Parser: als wxString
+// durch wxJSONReader in einen wxJSONValue-Baum
+void tpResourceSetParser::CompareWithWxJson() {
+  if (m_body.empty()) return;
+  wxLongLong start = wxGetUTCTimeUSec();
+  {
+    wxJSONReader reader;
+    wxJSONValue root;
+    reader.Parse(wxString::FromUTF8(m_body.data(), m_body.size()), &root);
+  }
+  m_wxJsonMicros = wxGetUTCTimeUSec() - start;
+  std::string().swap(m_body);
+}
+
+wxString tpResourceSetParser::ThroughputText() const {
+  double mb = m_bytes / (1024.0 * 1024.0);
+  double secs = m_parseMicros.ToDouble() / 1e6;
+  wxString text =
+      wxString::Format("%.1f MB in %.0f ms (%.0f MB/s)", mb, secs * 1000.0,
+                       secs > 0 ? mb / secs : 0.0);
+  if (m_wxJsonMicros > 0) {
+    double wxSecs = m_wxJsonMicros.ToDouble() / 1e6;
+    text += wxString::Format(", wxJSONReader %.0f ms (%.0f MB/s)",
+                             wxSecs * 1000.0, mb / wxSecs);
+  }
+  return text;
+}
+
+bool tpResourceSetParser::Finish() {
+  signalk_notes_opencpn_pi* plugin = m_manager->GetPlugin();
+
+  if (!m_json.Finish()) {
+    SKN_LOG(plugin, "ResourceSetParser: JSON-Fehler für %s",
+            m_resourceSetName);
+    return false;
+  }
+  CompareWithWxJson();
+
+  if (m_flat) {
+    // Flaches Resourceset: das gesamte RS ist ein einzelnes "Unter-RS"
+    // mit dem RS-Namen selbst als Sub-Name
+    m_out.flat = true;
+
+    signalk_notes_opencpn_pi::SubResourceSetConfig cfg;
+    cfg.name = m_resourceSetName;
+    cfg.enabled = false;
+    auto it = m_configuredSubs.find(m_resourceSetName);
+    if (it != m_configuredSubs.end()) {
+      cfg.enabled = it->second.enabled;
+      cfg.iconName = it->second.iconName;
+    }
+    m_out.discoveredSubs[m_resourceSetName] = cfg;
+    m_out.notes = std::make_shared<tpNoteBatch>(m_flatNotes, m_descriptions);
+
+    SKN_LOG(plugin, "ResourceSetParser: %s (flach) → %d Notes, %s",
+            m_resourceSetName, (int)m_out.notes->GetCount(), ThroughputText());
+    return true;
+  }
+
+  if (m_invalidSubs > 0) {
+    SKN_LOG(plugin,
+            "ResourceSetParser: %d ungültige Unter-RS in %s übersprungen",
+            m_invalidSubs, m_resourceSetName);
+  }
+
+  m_out.discoveredSubs.swap(m_discoveredSubs);
+  m_out.notes = std::make_shared<tpNoteBatch>(m_notes, m_descriptions);
+
+  SKN_LOG(plugin, "ResourceSetParser: %s → %d Notes geladen, %s",
+          m_resourceSetName, (int)m_out.notes->GetCount(), ThroughputText());
+  return true;
+}
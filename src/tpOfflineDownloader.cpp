@@ -0,0 +1,87 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Background download of offline regions
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "ocpn_plugin.h"
+#include "signalk_notes_opencpn_pi.h"
+#include "tpOfflineDownloader.h"
+#include "tpOfflineStore.h"
+
+tpOfflineDownloader::tpOfflineDownloader(tpSignalKNotesManager* manager,
+                                         tpOfflineStore* store,
+                                         const tpServerEndpoint& server,
+                                         const wxString& authToken,
+                                         const std::vector<wxString>& items)
+    : wxThread(wxTHREAD_JOINABLE),
+      m_manager(manager),
+      m_store(store),
+      m_server(server),
+      m_authToken(authToken.Clone()),
+      m_items(items),
+      m_cond(m_mutex) {
+  m_server.host = server.host.Clone();
+  m_http.SetGovernor(manager->GetGovernor());
+}
+
+void tpOfflineDownloader::RequestStop() {
+  wxMutexLocker lock(m_mutex);
+  m_stopRequested = true;
+  m_cond.Broadcast();
+}
+
+bool tpOfflineDownloader::IsStopRequested() {
+  wxMutexLocker lock(m_mutex);
+  return m_stopRequested;
+}
+
+void tpOfflineDownloader::GetProgress(tpOfflineStatus& status) {
+  wxMutexLocker lock(m_mutex);
+  status.running = m_running;
+  status.total = m_items.size();
+  status.done = m_done;
+  status.failed = m_failed;
+}
+
+wxThread::ExitCode tpOfflineDownloader::Entry() {
+  signalk_notes_opencpn_pi* plugin = m_manager->GetPlugin();
+  SKN_LOG(plugin, "Offline download: %d items from %s", (int)m_items.size(),
+          m_server.GetId());
+
+  for (size_t next = 0; next < m_items.size();) {
+    size_t count = m_items.size() - next;
+    if (count > BATCH_SIZE) count = BATCH_SIZE;
+    std::vector<wxString> batch(m_items.begin() + next,
+                                m_items.begin() + next + count);
+    next += count;
+
+    size_t stored = m_manager->DownloadOfflineItems(
+        m_http, m_server, m_authToken, batch, *m_store,
+        [this]() { return IsStopRequested(); });
+
+    wxMutexLocker lock(m_mutex);
+    m_done += stored;
+    m_failed += count - stored;
+    if (m_stopRequested) break;
+
+    // Leitung für die Live-Abrufe freigeben
+    m_cond.WaitTimeout(PAUSE_MS);
+    if (m_stopRequested) break;
+  }
+
+  wxMutexLocker lock(m_mutex);
+  m_running = false;
+  if (!m_stopRequested && m_failed == 0) m_store->FinishJob();
+
+  SKN_LOG(plugin, "Offline download %s: %d stored, %d failed",
+          m_stopRequested ? "stopped" : "finished", (int)m_done,
+          (int)m_failed);
+  return (ExitCode)0;
+}
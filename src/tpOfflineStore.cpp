@@ -0,0 +1,302 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   On-disk store for offline regions
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "tpOfflineStore.h"
+#include "tpTileCache.h"
+
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include <wx/textfile.h>
+
+#include <cmath>
+
+static const double METERS_PER_DEG_LAT = 111120.0;
+static const double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+static void AddRange(const tpTileRange& range, std::set<wxString>& tiles) {
+  if (!range.IsValid()) return;
+  int n = 1 << range.zoom;
+  int columns = ((range.x1 - range.x0 + n) % n) + 1;
+  for (int y = range.y0; y <= range.y1; y++) {
+    for (int i = 0; i < columns; i++)
+      tiles.insert(tpTileCache::QuadKey((range.x0 + i) % n, y, range.zoom));
+  }
+}
+
+// Dateiname aus beliebigem Resourceset-Namen: alles außer [A-Za-z0-9-_]
+// als Hex-Bytes
+static wxString FileNameForResourceSet(const wxString& name) {
+  wxString fileName;
+  wxScopedCharBuffer utf8 = name.utf8_str();
+  for (size_t i = 0; i < utf8.length(); i++) {
+    unsigned char c = (unsigned char)utf8.data()[i];
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+        (c >= '0' && c <= '9') || c == '-' || c == '_')
+      fileName += (char)c;
+    else
+      fileName += wxString::Format("%%%02X", c);
+  }
+  return fileName;
+}
+
+static long long FileSize(const wxString& path) {
+  if (!wxFileExists(path)) return 0;
+  return (long long)wxFileName::GetSize(path).GetValue();
+}
+
+static bool ReadFile(const wxString& path, std::string& data) {
+  wxFile file;
+  if (!wxFileExists(path) || !file.Open(path)) return false;
+  wxFileOffset length = file.Length();
+  if (length < 0) return false;
+  data.resize((size_t)length);
+  return length == 0 || file.Read(&data[0], (size_t)length) == length;
+}
+
+tpOfflineStore::tpOfflineStore(const wxString& directory) {
+  wxFileName dir = wxFileName::DirName(directory);
+  m_dir = dir.GetPathWithSep();
+  Scan();
+}
+
+void tpOfflineStore::TilesForArea(double latMin, double latMax, double lonMin,
+                                  double lonMax, std::set<wxString>& tiles) {
+  tpTileRange range;
+  range.zoom = ZOOM;
+  tpTileCache::TileAt(latMax, lonMin, ZOOM, range.x0, range.y0);
+  tpTileCache::TileAt(latMin, lonMax, ZOOM, range.x1, range.y1);
+  // Über die Datumsgrenze: x1 < x0, AddRange läuft herum
+  if (lonMax - lonMin >= 360.0) {
+    range.x0 = 0;
+    range.x1 = (1 << ZOOM) - 1;
+  }
+  AddRange(range, tiles);
+}
+
+void tpOfflineStore::TilesForRoute(
+    const std::vector<std::pair<double, double>>& points, double corridor,
+    std::set<wxString>& tiles) {
+  if (corridor <= 0) return;
+  for (size_t i = 0; i < points.size(); i++) {
+    double lat0 = points[i].first, lon0 = points[i].second;
+    double lat1 = lat0, lon1 = lon0;
+    if (i + 1 < points.size()) {
+      lat1 = points[i + 1].first;
+      lon1 = points[i + 1].second;
+    }
+
+    // Schenkel in Schritten von einer Korridorbreite abtasten
+    double dLon = std::remainder(lon1 - lon0, 360.0);
+    double north = (lat1 - lat0) * METERS_PER_DEG_LAT;
+    double east = dLon * METERS_PER_DEG_LAT *
+                  std::cos((lat0 + lat1) / 2.0 * DEG_TO_RAD);
+    int steps = (int)std::ceil(std::hypot(north, east) / corridor);
+    if (steps < 1) steps = 1;
+
+    for (int step = 0; step <= steps; step++) {
+      double f = (double)step / steps;
+      AddRange(tpTileCache::RangeAtZoom(lat0 + f * (lat1 - lat0),
+                                        lon0 + f * dLon, corridor, ZOOM),
+               tiles);
+    }
+  }
+}
+
+wxString tpOfflineStore::TilePath(const wxString& quadKey) const {
+  return m_dir + "notes" + wxFILE_SEP_PATH + quadKey + ".json";
+}
+
+wxString tpOfflineStore::ResourceSetPath(const wxString& name) const {
+  return m_dir + "resourcesets" + wxFILE_SEP_PATH +
+         FileNameForResourceSet(name) + ".json";
+}
+
+// Erst in eine temporäre Datei, dann umbenennen: ein Abbruch hinterlässt
+// keine halben Dateien. Aufrufer hält m_mutex.
+bool tpOfflineStore::WriteFile(const wxString& path, const std::string& data) {
+  wxFileName fn(path);
+  if (!fn.DirExists() && !fn.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL))
+    return false;
+
+  wxString tmpPath = path + ".tmp";
+  {
+    wxFile file;
+    if (!file.Create(tmpPath, true)) return false;
+    if (!data.empty() && file.Write(data.data(), data.size()) != data.size())
+      return false;
+  }
+  return wxRenameFile(tmpPath, path, true);
+}
+
+void tpOfflineStore::Scan() {
+  wxMutexLocker lock(m_mutex);
+  m_tiles.clear();
+  m_resourceSets.clear();
+  m_sizeBytes = 0;
+
+  wxString fileName;
+  wxDir notesDir(m_dir + "notes");
+  if (wxDir::Exists(m_dir + "notes") && notesDir.IsOpened()) {
+    for (bool cont = notesDir.GetFirst(&fileName, "*.json", wxDIR_FILES);
+         cont; cont = notesDir.GetNext(&fileName)) {
+      wxString quadKey = fileName.BeforeLast('.');
+      m_tiles.insert(quadKey);
+      m_sizeBytes += FileSize(TilePath(quadKey));
+    }
+  }
+
+  wxString rsDir = m_dir + "resourcesets";
+  wxDir resourceSetsDir(rsDir);
+  if (wxDir::Exists(rsDir) && resourceSetsDir.IsOpened()) {
+    for (bool cont =
+             resourceSetsDir.GetFirst(&fileName, "*.json", wxDIR_FILES);
+         cont; cont = resourceSetsDir.GetNext(&fileName)) {
+      // Nur gezählt; gesucht wird über den Dateinamen
+      m_resourceSets.insert(fileName);
+      m_sizeBytes += FileSize(rsDir + wxFILE_SEP_PATH + fileName);
+    }
+  }
+}
+
+bool tpOfflineStore::SaveTile(const wxString& quadKey,
+                              const std::string& body) {
+  wxMutexLocker lock(m_mutex);
+  wxString path = TilePath(quadKey);
+  long long oldSize = FileSize(path);
+  if (!WriteFile(path, body)) return false;
+  m_tiles.insert(quadKey);
+  m_sizeBytes += (long long)body.size() - oldSize;
+  return true;
+}
+
+bool tpOfflineStore::LoadTile(const wxString& quadKey, std::string& body) {
+  wxMutexLocker lock(m_mutex);
+  if (m_tiles.find(quadKey) == m_tiles.end()) return false;
+  return ReadFile(TilePath(quadKey), body);
+}
+
+std::vector<wxString> tpOfflineStore::FindTiles(const wxString& quadKey) {
+  wxMutexLocker lock(m_mutex);
+  std::vector<wxString> keys;
+
+  if ((int)quadKey.length() >= ZOOM) {
+    wxString ancestor = quadKey.Left(ZOOM);
+    if (m_tiles.find(ancestor) != m_tiles.end()) keys.push_back(ancestor);
+    return keys;
+  }
+
+  // Alle Nachkommen beginnen mit dem Quadkey und liegen sortiert beieinander
+  for (auto it = m_tiles.lower_bound(quadKey);
+       it != m_tiles.end() && it->StartsWith(quadKey); ++it)
+    keys.push_back(*it);
+  return keys;
+}
+
+bool tpOfflineStore::SaveResourceSet(const wxString& name,
+                                     const std::string& body) {
+  wxMutexLocker lock(m_mutex);
+  wxString path = ResourceSetPath(name);
+  long long oldSize = FileSize(path);
+  if (!WriteFile(path, body)) return false;
+  m_resourceSets.insert(wxFileName(path).GetFullName());
+  m_sizeBytes += (long long)body.size() - oldSize;
+  return true;
+}
+
+bool tpOfflineStore::LoadResourceSet(const wxString& name, std::string& body) {
+  wxMutexLocker lock(m_mutex);
+  return ReadFile(ResourceSetPath(name), body);
+}
+
+// job.txt: alle Einträge des Auftrags, done.txt: die erledigten, je Zeile
+// einer. done.txt wird nur angehängt, ein Abbruch verliert höchstens den
+// letzten Eintrag.
+bool tpOfflineStore::SaveJob(const std::vector<wxString>& items) {
+  wxMutexLocker lock(m_mutex);
+  if (wxFileExists(m_dir + "done.txt")) wxRemoveFile(m_dir + "done.txt");
+
+  std::string data;
+  for (const auto& item : items) {
+    data += item.utf8_str().data();
+    data += '\n';
+  }
+  return WriteFile(m_dir + "job.txt", data);
+}
+
+bool tpOfflineStore::LoadJob(std::vector<wxString>& pending) {
+  wxMutexLocker lock(m_mutex);
+  pending.clear();
+
+  wxTextFile jobFile(m_dir + "job.txt");
+  if (!jobFile.Exists() || !jobFile.Open(wxConvUTF8)) return false;
+
+  std::set<wxString> done;
+  wxTextFile doneFile(m_dir + "done.txt");
+  if (doneFile.Exists() && doneFile.Open(wxConvUTF8)) {
+    for (size_t i = 0; i < doneFile.GetLineCount(); i++)
+      done.insert(doneFile.GetLine(i));
+  }
+
+  for (size_t i = 0; i < jobFile.GetLineCount(); i++) {
+    const wxString& item = jobFile.GetLine(i);
+    if (!item.IsEmpty() && done.find(item) == done.end())
+      pending.push_back(item);
+  }
+  return true;
+}
+
+void tpOfflineStore::MarkDone(const wxString& item) {
+  wxMutexLocker lock(m_mutex);
+  wxFile file;
+  if (!file.Open(m_dir + "done.txt", wxFile::write_append)) return;
+  file.Write(item + "\n", wxConvUTF8);
+}
+
+void tpOfflineStore::FinishJob() {
+  wxMutexLocker lock(m_mutex);
+  if (wxFileExists(m_dir + "job.txt")) wxRemoveFile(m_dir + "job.txt");
+  if (wxFileExists(m_dir + "done.txt")) wxRemoveFile(m_dir + "done.txt");
+}
+
+bool tpOfflineStore::HasJob() {
+  wxMutexLocker lock(m_mutex);
+  return wxFileExists(m_dir + "job.txt");
+}
+
+size_t tpOfflineStore::GetTileCount() {
+  wxMutexLocker lock(m_mutex);
+  return m_tiles.size();
+}
+
+size_t tpOfflineStore::GetResourceSetCount() {
+  wxMutexLocker lock(m_mutex);
+  return m_resourceSets.size();
+}
+
+long long tpOfflineStore::GetSizeBytes() {
+  wxMutexLocker lock(m_mutex);
+  return m_sizeBytes;
+}
+
+void tpOfflineStore::Clear() {
+  {
+    wxMutexLocker lock(m_mutex);
+    if (wxDir::Exists(m_dir + "notes"))
+      wxFileName::Rmdir(m_dir + "notes", wxPATH_RMDIR_RECURSIVE);
+    if (wxDir::Exists(m_dir + "resourcesets"))
+      wxFileName::Rmdir(m_dir + "resourcesets", wxPATH_RMDIR_RECURSIVE);
+  }
+  FinishJob();
+  Scan();
+}
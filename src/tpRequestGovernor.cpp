@@ -0,0 +1,224 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Admission control for requests to the SignalK server
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "ocpn_plugin.h"
+#include "signalk_notes_opencpn_pi.h"
+#include "tpRequestGovernor.h"
+
+#include <wx/time.h>
+#include <wx/tokenzr.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// Circuit breaker: öffnet nach so vielen Fehlern in Folge
+static const int BREAKER_THRESHOLD = 3;
+static const long BACKOFF_BASE_MS = 2000;
+static const long BACKOFF_MAX_MS = 5 * 60 * 1000;
+
+// Token bucket: Dauerrate und Burst in Anfragen
+static const double BUCKET_RATE_PER_SEC = 8.0;
+static const double BUCKET_BURST = 16.0;
+// Länger wird nie gewartet, auch wenn der Bucket tief im Minus ist
+static const long MAX_WAIT_MS = 2000;
+
+// Grenzen für das adaptive Timeout
+static const long TIMEOUT_MIN_SECS = 3;
+static const long TIMEOUT_MAX_SECS = 30;
+static const long TIMEOUT_DEFAULT_SECS = 10;
+
+static const long STATE_LOG_INTERVAL_MS = 60 * 1000;
+
+tpRequestGovernor::tpRequestGovernor(signalk_notes_opencpn_pi* plugin)
+    : m_plugin(plugin),
+      m_tokens(BUCKET_BURST),
+      m_lastRefill(wxGetLocalTimeMillis()) {}
+
+wxString tpRequestGovernor::EndpointOf(const wxString& url) {
+  // http://host:port/signalk/v2/api/resources/notes/<id>?... →
+  // host:port/signalk/v2/api/resources/notes
+  wxString rest = url.AfterFirst(':').Mid(2);  // ohne "http://"
+  rest = rest.BeforeFirst('?');
+
+  wxString server = rest.BeforeFirst('/');
+  wxArrayString segments = wxStringTokenize(rest.AfterFirst('/'), "/");
+
+  // Bei Resourcen zählt der Typ, bei allen anderen Pfaden die ersten vier
+  // Segmente - IDs dahinter landen so im selben Endpoint
+  size_t keep = 4;
+  if (segments.GetCount() >= 4 && segments[3] == "resources") keep = 5;
+
+  wxString endpoint = server;
+  for (size_t i = 0; i < segments.GetCount() && i < keep; i++)
+    endpoint += "/" + segments[i];
+  return endpoint;
+}
+
+const char* tpRequestGovernor::StateName(CircuitState state) {
+  switch (state) {
+    case CLOSED:
+      return "closed";
+    case OPEN:
+      return "open";
+    case HALF_OPEN:
+      return "half-open";
+  }
+  return "?";
+}
+
+long tpRequestGovernor::BackoffMs(int failures) {
+  // Exponentiell ab dem Öffnen, danach "equal jitter": die Hälfte fest, die
+  // andere Hälfte zufällig, damit mehrere Clients nicht im Gleichschritt
+  // wiederkommen
+  int exponent = std::min(failures - BREAKER_THRESHOLD, 16);
+  double backoff = std::min((double)BACKOFF_MAX_MS,
+                            BACKOFF_BASE_MS * std::pow(2.0, exponent));
+
+  static std::mt19937 s_random(std::random_device{}());
+  std::uniform_real_distribution<double> jitter(0.5, 1.0);
+  return (long)(backoff * jitter(s_random));
+}
+
+bool tpRequestGovernor::Admit(const wxString& endpoint, long* timeoutSecs) {
+  wxMutexLocker lock(m_mutex);
+  Endpoint& ep = m_endpoints[endpoint];
+  wxLongLong now = wxGetLocalTimeMillis();
+
+  if (ep.state == OPEN) {
+    if (now < ep.openUntil) return false;
+
+    ep.state = HALF_OPEN;
+    ep.probeInFlight = false;
+    SKN_LOG(m_plugin, "Governor: %s half-open, sending probe", endpoint);
+  }
+
+  if (ep.state == HALF_OPEN) {
+    // Nur eine Probe gleichzeitig
+    if (ep.probeInFlight) return false;
+    ep.probeInFlight = true;
+  }
+
+  if (timeoutSecs) *timeoutSecs = ep.timeoutSecs;
+  return true;
+}
+
+void tpRequestGovernor::Refill(wxLongLong now) {
+  double elapsedSecs = (now - m_lastRefill).ToDouble() / 1000.0;
+  m_lastRefill = now;
+  m_tokens = std::min(BUCKET_BURST,
+                      m_tokens + elapsedSecs * BUCKET_RATE_PER_SEC);
+}
+
+long tpRequestGovernor::Reserve(int count) {
+  if (count <= 0) return 0;
+
+  wxMutexLocker lock(m_mutex);
+  Refill(wxGetLocalTimeMillis());
+
+  // Tokens werden auch ins Minus reserviert: nachfolgende Aufrufer warten
+  // dann entsprechend länger, die Reihenfolge bleibt erhalten
+  m_tokens -= count;
+  if (m_tokens >= 0) return 0;
+
+  long waitMs = (long)std::ceil(-m_tokens / BUCKET_RATE_PER_SEC * 1000.0);
+  waitMs = std::min(waitMs, MAX_WAIT_MS);
+  SKN_LOG(m_plugin, "Governor: rate limit, %d requests wait %ld ms (%.1f)",
+          count, waitMs, m_tokens);
+  return waitMs;
+}
+
+void tpRequestGovernor::Report(const wxString& endpoint, bool success,
+                               long latencyMs) {
+  wxMutexLocker lock(m_mutex);
+  Endpoint& ep = m_endpoints[endpoint];
+
+  if (success) {
+    // Latenz nach RFC 6298 glätten
+    double sample = (double)std::max(latencyMs, 1L);
+    if (ep.srttMs == 0.0) {
+      ep.srttMs = sample;
+      ep.rttvarMs = sample / 2.0;
+    } else {
+      ep.rttvarMs = 0.75 * ep.rttvarMs + 0.25 * std::fabs(ep.srttMs - sample);
+      ep.srttMs = 0.875 * ep.srttMs + 0.125 * sample;
+    }
+
+    long timeout =
+        (long)std::ceil((ep.srttMs + 4.0 * ep.rttvarMs) / 1000.0) + 1;
+    timeout = std::max(TIMEOUT_MIN_SECS, std::min(TIMEOUT_MAX_SECS, timeout));
+    if (timeout != ep.timeoutSecs) {
+      SKN_LOG(m_plugin,
+              "Governor: %s timeout %ld s -> %ld s (srtt %.0f ms, var %.0f ms)",
+              endpoint, ep.timeoutSecs, timeout, ep.srttMs, ep.rttvarMs);
+      ep.timeoutSecs = timeout;
+    }
+
+    if (ep.state != CLOSED) {
+      SKN_LOG(m_plugin, "Governor: %s closed after %d failures", endpoint,
+              ep.failures);
+    }
+    ep.state = CLOSED;
+    ep.failures = 0;
+    ep.probeInFlight = false;
+    return;
+  }
+
+  ep.failures++;
+  ep.probeInFlight = false;
+
+  if (ep.failures < BREAKER_THRESHOLD && ep.state == CLOSED) {
+    SKN_LOG(m_plugin, "Governor: %s failure %d/%d", endpoint, ep.failures,
+            BREAKER_THRESHOLD);
+    return;
+  }
+
+  long backoff = BackoffMs(ep.failures);
+  ep.state = OPEN;
+  ep.openUntil = wxGetLocalTimeMillis() + backoff;
+  // Nach einem Ausfall nicht mit dem knappen Timeout weitermachen
+  ep.timeoutSecs = std::max(ep.timeoutSecs, TIMEOUT_DEFAULT_SECS);
+  SKN_LOG(m_plugin, "Governor: %s open for %ld ms after %d failures", endpoint,
+          backoff, ep.failures);
+}
+
+void tpRequestGovernor::Release(const wxString& endpoint) {
+  wxMutexLocker lock(m_mutex);
+  auto it = m_endpoints.find(endpoint);
+  // Eine abgebrochene Probe sagt nichts über den Endpoint, die nächste
+  // Anfrage darf es erneut versuchen
+  if (it != m_endpoints.end()) it->second.probeInFlight = false;
+}
+
+void tpRequestGovernor::LogState(bool force) {
+  if (!m_plugin->IsDebugMode()) return;
+
+  wxMutexLocker lock(m_mutex);
+  wxLongLong now = wxGetLocalTimeMillis();
+  if (!force && (now - m_lastStateLog).ToLong() < STATE_LOG_INTERVAL_MS)
+    return;
+  m_lastStateLog = now;
+
+  Refill(now);
+  SKN_LOG(m_plugin, "Governor: bucket %.1f/%.0f tokens, %.0f req/s",
+          m_tokens, BUCKET_BURST, BUCKET_RATE_PER_SEC);
+
+  for (const auto& kv : m_endpoints) {
+    const Endpoint& ep = kv.second;
+    long openFor = ep.state == OPEN ? (ep.openUntil - now).ToLong() : 0;
+    SKN_LOG(m_plugin,
+            "Governor: %s %s failures=%d open_for=%ld ms srtt=%.0f ms "
+            "timeout=%ld s",
+            kv.first, StateName(ep.state), ep.failures,
+            std::max(openFor, 0L), ep.srttMs, ep.timeoutSecs);
+  }
+}
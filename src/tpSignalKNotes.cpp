@@ -14,6 +14,17 @@
 #include "signalk_notes_opencpn_pi.h"
 #include "tpSignalKNotes.h"
 #include "tpConfigDialog.h"
+#include "tpFetchWorker.h"
+#include "tpHttpClient.h"
+#include "tpNoteBatch.h"
+#include "tpNoteDetailsCache.h"
+#include "tpNoteSnapshot.h"
+#include "tpNotesParser.h"
+#include "tpOfflineDownloader.h"
+#include "tpOfflineStore.h"
+#include "tpSignalKStream.h"
+#include "tpTileCache.h"
+#include "tpWarmStartFile.h"
 
 #include <wx/filename.h>
 #include <wx/jsonreader.h>
@@ -29,7 +40,10 @@
 #include <wx/regex.h>
 #include <wx/base64.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <memory>
 #if defined(wxHAS_WEB_VIEW)
 #include <wx/webview.h>
 #endif
@@ -40,425 +54,1673 @@
 
 #include "svgRenderer.h"
 
-wxString HttpGet(const wxString& url, const wxString& authHeader = "",
-                 long* httpStatusOut = nullptr, wxString* errorOut = nullptr);
+// Helper: strip extension and return base path (without .svg/.png)
+static wxString GetBasePathWithoutExt(const wxString& fullPath) {
+  wxFileName fn(fullPath);
+  fn.ClearExt();
+  return fn.GetPathWithSep() + fn.GetName();
+}
 
-#if (defined(__linux__) || defined(__APPLE__)) && !defined(__OCPN__ANDROID__)
+// Bit eines Canvas in SharedNote::canvases (OpenCPN hat höchstens zwei)
+static uint32_t CanvasBit(int canvasIndex) {
+  return 1u << (canvasIndex & 31);
+}
 
-#include <curl/curl.h>
+// ---------------------------------------------------------------------------
+// Helper: unified icon loader (Desktop: SVG+PNG, Android: PNG only)
+// basePathWithoutExt: full path without extension
+// size: requested size (square)
+// outBmp: resulting bitmap
+// ---------------------------------------------------------------------------
+bool tpSignalKNotesManager::LoadIconSmart(const wxString& basePathWithoutExt,
+                                          int size, wxBitmap& outBmp) {
+#ifdef __OCPN__ANDROID__
+  // ANDROID → PNG ONLY
+  wxString pngPath = basePathWithoutExt + ".png";
 
-static size_t CurlWriteCallback(void* contents, size_t size, size_t nmemb,
-                                void* userp) {
-  size_t total = size * nmemb;
-  std::string* s = static_cast<std::string*>(userp);
-  s->append(static_cast<char*>(contents), total);
-  return total;
-}
+  wxBitmap bmp(pngPath, wxBITMAP_TYPE_PNG);
+  if (bmp.IsOk()) {
+    outBmp = bmp;
+    return true;
+  }
 
-wxString HttpGet(const wxString& url, const wxString& authHeader,
-                 long* httpStatusOut, wxString* errorOut) {
-  CURL* curl = curl_easy_init();
-  if (!curl) {
-    if (httpStatusOut) *httpStatusOut = -1;
-    if (errorOut) *errorOut = "curl_easy_init failed";
-    return "";
+  outBmp = wxBitmap(size, size);
+  return false;
+#else
+  // DESKTOP → SVG preferred, PNG fallback
+  wxString svgPath = basePathWithoutExt + ".svg";
+  wxString pngPath = basePathWithoutExt + ".png";
+
+  if (wxFileExists(svgPath)) {
+    wxBitmapBundle bundle =
+        wxBitmapBundle::FromSVGFile(svgPath, wxSize(size, size));
+    if (bundle.IsOk()) {
+      outBmp = bundle.GetBitmap(wxSize(size, size));
+      return true;
+    }
   }
 
-  std::string response;
-  struct curl_slist* headers = NULL;
+  if (wxFileExists(pngPath)) {
+    wxBitmap bmp(pngPath, wxBITMAP_TYPE_PNG);
+    if (bmp.IsOk()) {
+      outBmp = bmp;
+      return true;
+    }
+  }
 
-  if (!authHeader.IsEmpty()) {
-    headers = curl_slist_append(headers, authHeader.mb_str().data());
+  outBmp = wxBitmap(size, size);
+  return false;
+#endif
+}
+
+tpSignalKNotesManager::tpSignalKNotesManager(signalk_notes_opencpn_pi* parent)
+    : m_governor(parent),
+      m_detailsCache(new tpNoteDetailsCache()),
+      m_offlineStore(
+          new tpOfflineStore(parent->m_pluginDataDir + "data/offline/")),
+      m_warmStartFile(
+          new tpWarmStartFile(parent->m_pluginDataDir + "data/warmstart.bin")),
+      m_noteSnapshot(std::make_shared<tpNoteSnapshot>()) {
+  m_parent = parent;
+  m_serverHost = wxEmptyString;
+  m_serverPort = 3000;
+  m_http.SetGovernor(&m_governor);
+}
+
+tpSignalKNotesManager::~tpSignalKNotesManager() {
+  StopStream();
+  StopFetchWorker();
+  StopOfflineDownload();
+}
+
+void tpSignalKNotesManager::SetServerDetails(const wxString& host, int port) {
+  m_serverHost = host;
+  m_serverPort = port;
+
+  m_detailsCache->Clear();
+  m_detailsFailed.clear();
+  m_rsSnapshots.clear();
+  m_rsInFlight.clear();
+  m_rsRetryTimes.clear();
+}
+
+void tpSignalKNotesManager::StartFetchWorker() {
+  if (m_fetchWorker || !m_extraWorkers.empty()) return;
+
+  for (size_t server = 0; server < GetServerCount(); server++) {
+    tpFetchWorker* worker = new tpFetchWorker(this);
+    if (worker->Create() != wxTHREAD_NO_ERROR ||
+        worker->Run() != wxTHREAD_NO_ERROR) {
+      SKN_LOG(m_parent, "Failed to start fetch worker thread for %s",
+              GetServer(server).GetId());
+      delete worker;
+      worker = nullptr;
+    }
+
+    if (server == 0)
+      m_fetchWorker = worker;
+    else
+      m_extraWorkers.push_back(worker);
   }
+}
+
+void tpSignalKNotesManager::StopFetchWorker() {
+  std::vector<tpFetchWorker*> workers(m_extraWorkers);
+  if (m_fetchWorker) workers.push_back(m_fetchWorker);
+  m_fetchWorker = nullptr;
+  m_extraWorkers.clear();
+  if (workers.empty()) return;
 
-  curl_easy_setopt(curl, CURLOPT_URL, url.mb_str().data());
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, CurlWriteCallback);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  // Erst alle anhalten, dann warten: laufende Abrufe brechen parallel ab
+  for (auto* worker : workers) {
+    if (worker) worker->RequestStop();
+  }
+  for (auto* worker : workers) {
+    if (!worker) continue;
+    worker->Wait();
+    delete worker;
+  }
 
-  if (headers) curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  wxMutexLocker lock(m_fetchResultsMutex);
+  m_fetchResults.clear();
+}
 
-  CURLcode res = curl_easy_perform(curl);
+void tpSignalKNotesManager::LoadWarmStart() {
+  wxLongLong start = wxGetLocalTimeMillis();
+  tpWarmStartFile::Contents contents;
+  if (!m_warmStartFile->Load(contents)) {
+    SKN_LOG(m_parent, "Warm start: no usable file");
+    return;
+  }
 
-  long httpCode = 0;
-  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+  m_discoveredProviders.insert(contents.providers.begin(),
+                               contents.providers.end());
+  m_discoveredIcons.insert(contents.icons.begin(), contents.icons.end());
+
+  size_t notes = 0;
+  for (auto& tile : contents.tiles) {
+    notes += tile.notes.size();
+    m_warmTiles[tile.server][tile.quadKey].swap(tile.notes);
+  }
+
+  // Resourcesets nur vom selben Server; die Konfiguration prüft
+  // TakeResourceSetSnapshots über den configKey
+  int resourceSets = 0;
+  if (contents.server == GetServer(0).GetId()) {
+    for (auto& rs : contents.resourceSets) {
+      tpResourceSetSnapshot& snapshot = m_rsSnapshots[rs.name];
+      snapshot.configKey = rs.configKey;
+      snapshot.dataTime = rs.dataTime;
+      snapshot.checkTime = 0;
+      snapshot.restored = true;
+      snapshot.result.ok = true;
+      snapshot.result.flat = rs.flat;
+      snapshot.result.notes = rs.notes;
+      notes += rs.notes->GetCount();
+      resourceSets++;
+    }
+  }
+  m_warmStartNotes = notes;
 
-  if (httpStatusOut) *httpStatusOut = httpCode;
+  SKN_LOG(m_parent,
+          "Warm start: %d tiles, %d resourcesets, %zu notes read in %ld ms",
+          (int)contents.tiles.size(), resourceSets, notes,
+          (wxGetLocalTimeMillis() - start).ToLong());
+}
 
-  if (res != CURLE_OK) {
-    if (errorOut)
-      *errorOut = wxString::Format("CURL error: %s", curl_easy_strerror(res));
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    return "";
+void tpSignalKNotesManager::SaveWarmStart() {
+  wxLongLong start = wxGetLocalTimeMillis();
+  tpWarmStartFile::Contents contents;
+  contents.server = GetServer(0).GetId();
+  contents.providers = m_discoveredProviders;
+  contents.icons = m_discoveredIcons;
+
+  // Kacheln aller Server. Was aus der letzten Sitzung noch nicht bestätigt
+  // wurde, bleibt ebenfalls erhalten, aber nicht doppelt.
+  std::set<std::pair<wxString, wxString>> seen;
+  auto addTile = [&](const wxString& server, const wxString& quadKey,
+                     const std::map<wxString, SignalKNote>& notes) {
+    if (notes.empty() || !seen.insert(std::make_pair(server, quadKey)).second)
+      return;
+    tpWarmStartFile::Tile tile;
+    tile.server = server;
+    tile.quadKey = quadKey;
+    tile.notes = notes;
+    contents.tiles.push_back(std::move(tile));
+  };
+  for (const auto& cacheKv : m_tileCaches) {
+    wxString server = GetServer(cacheKv.first).GetId();
+    cacheKv.second->ForEachStored(
+        [&](const wxString& quadKey,
+            const std::map<wxString, SignalKNote>& notes) {
+          addTile(server, quadKey, notes);
+        });
+  }
+  for (const auto& serverKv : m_warmTiles) {
+    for (const auto& tileKv : serverKv.second)
+      addTile(serverKv.first, tileKv.first, tileKv.second);
+  }
+
+  size_t notes = 0;
+  for (const auto& tile : contents.tiles) notes += tile.notes.size();
+  for (const auto& snapKv : m_rsSnapshots) {
+    const tpResourceSetSnapshot& snapshot = snapKv.second;
+    if (!snapshot.result.notes || snapshot.result.notes->GetCount() == 0)
+      continue;
+    tpWarmStartFile::ResourceSet rs;
+    rs.name = snapKv.first;
+    rs.configKey = snapshot.configKey;
+    rs.flat = snapshot.result.flat;
+    rs.dataTime = snapshot.dataTime;
+    rs.notes = snapshot.result.notes;
+    notes += rs.notes->GetCount();
+    contents.resourceSets.push_back(rs);
+  }
+
+  // Ohne Daten die alte Datei behalten, etwa nach einer Sitzung ohne Karte
+  if (notes == 0) return;
+  if (!m_warmStartFile->Save(contents)) {
+    SKN_LOG(m_parent, "Warm start: file could not be written");
+    return;
   }
+  SKN_LOG(m_parent,
+          "Warm start: %d tiles, %d resourcesets, %zu notes written in %ld ms",
+          (int)contents.tiles.size(), (int)contents.resourceSets.size(), notes,
+          (wxGetLocalTimeMillis() - start).ToLong());
+}
 
-  curl_slist_free_all(headers);
-  curl_easy_cleanup(curl);
+tpServerEndpoint tpSignalKNotesManager::GetServer(size_t serverIndex) const {
+  if (serverIndex > 0 && serverIndex <= m_extraServers.size())
+    return m_extraServers[serverIndex - 1];
 
-  if (httpCode != 200) {
-    if (errorOut) *errorOut = wxString::Format("HTTP error %ld", httpCode);
-    return "";
+  tpServerEndpoint server;
+  server.host = m_serverHost;
+  server.port = m_serverPort;
+  return server;
+}
+
+size_t tpSignalKNotesManager::FindServer(const wxString& serverId) const {
+  for (size_t i = 0; i < m_extraServers.size(); i++) {
+    if (m_extraServers[i].GetId() == serverId) return i + 1;
   }
+  return 0;
+}
 
-  return wxString::FromUTF8(response.c_str());
+tpFetchWorker* tpSignalKNotesManager::GetFetchWorker(
+    size_t serverIndex) const {
+  if (serverIndex == 0) return m_fetchWorker;
+  if (serverIndex > m_extraWorkers.size()) return nullptr;
+  return m_extraWorkers[serverIndex - 1];
 }
 
-#endif
+bool tpSignalKNotesManager::InitFetchRequest(int canvasIndex,
+                                             tpFetchRequest& request,
+                                             size_t serverIndex) {
+  if (!GetFetchWorker(serverIndex)) {
+    SKN_LOG(m_parent, "Fetch worker not running - skipping update");
+    return false;
+  }
 
-#ifdef _WIN32
-#include <windows.h>
-#include <winhttp.h>
-#pragma comment(lib, "winhttp.lib")
+  auto stateIt = m_parent->m_canvasStates.find(canvasIndex);
+  if (stateIt == m_parent->m_canvasStates.end()) return false;
+  signalk_notes_opencpn_pi::CanvasState& state = stateIt->second;
 
-wxString HttpGet(const wxString& url, const wxString& authHeader,
-                 long* httpStatusOut, wxString* errorOut) {
-  URL_COMPONENTS uc = {0};
-  uc.dwStructSize = sizeof(uc);
+  tpServerEndpoint server = GetServer(serverIndex);
+  request.canvasIndex = canvasIndex;
+  request.serverIndex = serverIndex;
+  request.serverHost = server.host.Clone();
+  request.serverPort = server.port;
+  request.authToken = m_authToken.Clone();
 
-  wchar_t host[256];
-  wchar_t path[2048];
+  if (state.fetchSession == 0) state.fetchSession = ++m_lastFetchSession;
+  request.fetchSession = state.fetchSession;
+  return true;
+}
 
-  uc.lpszHostName = host;
-  uc.dwHostNameLength = 256;
-  uc.lpszUrlPath = path;
-  uc.dwUrlPathLength = 2048;
+void tpSignalKNotesManager::UpdateDisplayedIcons(double centerLat,
+                                                 double centerLon,
+                                                 double maxDistance,
+                                                 int canvasIndex) {
+  tpFetchRequest request;
+  if (!InitFetchRequest(canvasIndex, request)) return;
+  signalk_notes_opencpn_pi::CanvasState& state =
+      m_parent->m_canvasStates[canvasIndex];
+
+  unsigned long generation = ++m_lastViewportGeneration;
+  tpTileRange range =
+      tpTileCache::RangeForArea(centerLat, centerLon, maxDistance);
+
+  // Was die Caches für den Bereich haben, sofort zeigen - auch veraltete
+  // Kacheln, ihr Abruf folgt
+  for (size_t server = 0; server < GetServerCount(); server++)
+    GetTileCache(server).SetRange(canvasIndex, range);
+  ShowCachedNotes(canvasIndex);
+
+  // Jeder Server über seinen eigenen Worker. Der Stream kommt nur vom
+  // ersten; mit ihm bleiben dessen Kacheln gültig, Änderungen kommen als
+  // Delta
+  wxLongLong now = wxGetLocalTimeMillis();
+  long intervalMs = (long)GetNotesRefreshInterval() * 60 * 1000;
+
+  for (size_t server = 0; server < GetServerCount(); server++) {
+    if (server > 0) {
+      request = tpFetchRequest();
+      if (!InitFetchRequest(canvasIndex, request, server)) continue;
+    }
+    request.centerLat = centerLat;
+    request.centerLon = centerLon;
+    request.maxDistance = maxDistance;
+    request.viewportGeneration = generation;
+
+    tpTileCache& cache = GetTileCache(server);
+    long maxAgeMs = (server == 0 && IsStreaming()) ? -1 : intervalMs;
+    unsigned long hits = cache.GetHits(), misses = cache.GetMisses();
+    cache.CollectMissing(range, now, maxAgeMs, request.tiles, true);
+    request.fetchNotesList = !request.tiles.empty();
+
+    SKN_LOG(m_parent,
+            "Tiles: canvas %d %s zoom %d, %lu cached, %lu to fetch "
+            "(total %lu hits / %lu misses, %lu tiles held)",
+            canvasIndex, GetServer(server).GetId(), range.zoom,
+            cache.GetHits() - hits, cache.GetMisses() - misses,
+            cache.GetHits(), cache.GetMisses(),
+            (unsigned long)cache.GetTileCount());
+
+    // Resourcesets nach eigenem Zeitplan und nur vom ersten Server. Die
+    // Notes des Viewports haben Vorrang: ist der Worker beschäftigt, fährt
+    // nur mit, was nicht warten kann
+    if (server == 0) {
+      bool linkIdle = m_fetchWorker->IsIdle();
+      if (CollectDueResourceSets(state, request.fetchNotesList, linkIdle,
+                                 request.resourceSets) > 0)
+        request.fetchResourceSets = true;
+    }
 
-  if (!WinHttpCrackUrl(url.wc_str(), 0, 0, &uc)) {
-    if (httpStatusOut) *httpStatusOut = -1;
-    if (errorOut) *errorOut = "WinHttpCrackUrl failed";
-    return "";
+    if (request.fetchNotesList || request.fetchResourceSets)
+      GetFetchWorker(server)->Post(request);
   }
+  PublishNotes();
+}
 
-  HINTERNET hSession =
-      WinHttpOpen(L"SignalKNotes/1.0", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-                  WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
+tpTileCache& tpSignalKNotesManager::GetTileCache(size_t serverIndex) {
+  std::unique_ptr<tpTileCache>& cache = m_tileCaches[serverIndex];
+  if (cache) return *cache;
+  cache.reset(new tpTileCache());
 
-  if (!hSession) {
-    if (httpStatusOut) *httpStatusOut = -1;
-    if (errorOut) *errorOut = "WinHttpOpen failed";
-    return "";
+  // Neuer Cache zeigt, was die letzte Sitzung hatte, bis der Server antwortet
+  auto warmIt = m_warmTiles.find(GetServer(serverIndex).GetId());
+  if (warmIt != m_warmTiles.end()) {
+    for (const auto& tileKv : warmIt->second)
+      cache->Restore(tileKv.first, tileKv.second);
   }
+  return *cache;
+}
 
-  HINTERNET hConnect = WinHttpConnect(hSession, uc.lpszHostName, uc.nPort, 0);
-  if (!hConnect) {
-    if (httpStatusOut) *httpStatusOut = -1;
-    if (errorOut) *errorOut = "WinHttpConnect failed";
-    WinHttpCloseHandle(hSession);
-    return "";
+// Notes aller Kacheln im Bereich des Canvas anzeigen. Liefern mehrere
+// Server dieselbe Note, gilt die des ersten
+void tpSignalKNotesManager::ShowCachedNotes(int canvasIndex) {
+  std::map<wxString, SignalKNote> notes;
+  wxLongLong now = wxGetLocalTimeMillis();
+  for (size_t server = 0; server < GetServerCount(); server++) {
+    tpTileCache& cache = GetTileCache(server);
+    cache.CollectNotes(cache.GetRange(canvasIndex), now, notes);
   }
+  if (ApplyNotesList(canvasIndex, notes) == 0) return;
+  if (UpdateNoteDisplayFlags()) m_parent->SaveConfig();
+}
 
-  HINTERNET hRequest = WinHttpOpenRequest(
-      hConnect, L"GET", uc.lpszUrlPath, NULL, WINHTTP_NO_REFERER,
-      WINHTTP_DEFAULT_ACCEPT_TYPES,
-      (uc.nScheme == INTERNET_SCHEME_HTTPS) ? WINHTTP_FLAG_SECURE : 0);
+bool tpSignalKNotesManager::TileRangeChanged(int canvasIndex,
+                                             double centerLat,
+                                             double centerLon,
+                                             double maxDistance) const {
+  auto it = m_tileCaches.find(0);
+  if (it == m_tileCaches.end()) return true;
+  return it->second->GetRange(canvasIndex) !=
+         tpTileCache::RangeForArea(centerLat, centerLon, maxDistance);
+}
 
-  if (!hRequest) {
-    if (httpStatusOut) *httpStatusOut = -1;
-    if (errorOut) *errorOut = "WinHttpOpenRequest failed";
-    WinHttpCloseHandle(hConnect);
-    WinHttpCloseHandle(hSession);
-    return "";
+// Bleibt das Ergebnis eines Resourceset-Abrufs aus (Canvas geschlossen),
+// fordert der nächste Canvas es danach selbst an
+static const long RS_IN_FLIGHT_TIMEOUT_MS = 2 * 60 * 1000;
+// Fehlgeschlagener Abruf: erneut nach dieser Pause statt nach dem ganzen
+// Intervall. Ist der Server weg, hält der Circuit Breaker die Abrufe auf.
+static const long RS_RETRY_MS = 30 * 1000;
+// Ein Canvas hält die Resourceset-Notes im Umkreis von RS_WINDOW_FACTOR
+// Sichtradien, zusammengesucht aus den Kacheln des tpNoteBatch-Index
+static const double RS_WINDOW_FACTOR = 3.0;
+// Ab dieser Größe hält der Snapshot nur die Kacheln im Umkreis von
+// RS_KEEP_FACTOR Fensterradien um die Fenster aller Canvas. Ein Fenster, das
+// diesen Bereich verlässt, lädt das Set neu.
+static const size_t RS_TRIM_MIN_NOTES = 10000;
+static const double RS_KEEP_FACTOR = 3.0;
+static const double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+// Abstand in Metern, für die kurzen Strecken der Fenster genau genug
+static double WindowDistance(double lat, double lon, double otherLat,
+                             double otherLon) {
+  double dLon = std::remainder(lon - otherLon, 360.0);
+  double north = (lat - otherLat) * 111120.0;
+  double east = dLon * 111120.0 * std::cos(lat * DEG_TO_RAD);
+  return std::hypot(north, east);
+}
+
+// Hat der Snapshot die Notes um das Fenster des Canvas?
+static bool CoversWindow(const tpResourceSetSnapshot& snapshot,
+                         const signalk_notes_opencpn_pi::CanvasState& state) {
+  if (snapshot.kept.empty()) return true;
+  if (state.rsWindowRadius <= 0) return false;
+  for (const auto& area : snapshot.kept) {
+    if (WindowDistance(state.rsWindowLat, state.rsWindowLon, area.lat,
+                       area.lon) +
+            state.rsWindowRadius <=
+        area.radius)
+      return true;
   }
+  return false;
+}
 
-  if (!authHeader.IsEmpty()) {
-    std::wstring hdr = std::wstring(authHeader.wc_str());
-    WinHttpAddRequestHeaders(
-        hRequest, hdr.c_str(), (DWORD)-1,
-        WINHTTP_ADDREQ_FLAG_ADD | WINHTTP_ADDREQ_FLAG_REPLACE);
+// Nur aktivierte Unter-RS gehen ins Parse-Ergebnis ein. Neu entdeckte,
+// noch deaktivierte ändern den Schlüssel daher nicht.
+static wxString SubSetsKey(
+    const signalk_notes_opencpn_pi::ResourceSetConfig& config) {
+  wxString key;
+  for (const auto& sub : config.subSets) {
+    if (!sub.second.enabled) continue;
+    key += wxString::Format("|%s:%s", sub.first, sub.second.iconName);
   }
+  return key;
+}
 
-  if (!WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0,
-                          WINHTTP_NO_REQUEST_DATA, 0, 0, 0)) {
-    if (httpStatusOut) *httpStatusOut = -1;
-    if (errorOut) *errorOut = "WinHttpSendRequest failed";
-    WinHttpCloseHandle(hRequest);
-    WinHttpCloseHandle(hConnect);
-    WinHttpCloseHandle(hSession);
-    return "";
+void tpSignalKNotesManager::ScheduleResourceSets(int canvasIndex) {
+  auto stateIt = m_parent->m_canvasStates.find(canvasIndex);
+  if (stateIt == m_parent->m_canvasStates.end() || !stateIt->second.valid)
+    return;
+
+  // Was andere Canvas inzwischen geladen haben, kostet keinen Abruf
+  if (TakeResourceSetSnapshots(stateIt->second) > 0) {
+    PublishNotes();
+    RequestRefresh(m_parent->m_parent_window);
   }
 
-  if (!WinHttpReceiveResponse(hRequest, NULL)) {
-    if (httpStatusOut) *httpStatusOut = -1;
-    if (errorOut) *errorOut = "WinHttpReceiveResponse failed";
-    WinHttpCloseHandle(hRequest);
-    WinHttpCloseHandle(hConnect);
-    WinHttpCloseHandle(hSession);
-    return "";
+  if (!m_fetchWorker || !m_fetchWorker->IsIdle()) return;
+
+  tpFetchRequest request;
+  if (!InitFetchRequest(canvasIndex, request)) return;
+  if (CollectDueResourceSets(stateIt->second, false, true,
+                             request.resourceSets) == 0)
+    return;
+
+  SKN_LOG(m_parent, "Scheduler: canvas %d, %d resourcesets refreshed on idle",
+          canvasIndex, (int)request.resourceSets.size());
+  request.fetchNotesList = false;
+  request.fetchResourceSets = true;
+  m_fetchWorker->Post(request);
+}
+
+// Fällige Resourcesets eines Canvas nach out übernehmen und als abgerufen
+// markieren. Nie geladene Sets sind immer fällig, sonst entscheidet die
+// Priorität, ob ein Set nach Ablauf seines Intervalls sofort mitfährt oder
+// auf eine freie Leitung wartet - längstens bis maxStaleMinutes. Was ein
+// anderer Canvas gerade lädt oder schon geladen hat, wird nicht abgerufen.
+int tpSignalKNotesManager::CollectDueResourceSets(
+    signalk_notes_opencpn_pi::CanvasState& state, bool withViewport,
+    bool linkIdle,
+    std::map<wxString, signalk_notes_opencpn_pi::ResourceSetConfig>& out) {
+  TakeResourceSetSnapshots(state);
+
+  wxLongLong now = wxGetLocalTimeMillis();
+  int count = 0;
+
+  for (const auto& rsKv : m_parent->m_resourceSetConfigs) {
+    const signalk_notes_opencpn_pi::ResourceSetConfig& cfg = rsKv.second;
+    if (!cfg.enabled) continue;
+
+    // Ergebnis kommt per Snapshot; bleibt es aus, nach Ablauf neu anfordern
+    auto flightIt = m_rsInFlight.find(rsKv.first);
+    if (flightIt != m_rsInFlight.end() &&
+        (now - flightIt->second).ToLong() < RS_IN_FLIGHT_TIMEOUT_MS)
+      continue;
+
+    auto retryIt = m_rsRetryTimes.find(rsKv.first);
+    bool retry = retryIt != m_rsRetryTimes.end();
+    if (retry && now < retryIt->second) continue;
+
+    bool due;
+    auto timeIt = state.rsFetchTimes.find(rsKv.first);
+    auto snapIt = m_rsSnapshots.find(rsKv.first);
+    if (retry) {
+      due = true;
+    } else if (timeIt == state.rsFetchTimes.end() ||
+        (snapIt != m_rsSnapshots.end() && snapIt->second.restored &&
+         timeIt->second <= snapIt->second.dataTime)) {
+      // Auch der übernommene Stand der letzten Sitzung gilt als nie geladen
+      due = true;
+    } else if (snapIt != m_rsSnapshots.end() &&
+               !CoversWindow(snapIt->second, state)) {
+      // Zugeschnittener Stand reicht nicht bis ins Fenster
+      due = true;
+    } else if (IsStreaming()) {
+      // Änderungen kommen als Delta
+      due = false;
+    } else {
+      long ageMs = (now - timeIt->second).ToLong();
+      long refreshMs = GetResourceSetRefreshMs(cfg);
+      long staleMs =
+          std::max(refreshMs, (long)cfg.maxStaleMinutes * 60 * 1000);
+
+      if (ageMs <= refreshMs) {
+        due = false;
+      } else if (ageMs > staleMs) {
+        due = true;
+      } else if (cfg.priority ==
+                 signalk_notes_opencpn_pi::RS_PRIORITY_HIGH) {
+        due = true;
+      } else if (cfg.priority ==
+                 signalk_notes_opencpn_pi::RS_PRIORITY_BACKGROUND) {
+        // Nie zusammen mit Viewport-Notes, nur als eigener Abruf
+        due = linkIdle && !withViewport;
+      } else {
+        due = linkIdle;
+      }
+    }
+
+    if (!due) continue;
+    out[rsKv.first] = cfg;
+    state.rsFetchTimes[rsKv.first] = now;
+    m_rsInFlight[rsKv.first] = now;
+    count++;
   }
 
-  DWORD status = 0;
-  DWORD size = sizeof(status);
+  return count;
+}
+
+long tpSignalKNotesManager::GetResourceSetRefreshMs(
+    const signalk_notes_opencpn_pi::ResourceSetConfig& config) const {
+  return (long)(config.refreshMinutes > 0 ? config.refreshMinutes
+                                          : m_parent->GetFetchInterval()) *
+         60 * 1000;
+}
 
-  if (!WinHttpQueryHeaders(
-          hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
-          WINHTTP_HEADER_NAME_BY_INDEX, &status, &size,
-          WINHTTP_NO_HEADER_INDEX)) {
-    if (httpStatusOut) *httpStatusOut = -1;
-    if (errorOut) *errorOut = "WinHttpQueryHeaders failed";
-    WinHttpCloseHandle(hRequest);
-    WinHttpCloseHandle(hConnect);
-    WinHttpCloseHandle(hSession);
-    return "";
+const tpResourceSetSnapshot* tpSignalKNotesManager::FindResourceSetSnapshot(
+    const wxString& resourceSetName,
+    const signalk_notes_opencpn_pi::ResourceSetConfig& config,
+    wxLongLong now) const {
+  auto it = m_rsSnapshots.find(resourceSetName);
+  if (it == m_rsSnapshots.end()) return nullptr;
+  const tpResourceSetSnapshot& snapshot = it->second;
+
+  if (snapshot.configKey != SubSetsKey(config)) return nullptr;
+  // Mit Stream kommen Änderungen als Delta und lösen einen Abruf aus
+  if (!IsStreaming() &&
+      (now - snapshot.checkTime).ToLong() > GetResourceSetRefreshMs(config))
+    return nullptr;
+  return &snapshot;
+}
+
+void tpSignalKNotesManager::StoreResourceSetSnapshot(
+    const wxString& resourceSetName,
+    const signalk_notes_opencpn_pi::ResourceSetConfig& config,
+    tpResourceSetResult& result, wxLongLong now) {
+  tpResourceSetSnapshot& snapshot = m_rsSnapshots[resourceSetName];
+  snapshot.configKey = SubSetsKey(config);
+  snapshot.checkTime = now;
+  bool restored = snapshot.restored;
+  snapshot.restored = false;
+  // Vor dem Vergleich: der alte Stand ist ebenso zugeschnitten
+  TrimResourceSet(resourceSetName, result, snapshot.kept);
+
+  // Inhaltlich gleicher Stand: alter Batch und alte dataTime bleiben, so
+  // übernimmt kein Canvas etwas und keiner baut seine Cluster neu
+  const tpNoteBatch* oldBatch = snapshot.result.notes.get();
+  if (oldBatch && result.notes) {
+    tpNoteBatch::Delta delta = result.notes->CompareTo(*oldBatch);
+    if (delta.IsEmpty()) {
+      SKN_LOG(m_parent, "Resourceset %s: content unchanged, %zu notes kept",
+              resourceSetName, oldBatch->GetCount());
+      result.notes = snapshot.result.notes;
+      std::swap(snapshot.result, result);
+      // Bestätigt: die anderen Canvas übernehmen ihn, statt selbst zu laden
+      if (restored) snapshot.dataTime = now;
+      return;
+    }
+    SKN_LOG(m_parent, "Resourceset %s: %zu added, %zu changed, %zu removed",
+            resourceSetName, delta.added, delta.changed, delta.removed);
+  }
+
+  snapshot.dataTime = now;
+  // Der alte Stand wird mit seiner letzten Referenz als Ganzes freigegeben
+  std::swap(snapshot.result, result);
+
+  // Allokationen und Speicherbedarf je Note, zum Vergleich mit
+  // wxString-Feldern
+  const tpNoteBatch* batch = snapshot.result.notes.get();
+  if (m_parent->IsDebugMode() && batch && batch->GetCount() > 0) {
+    // Beschreibungen zählen dort unkomprimiert
+    const tpDescriptionStore& descriptions = batch->GetDescriptions();
+    size_t wideBytes = descriptions.GetRawBytes() * sizeof(wxChar);
+    for (const auto& note : batch->GetNotes())
+      wideBytes += note.GetWideMemoryUsage();
+    size_t count = batch->GetCount();
+    SKN_LOG(m_parent,
+            "Resourceset %s: %zu notes in %zu allocations, %zu bytes/note "
+            "(as wxString: %zu), %zu pooled strings, descriptions %zu KB "
+            "deflated to %zu KB",
+            resourceSetName, count, batch->GetAllocations(),
+            batch->GetMemoryUsage() / count, wideBytes / count,
+            tpStringPool::GetCount(), descriptions.GetRawBytes() / 1024,
+            descriptions.GetCompressedBytes() / 1024);
   }
+}
 
-  if (httpStatusOut) *httpStatusOut = status;
+void tpSignalKNotesManager::TrimResourceSet(
+    const wxString& resourceSetName, tpResourceSetResult& result,
+    std::vector<tpResourceSetSnapshot::Area>& kept) const {
+  kept.clear();
+  if (!result.notes || result.notes->GetCount() < RS_TRIM_MIN_NOTES) return;
+
+  std::vector<tpTileRange> ranges;
+  for (const auto& stateKv : m_parent->m_canvasStates) {
+    const signalk_notes_opencpn_pi::CanvasState& state = stateKv.second;
+    if (!state.valid) continue;
+    // Ein Canvas ohne Fenster zeigt das ganze Set
+    if (state.rsWindowRadius <= 0) {
+      kept.clear();
+      return;
+    }
+    tpResourceSetSnapshot::Area area;
+    area.lat = state.rsWindowLat;
+    area.lon = state.rsWindowLon;
+    area.radius = RS_KEEP_FACTOR * state.rsWindowRadius;
+    kept.push_back(area);
+    ranges.push_back(tpTileCache::RangeAtZoom(
+        area.lat, area.lon, area.radius, tpNoteBatch::INDEX_ZOOM));
+  }
+  if (ranges.empty()) return;
+
+  size_t count = result.notes->GetCount();
+  std::shared_ptr<tpNoteBatch> trimmed = result.notes->Extract(ranges);
+  if (trimmed->GetCount() == count) {
+    kept.clear();
+    return;
+  }
+  result.notes = trimmed;
+  SKN_LOG(m_parent, "Resourceset %s: %zu of %zu notes kept around %zu windows",
+          resourceSetName, trimmed->GetCount(), count, kept.size());
+}
+
+void tpSignalKNotesManager::UpdateResourceSetWindow(int canvasIndex,
+                                                    double centerLat,
+                                                    double centerLon,
+                                                    double maxDistance) {
+  auto stateIt = m_parent->m_canvasStates.find(canvasIndex);
+  if (stateIt == m_parent->m_canvasStates.end() || maxDistance <= 0) return;
+  signalk_notes_opencpn_pi::CanvasState& state = stateIt->second;
+
+  // Fenster bleibt, solange der Sichtbereich darin liegt und es nach dem
+  // Hineinzoomen nicht unnötig groß ist
+  if (state.rsWindowRadius > 0 &&
+      state.rsWindowRadius <= 2 * RS_WINDOW_FACTOR * maxDistance) {
+    if (WindowDistance(centerLat, centerLon, state.rsWindowLat,
+                       state.rsWindowLon) +
+            maxDistance <=
+        state.rsWindowRadius)
+      return;
+  }
 
-  std::string response;
-  DWORD bytesAvailable = 0;
+  state.rsWindowLat = centerLat;
+  state.rsWindowLon = centerLon;
+  state.rsWindowRadius = RS_WINDOW_FACTOR * maxDistance;
 
-  do {
-    if (!WinHttpQueryDataAvailable(hRequest, &bytesAvailable)) break;
-    if (bytesAvailable == 0) break;
+  // Nur was der Canvas schon übernommen hat, neu zuschneiden
+  int count = 0;
+  for (const auto& rsKv : m_parent->m_resourceSetConfigs) {
+    if (!rsKv.second.enabled) continue;
+    if (state.rsFetchTimes.find(rsKv.first) == state.rsFetchTimes.end())
+      continue;
+    auto snapIt = m_rsSnapshots.find(rsKv.first);
+    if (snapIt == m_rsSnapshots.end() ||
+        snapIt->second.configKey != SubSetsKey(rsKv.second))
+      continue;
 
-    std::vector<char> buffer(bytesAvailable);
-    DWORD bytesRead = 0;
+    ApplyResourceSetResult(state, rsKv.first, snapIt->second,
+                           rsKv.second.subSets);
+    count++;
+  }
+  if (count == 0) return;
+
+  state.notesDirty = true;
+  PublishNotes();
+  if (!m_parent->IsDebugMode()) return;
+
+  // Das Fenster begrenzt, was Cluster und Hit-Test sehen. Im Speicher
+  // bleibt mehr: kleine Sets ganz, große im weiteren Umkreis aller Fenster
+  // (TrimResourceSet). Daher beides ausweisen.
+  size_t inWindow = 0;
+  for (const auto& viewKv : state.resourceSets)
+    inWindow += viewKv.second.window.size();
+  size_t held = 0, heldBytes = 0;
+  for (const auto& snapKv : m_rsSnapshots) {
+    const tpNoteBatch* batch = snapKv.second.result.notes.get();
+    if (!batch) continue;
+    held += batch->GetCount();
+    heldBytes += batch->GetMemoryUsage();
+  }
+  SKN_LOG(m_parent,
+          "Resourcesets: canvas %d window moved, %zu notes in window, %zu "
+          "notes (%zu KB) resident for all sets",
+          canvasIndex, inWindow, held, heldBytes / 1024);
+}
 
-    if (!WinHttpReadData(hRequest, buffer.data(), bytesAvailable, &bytesRead))
-      break;
+void tpSignalKNotesManager::CollectResourceSetWindow(
+    const signalk_notes_opencpn_pi::CanvasState& state,
+    const tpNoteBatch& batch, std::vector<const SignalKNote*>& out) const {
+  if (state.rsWindowRadius <= 0) {
+    out.reserve(batch.GetCount());
+    for (const auto& note : batch.GetNotes()) out.push_back(&note);
+    return;
+  }
 
-    response.append(buffer.data(), bytesRead);
+  tpTileRange window = tpTileCache::RangeAtZoom(
+      state.rsWindowLat, state.rsWindowLon, state.rsWindowRadius,
+      tpNoteBatch::INDEX_ZOOM);
+  batch.CollectRange(window, out);
+}
 
-  } while (bytesAvailable > 0);
+int tpSignalKNotesManager::TakeResourceSetSnapshots(
+    signalk_notes_opencpn_pi::CanvasState& state) {
+  wxLongLong now = wxGetLocalTimeMillis();
+  int count = 0;
+
+  for (const auto& rsKv : m_parent->m_resourceSetConfigs) {
+    if (!rsKv.second.enabled) continue;
+    const tpResourceSetSnapshot* snapshot =
+        FindResourceSetSnapshot(rsKv.first, rsKv.second, now);
+    // Stand der letzten Sitzung: sofort zeigen, der Abruf folgt
+    if (!snapshot) {
+      auto snapIt = m_rsSnapshots.find(rsKv.first);
+      if (snapIt != m_rsSnapshots.end() && snapIt->second.restored &&
+          snapIt->second.configKey == SubSetsKey(rsKv.second))
+        snapshot = &snapIt->second;
+    }
+    if (!snapshot) continue;
 
-  WinHttpCloseHandle(hRequest);
-  WinHttpCloseHandle(hConnect);
-  WinHttpCloseHandle(hSession);
+    // Canvas zeigt schon diesen oder einen neueren Stand
+    auto timeIt = state.rsFetchTimes.find(rsKv.first);
+    if (timeIt != state.rsFetchTimes.end() &&
+        timeIt->second >= snapshot->dataTime)
+      continue;
 
-  if (status != 200) {
-    if (errorOut) *errorOut = wxString::Format("HTTP error %lu", status);
-    return "";
+    ApplyResourceSetResult(state, rsKv.first, *snapshot, rsKv.second.subSets);
+    state.rsFetchTimes[rsKv.first] = snapshot->dataTime;
+    count++;
   }
 
-  return wxString::FromUTF8(response.c_str());
+  if (count > 0) {
+    state.notesDirty = true;
+    SKN_LOG(m_parent, "Resourcesets: %d taken from snapshot", count);
+  }
+  return count;
 }
 
-#endif
+// Prefetch-Ziel: ein Abfrageradius voraus, also etwa der Bereich, der als
+// Nächstes ins Bild kommt
+static const double PREFETCH_MIN_PAN_RATE = 0.1;  // Radien pro Sekunde
+static const double PREFETCH_MIN_SOG_KN = 1.0;
+static const long OWNSHIP_MAX_AGE_MS = 30 * 1000;
 
-#ifdef __OCPN__ANDROID__
+void tpSignalKNotesManager::SchedulePrefetch(int canvasIndex) {
+  auto stateIt = m_parent->m_canvasStates.find(canvasIndex);
+  if (stateIt == m_parent->m_canvasStates.end() || !stateIt->second.valid)
+    return;
+  signalk_notes_opencpn_pi::CanvasState& state = stateIt->second;
 
-wxString HttpGet(const wxString& url, const wxString& authHeader,
-                 long* httpStatusOut, wxString* errorOut) {
-  wxHTTP http;
-  http.SetTimeout(10);
+  // Erst nach dem ersten echten Abruf
+  double radius = state.lastFetchDistance;
+  if (radius <= 0) return;
 
-  wxURL wxurl(url);
-  if (wxurl.GetError() != wxURL_NOERR) {
-    if (httpStatusOut) *httpStatusOut = -1;
-    if (errorOut) *errorOut = "wxURL parse error";
-    return "";
+  const PlugIn_ViewPort& vp = state.viewPort;
+  double north, east;
+  const char* reason;
+
+  double panSpeed = std::hypot(state.panNorthMps, state.panEastMps);
+  if (panSpeed > radius * PREFETCH_MIN_PAN_RATE) {
+    north = state.panNorthMps / panSpeed;
+    east = state.panEastMps / panSpeed;
+    reason = "pan";
+  } else {
+    // Karte steht: in Fahrtrichtung, aber nur wenn das Schiff im Bild ist
+    const signalk_notes_opencpn_pi::OwnshipState& own = m_parent->GetOwnship();
+    if (!own.valid || std::isnan(own.cog) || own.sog < PREFETCH_MIN_SOG_KN)
+      return;
+    if ((wxGetLocalTimeMillis() - own.fixTime).ToLong() > OWNSHIP_MAX_AGE_MS)
+      return;
+    if (own.lat < vp.lat_min || own.lat > vp.lat_max ||
+        own.lon < vp.lon_min || own.lon > vp.lon_max)
+      return;
+    north = std::cos(own.cog * DEG_TO_RAD);
+    east = std::sin(own.cog * DEG_TO_RAD);
+    reason = "course";
   }
 
-  wxString host = wxurl.GetServer();
-  long port = 80;
-  wxurl.GetPort().ToLong(&port);
-  wxString path = "/" + wxurl.GetPath();
+  double lat = vp.clat + north * radius / 111120.0;
+  lat = std::max(-85.0, std::min(85.0, lat));
+  double lonScale = std::max(0.01, std::cos(lat * DEG_TO_RAD));
+  double lon = vp.clon + east * radius / (111120.0 * lonScale);
+  if (lon > 180.0) lon -= 360.0;
+  if (lon < -180.0) lon += 360.0;
+
+  tpTileRange range = tpTileCache::RangeForArea(lat, lon, radius);
+  wxLongLong now = wxGetLocalTimeMillis();
+  long intervalMs = (long)GetNotesRefreshInterval() * 60 * 1000;
+
+  for (size_t server = 0; server < GetServerCount(); server++) {
+    tpFetchWorker* worker = GetFetchWorker(server);
+    if (!worker || !worker->IsIdle()) continue;
+
+    // Für diese Kacheln schon vorausgeladen
+    tpTileCache& cache = GetTileCache(server);
+    if (!cache.SetPrefetchRange(canvasIndex, range)) continue;
 
-  if (!authHeader.IsEmpty()) {
-    http.SetHeader("Authorization", authHeader.AfterFirst(' ').AfterFirst(' '));
+    tpFetchRequest request;
+    long maxAgeMs = (server == 0 && IsStreaming()) ? -1 : intervalMs;
+    cache.CollectMissing(range, now, maxAgeMs, request.tiles, false);
+    if (request.tiles.empty()) continue;
+
+    if (!InitFetchRequest(canvasIndex, request, server)) continue;
+    request.centerLat = lat;
+    request.centerLon = lon;
+    request.maxDistance = radius;
+    request.prefetch = true;
+    // Gleiche Generation wie der aktuelle Viewport: jeder neuere bricht ab
+    request.viewportGeneration = m_lastViewportGeneration;
+
+    SKN_LOG(m_parent,
+            "Prefetch: canvas %d %s, %d tiles ahead at %.4f/%.4f (%s)",
+            canvasIndex, GetServer(server).GetId(), (int)request.tiles.size(),
+            lat, lon, reason);
+    worker->Post(request);
   }
+}
+
+// Details je Hintergrund-Abruf; sie laufen parallel, der nächste Schwung
+// folgt beim nächsten Render mit freiem Worker
+static const size_t DETAILS_PREFETCH_BATCH = 8;
 
-  if (!http.Connect(host, (unsigned short)port)) {
-    if (httpStatusOut) *httpStatusOut = -1;
-    if (errorOut) *errorOut = "HTTP connect failed";
-    return "";
+void tpSignalKNotesManager::ScheduleDetailsPrefetch(int canvasIndex) {
+  {
+    // Fertige Abrufe erst übernehmen, sonst würden sie doppelt angefordert
+    wxMutexLocker lock(m_fetchResultsMutex);
+    if (!m_fetchResults.empty()) return;
   }
 
-  wxInputStream* in = http.GetInputStream(path);
-  if (!in || !in->IsOk()) {
-    if (httpStatusOut) *httpStatusOut = http.GetResponse();
-    if (errorOut) *errorOut = "HTTP input stream failed";
-    delete in;
-    return "";
+  auto stateIt = m_parent->m_canvasStates.find(canvasIndex);
+  if (stateIt == m_parent->m_canvasStates.end() || !stateIt->second.valid)
+    return;
+  signalk_notes_opencpn_pi::CanvasState& state = stateIt->second;
+
+  struct Candidate {
+    double dist;
+    size_t server;
+    wxString id;
+  };
+
+  // Notes der Cluster ohne Details, nach Abstand des Clusters zur Bildmitte
+  double centerX = state.viewPort.pix_width / 2.0;
+  double centerY = state.viewPort.pix_height / 2.0;
+  std::vector<Candidate> candidates;
+  for (const auto& cluster : state.clusters) {
+    double dx = cluster.screenPos.x - centerX;
+    double dy = cluster.screenPos.y - centerY;
+    double dist = dx * dx + dy * dy;
+
+    for (const auto& id : cluster.noteIds) {
+      // Resourceset-Notes bringen ihre Details mit
+      auto it = m_notes.find(id);
+      if (it == m_notes.end()) continue;
+      const SignalKNote& note = *it->second.note;
+      if (note.HasName() && note.HasDescription()) continue;
+      if (m_detailsCache->Contains(id) ||
+          m_detailsFailed.find(id) != m_detailsFailed.end())
+        continue;
+
+      Candidate candidate;
+      candidate.dist = dist;
+      candidate.server = FindServer(note.GetServer());
+      candidate.id = id;
+      candidates.push_back(candidate);
+    }
   }
+  if (candidates.empty()) return;
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const Candidate& a, const Candidate& b) {
+                     return a.dist < b.dist;
+                   });
+
+  // Details kommen vom Server der Note, über dessen Worker
+  for (size_t server = 0; server < GetServerCount(); server++) {
+    tpFetchWorker* worker = GetFetchWorker(server);
+    if (!worker || !worker->IsIdle()) continue;
+
+    tpFetchRequest request;
+    for (const auto& candidate : candidates) {
+      if (candidate.server != server) continue;
+      request.detailIds.push_back(candidate.id);
+      if (request.detailIds.size() >= DETAILS_PREFETCH_BATCH) break;
+    }
+    if (request.detailIds.empty()) continue;
 
-  if (httpStatusOut) *httpStatusOut = http.GetResponse();
+    if (!InitFetchRequest(canvasIndex, request, server)) continue;
+    request.fetchNotesList = false;
+    request.prefetch = true;
+    request.viewportGeneration = m_lastViewportGeneration;
 
-  wxString response;
-  char buf[4096];
-  while (true) {
-    in->Read(buf, sizeof(buf));
-    size_t read = in->LastRead();
-    if (read == 0) break;
-    response += wxString::FromUTF8(buf, read);
+    SKN_LOG(m_parent, "Details: canvas %d %s, prefetching %d of %d notes",
+            canvasIndex, GetServer(server).GetId(),
+            (int)request.detailIds.size(), (int)candidates.size());
+    worker->Post(request);
   }
-  delete in;
+}
+
+int tpSignalKNotesManager::GetNotesRefreshInterval() const {
+  int fallback = m_parent->GetFetchInterval();
+  int interval = 0;
 
-  if (httpStatusOut && *httpStatusOut != 200) {
-    if (errorOut)
-      *errorOut = wxString::Format("HTTP error %ld", *httpStatusOut);
-    return "";
+  for (const auto& provider : m_providerSettings) {
+    if (!provider.second) continue;
+    auto it = m_providerIntervals.find(provider.first);
+    int minutes = (it != m_providerIntervals.end() && it->second > 0)
+                      ? it->second
+                      : fallback;
+    if (interval == 0 || minutes < interval) interval = minutes;
   }
 
-  return response;
+  return interval > 0 ? interval : fallback;
 }
 
-#endif
+static wxString EncodeResourceSetName(const wxString& name) {
+  wxString encoded = name;
+  encoded.Replace("ä", "%C3%A4");
+  encoded.Replace("ö", "%C3%B6");
+  encoded.Replace("ü", "%C3%BC");
+  encoded.Replace("Ä", "%C3%84");
+  encoded.Replace("Ö", "%C3%96");
+  encoded.Replace("Ü", "%C3%9C");
+  encoded.Replace("ß", "%C3%9F");
+  encoded.Replace(" ", "%20");
+  encoded.Replace("é", "%C3%A9");
+  encoded.Replace("è", "%C3%A8");
+  encoded.Replace("à", "%C3%A0");
+  return encoded;
+}
 
-// Helper: strip extension and return base path (without .svg/.png)
-static wxString GetBasePathWithoutExt(const wxString& fullPath) {
-  wxFileName fn(fullPath);
-  fn.ClearExt();
-  return fn.GetPathWithSep() + fn.GetName();
+static wxString ResourceSetUrl(const wxString& host, int port,
+                               const wxString& resourceSetName) {
+  return wxString::Format("http://%s:%d/signalk/v2/api/resources/%s", host,
+                          port, EncodeResourceSetName(resourceSetName));
 }
 
-// ---------------------------------------------------------------------------
-// Helper: unified icon loader (Desktop: SVG+PNG, Android: PNG only)
-// basePathWithoutExt: full path without extension
-// size: requested size (square)
-// outBmp: resulting bitmap
-// ---------------------------------------------------------------------------
-bool tpSignalKNotesManager::LoadIconSmart(const wxString& basePathWithoutExt,
-                                          int size, wxBitmap& outBmp) {
-#ifdef __OCPN__ANDROID__
-  // ANDROID → PNG ONLY
-  wxString pngPath = basePathWithoutExt + ".png";
+// Notes-Abfrage, die genau eine Kachel abdeckt
+static wxString NotesTileUrl(const wxString& host, int port,
+                             const wxString& quadKey) {
+  // Kleinster Umkreis, der die ganze Kachel enthält; was in die
+  // Nachbarkacheln ragt, wird nach dem Parsen abgeschnitten
+  double lat, lon, radius;
+  tpTileCache::QueryCircle(quadKey, lat, lon, radius);
 
-  wxBitmap bmp(pngPath, wxBITMAP_TYPE_PNG);
-  if (bmp.IsOk()) {
-    outBmp = bmp;
-    return true;
+  wxString notesUrl;
+  notesUrl.Printf(
+      "http://%s:%d/signalk/v2/api/resources/"
+      "notes?position=[%f,%f]&distance=%.0f",
+      host.c_str(), port, lon, lat, radius);
+  return notesUrl;
+}
+
+static wxString NoteDetailsUrl(const wxString& host, int port,
+                               const wxString& noteId) {
+  return wxString::Format("http://%s:%d/signalk/v2/api/resources/notes/%s",
+                          host, port, noteId);
+}
+
+static wxString BearerHeader(const wxString& token) {
+  if (token.IsEmpty()) return wxEmptyString;
+  return "Authorization: Bearer " + token;
+}
+
+// Validator-Schlüssel eines Resourcesets: pro Canvas-Session und mit der
+// Unter-RS-Konfiguration, da sie das Parse-Ergebnis bestimmt
+static wxString ResourceSetCacheKey(
+    const tpFetchRequest& request, const wxString& resourceSetName,
+    const signalk_notes_opencpn_pi::ResourceSetConfig& config) {
+  return wxString::Format("rs|%lu|%s", request.fetchSession,
+                          resourceSetName) +
+         SubSetsKey(config);
+}
+
+// Debug-Log: übertragene gegen dekodierte Bytes einer Antwort
+static void LogTransferSize(signalk_notes_opencpn_pi* plugin,
+                            const wxString& what,
+                            const tpHttpRequest& response) {
+  if (response.bodyBytes == 0) return;
+  if (response.wireBytes < 0) {
+    SKN_LOG(plugin, "%s: %lld bytes decoded (wire size unknown)", what,
+            response.bodyBytes);
+    return;
   }
+  SKN_LOG(plugin, "%s: %lld bytes on wire, %lld decoded (%.0f%% saved)", what,
+          response.wireBytes, response.bodyBytes,
+          100.0 * (1.0 - (double)response.wireBytes /
+                             (double)response.bodyBytes));
+}
 
-  outBmp = wxBitmap(size, size);
-  return false;
-#else
-  // DESKTOP → SVG preferred, PNG fallback
-  wxString svgPath = basePathWithoutExt + ".svg";
-  wxString pngPath = basePathWithoutExt + ".png";
+void tpSignalKNotesManager::ExecuteFetch(
+    tpHttpClient& http, const tpFetchRequest& request, tpFetchResult& result,
+    const std::function<bool()>& isSuperseded) {
+  result.canvasIndex = request.canvasIndex;
+  result.serverIndex = request.serverIndex;
+  result.prefetch = request.prefetch;
 
-  if (wxFileExists(svgPath)) {
-    wxBitmapBundle bundle =
-        wxBitmapBundle::FromSVGFile(svgPath, wxSize(size, size));
-    if (bundle.IsOk()) {
-      outBmp = bundle.GetBitmap(wxSize(size, size));
-      return true;
+  if (request.serverHost.IsEmpty()) {
+    SKN_LOG(m_parent, _("Server host not configured"));
+    result.notesStatus = -2;
+    return;
+  }
+
+  // Notes-Kacheln und alle fälligen Resourcesets gehen als ein Batch raus
+  // und laufen parallel über die gepoolten Verbindungen. Die Kacheln stehen
+  // vorne in tileKeys-Reihenfolge, danach folgen die Resourcesets in
+  // rsNames-Reihenfolge ab rsOffset.
+  std::vector<tpHttpRequest> batch;
+  std::vector<wxString> tileKeys;
+  std::vector<wxString> rsNames;
+
+  // Die Antworten laufen schon während des Downloads durch die Parser
+  std::vector<tpTileResult*> tileResults;
+  std::vector<std::unique_ptr<tpNotesListParser>> tileParsers;
+  std::vector<tpResourceSetResult*> rsResults;
+  std::vector<std::unique_ptr<tpResourceSetParser>> rsParsers;
+
+  if (request.fetchNotesList) {
+    for (const auto& tile : request.tiles) {
+      tileKeys.push_back(tile.quadKey);
+      batch.push_back(tpHttpRequest(NotesTileUrl(
+          request.serverHost, request.serverPort, tile.quadKey)));
+
+      // Validatoren je Kachel, wie der Cache für alle Canvas. Hat er keine
+      // Daten mehr, nützt ein 304 nichts
+      tpHttpRequest& httpRequest = batch.back();
+      httpRequest.cacheKey = "tile|" + tile.quadKey;
+      if (!tile.revalidate) http.ForgetValidators(httpRequest.cacheKey);
+      // Beim Schwenken überholt der nächste Viewport diesen Abruf
+      httpRequest.isCancelled = isSuperseded;
+
+      tileResults.push_back(&result.tiles[tile.quadKey]);
+      tileParsers.push_back(std::unique_ptr<tpNotesListParser>(
+          new tpNotesListParser(this, result, tileResults.back()->notes)));
+      tpNotesListParser* parser = tileParsers.back().get();
+      httpRequest.onData = [parser](const char* data, size_t size) {
+        return parser->Feed(data, size);
+      };
+    }
+  }
+  size_t rsOffset = batch.size();
+
+  if (request.fetchResourceSets) {
+    // Nach Priorität, bei gleicher Priorität nach Name
+    typedef std::pair<const wxString,
+                      signalk_notes_opencpn_pi::ResourceSetConfig>
+        RSEntry;
+    std::vector<const RSEntry*> ordered;
+    for (const auto& rsKv : request.resourceSets) ordered.push_back(&rsKv);
+    std::stable_sort(ordered.begin(), ordered.end(),
+                     [](const RSEntry* a, const RSEntry* b) {
+                       return a->second.priority < b->second.priority;
+                     });
+
+    wxString authHeader = BearerHeader(request.authToken);
+    for (const auto* rsEntry : ordered) {
+      const auto& rsKv = *rsEntry;
+      rsNames.push_back(rsKv.first);
+      batch.push_back(tpHttpRequest(
+          ResourceSetUrl(request.serverHost, request.serverPort, rsKv.first),
+          authHeader));
+      batch.back().cacheKey =
+          ResourceSetCacheKey(request, rsKv.first, rsKv.second);
+
+      rsResults.push_back(&result.resourceSets[rsKv.first]);
+      rsParsers.push_back(std::unique_ptr<tpResourceSetParser>(
+          new tpResourceSetParser(this, rsKv.first, rsKv.second.subSets,
+                                  *rsResults.back())));
+      tpResourceSetParser* parser = rsParsers.back().get();
+      batch.back().onData = [parser](const char* data, size_t size) {
+        return parser->Feed(data, size);
+      };
     }
   }
 
-  if (wxFileExists(pngPath)) {
-    wxBitmap bmp(pngPath, wxBITMAP_TYPE_PNG);
-    if (bmp.IsOk()) {
-      outBmp = bmp;
-      return true;
+  // Vorab geladene Details ganz hinten, sie sind am wenigsten dringend
+  size_t detailsOffset = batch.size();
+  for (const auto& noteId : request.detailIds) {
+    batch.push_back(tpHttpRequest(
+        NoteDetailsUrl(request.serverHost, request.serverPort, noteId)));
+  }
+
+  wxString serverId =
+      wxString::Format("%s:%d", request.serverHost, request.serverPort);
+  int cancelledTiles = 0;
+  http.PerformAll(batch, [&](size_t index, tpHttpRequest& response) {
+    if (index >= detailsOffset) {
+      const wxString& noteId = request.detailIds[index - detailsOffset];
+      SignalKNote note;
+      note.SetId(noteId);
+      note.SetServer(serverId);
+      if (response.status == 200 && response.error.IsEmpty() &&
+          ParseNoteDetailsJSON(response.GetBodyString(), note))
+        result.details[noteId] = note;
+      else
+        result.detailsFailed.insert(noteId);
+      return;
     }
+
+    LogTransferSize(
+        m_parent,
+        index < rsOffset ? "tile " + tileKeys[index]
+                         : rsNames[index - rsOffset],
+        response);
+
+    if (index < rsOffset) {
+      // Abgebrochen für einen neueren Viewport. Fertige Kacheln werden
+      // trotzdem übernommen, der Cache kann sie später brauchen
+      tpTileResult& tileResult = *tileResults[index];
+      if (response.cancelled) {
+        tileResult.notes.clear();
+        tileResult.status = -3;
+        cancelledTiles++;
+        return;
+      }
+      tileResult.status = ProcessNotesListResponse(
+          request, response, *tileParsers[index], tileResult);
+      // Validatoren gelten nur für übernommene Antworten; sonst käme
+      // derselbe Body als "unverändert" zurück und würde nie geladen
+      if (tileResult.status < 0 && response.IsOk())
+        http.ForgetValidators(response.cacheKey);
+      // Server nicht erreichbar: Stand aus dem Offline-Speicher
+      if (tileResult.status < 0 && request.serverIndex == 0)
+        LoadOfflineTile(tileKeys[index], result, tileResult);
+      if (tileResult.status > 0) {
+        tpTileCache::ClipToTile(tileKeys[index], tileResult.notes);
+        tileResult.status = (int)tileResult.notes.size();
+        for (auto& kv : tileResult.notes) kv.second.SetServer(serverId);
+      }
+      return;
+    }
+
+    size_t rsIndex = index - rsOffset;
+    tpResourceSetResult& rsResult = *rsResults[rsIndex];
+    rsResult.ok = ProcessResourceSetResponse(
+        rsNames[rsIndex], response, *rsParsers[rsIndex], rsResult);
+    if (!rsResult.ok && response.IsOk())
+      http.ForgetValidators(response.cacheKey);
+    if (!rsResult.ok) {
+      auto cfgIt = request.resourceSets.find(rsNames[rsIndex]);
+      rsResult.ok = LoadOfflineResourceSet(rsNames[rsIndex],
+                                           cfgIt->second.subSets, rsResult);
+    }
+  });
+
+  if (cancelledTiles > 0) {
+    SKN_LOG(m_parent,
+            "Canvas %d: %d of %d tiles of fetch %lu from %s superseded",
+            request.canvasIndex, cancelledTiles, (int)tileKeys.size(),
+            request.viewportGeneration, serverId);
   }
 
-  outBmp = wxBitmap(size, size);
-  return false;
-#endif
+  result.resourceSetsFetched = request.fetchResourceSets;
 }
 
-tpSignalKNotesManager::tpSignalKNotesManager(signalk_notes_opencpn_pi* parent) {
-  m_parent = parent;
-  m_serverHost = wxEmptyString;
-  m_serverPort = 3000;
+void tpSignalKNotesManager::PublishFetchResult(tpFetchResult& result) {
+  {
+    wxMutexLocker lock(m_fetchResultsMutex);
+    m_fetchResults.push_back(tpFetchResult());
+    std::swap(m_fetchResults.back(), result);
+  }
+  m_uiNotifier.CallAfter([this]() { ApplyPendingFetchResults(); });
 }
 
-void tpSignalKNotesManager::SetServerDetails(const wxString& host, int port) {
-  m_serverHost = host;
-  m_serverPort = port;
+void tpSignalKNotesManager::ApplyPendingFetchResults() {
+  std::vector<tpFetchResult> results;
+  {
+    wxMutexLocker lock(m_fetchResultsMutex);
+    results.swap(m_fetchResults);
+  }
+  if (results.empty()) return;
+
+  for (auto& result : results) ApplyFetchResult(result);
+  PublishNotes();
+
+  RequestRefresh(m_parent->m_parent_window);
 }
 
-void tpSignalKNotesManager::UpdateDisplayedIcons(
-    double centerLat, double centerLon, double maxDistance,
-    signalk_notes_opencpn_pi::CanvasState& state) {
-  int ok = FetchNotesListForCanvas(centerLat, centerLon, maxDistance, state);
-  if (ok < 0) {
-    SKN_LOG(m_parent, "Failed to fetch notes");
+void tpSignalKNotesManager::ApplyFetchResult(tpFetchResult& result) {
+  // Kacheln gehören allen Canvas und werden auch übernommen, wenn der
+  // anfragende inzwischen geschlossen ist
+  auto stateIt = m_parent->m_canvasStates.find(result.canvasIndex);
+  bool canvasOpen = stateIt != m_parent->m_canvasStates.end();
+
+  if (result.notesStatus == -2) {
+    // Nichts abgerufen - Resourcesets beim nächsten Mal erneut versuchen
+    if (canvasOpen) stateIt->second.rsFetchTimes.clear();
+    m_rsInFlight.clear();
     return;
   }
 
-  // Resourcesets abrufen - nur wenn Intervall abgelaufen
-  wxLongLong now = wxGetLocalTimeMillis();
-  bool rsFetchDue = (state.lastRSFetchTime == 0 ||
-                     (now - state.lastRSFetchTime).ToLong() >
-                         (long)(m_parent->GetFetchInterval() * 60 * 1000));
+  for (const auto& provider : result.providers) {
+    m_discoveredProviders.insert(provider);
+    if (m_providerSettings.find(provider) == m_providerSettings.end()) {
+      m_providerSettings[provider] = true;
+    }
+  }
+  m_discoveredIcons.insert(result.icons.begin(), result.icons.end());
+
+  if (!result.details.empty() || !result.detailsFailed.empty()) {
+    for (const auto& kv : result.details)
+      m_detailsCache->Put(kv.first, kv.second);
+    m_detailsFailed.insert(result.detailsFailed.begin(),
+                           result.detailsFailed.end());
+    SKN_LOG(m_parent,
+            "Details: %d loaded, %d failed, cache %lu entries, hit ratio "
+            "%.0f%%",
+            (int)result.details.size(), (int)result.detailsFailed.size(),
+            (unsigned long)m_detailsCache->GetSize(),
+            100.0 * m_detailsCache->GetHitRatio());
+  }
+
+  if (!result.tiles.empty()) {
+    tpTileCache& cache = GetTileCache(result.serverIndex);
+    wxLongLong now = wxGetLocalTimeMillis();
+    int stored = 0, failed = 0, offline = 0;
+
+    for (auto& tileKv : result.tiles) {
+      tpTileResult& tile = tileKv.second;
+      if (tile.status == -3) continue;
+      if (tile.offline) offline++;
+      if (tile.status < 0) {
+        failed++;
+      } else if (tile.unchanged) {
+        // Daten im Cache bestätigt
+        cache.Touch(tileKv.first, now);
+      } else {
+        cache.Store(tileKv.first, tile.notes, now, result.prefetch);
+        stored++;
+      }
+    }
+
+    if (failed > 0 || offline > 0) {
+      SKN_LOG(m_parent,
+              "Failed to fetch %d notes tiles from %s, %d from offline store",
+              failed + offline, GetServer(result.serverIndex).GetId(),
+              offline);
+    }
+    if (result.prefetch) {
+      unsigned long fetched = cache.GetPrefetchedNotes();
+      SKN_LOG(m_parent,
+              "Prefetch: canvas %d, %d tiles stored, hit rate %lu/%lu notes "
+              "(%.0f%%)",
+              result.canvasIndex, stored, cache.GetPrefetchedShown(), fetched,
+              fetched ? 100.0 * (double)cache.GetPrefetchedShown() /
+                            (double)fetched
+                      : 0.0);
+    } else if (stored > 0) {
+      // Jeder Canvas, dessen Bereich die Kacheln berühren
+      for (const auto& pair : m_parent->m_canvasStates) {
+        if (pair.second.valid) ShowCachedNotes(pair.first);
+      }
+    }
+    // Der Server antwortet: neue Caches brauchen den alten Stand nicht mehr
+    if (stored > 0 && !result.prefetch)
+      m_warmTiles.erase(GetServer(result.serverIndex).GetId());
+  }
 
-  if (m_parent && rsFetchDue) {
-    std::set<wxString> activeRSNames;
+  if (!result.resourceSetsFetched) return;
+  for (const auto& resKv : result.resourceSets)
+    m_rsInFlight.erase(resKv.first);
+  if (!canvasOpen) {
+    SKN_LOG(m_parent, "Dropping resourcesets for closed canvas %d",
+            result.canvasIndex);
+    return;
+  }
+  signalk_notes_opencpn_pi::CanvasState& state = stateIt->second;
 
-    for (auto& rsKv : m_parent->m_resourceSetConfigs) {
-      if (!rsKv.second.enabled) continue;
-      activeRSNames.insert(rsKv.first);
+  std::set<wxString> activeRSNames;
+  bool rsChanged = false;
+  wxLongLong now = wxGetLocalTimeMillis();
 
-      std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>
-          discovered;
-      FetchResourceSet(rsKv.first, discovered, state, rsKv.second.subSets);
+  for (auto& rsKv : m_parent->m_resourceSetConfigs) {
+    if (!rsKv.second.enabled) continue;
+    activeRSNames.insert(rsKv.first);
+
+    auto resIt = result.resourceSets.find(rsKv.first);
+    if (resIt == result.resourceSets.end()) continue;
+    if (!resIt->second.ok) {
+      // Als abgerufen vermerkt wurde es schon beim Einplanen
+      m_rsRetryTimes[rsKv.first] = now + RS_RETRY_MS;
+      SKN_LOG(m_parent, "Resourceset %s failed, retry in %ld s", rsKv.first,
+              RS_RETRY_MS / 1000);
+      continue;
+    }
+    m_rsRetryTimes.erase(rsKv.first);
 
-      for (auto& sub : discovered) {
-        if (rsKv.second.subSets.find(sub.first) == rsKv.second.subSets.end()) {
-          rsKv.second.subSets[sub.first] = sub.second;
-        }
+    if (resIt->second.unchanged) {
+      auto snapIt = m_rsSnapshots.find(rsKv.first);
+      if (snapIt != m_rsSnapshots.end()) snapIt->second.checkTime = now;
+      continue;
+    }
+
+    for (auto& sub : resIt->second.discoveredSubs) {
+      if (rsKv.second.subSets.find(sub.first) == rsKv.second.subSets.end()) {
+        rsKv.second.subSets[sub.first] = sub.second;
       }
     }
 
-    // Cleanup ohne Mutex — separater Lock-Block
-    {
-      wxMutexLocker lock(state.notesMutex);
-      std::vector<wxString> toRemove;
-      for (auto& kv : state.resourceSetNotes) {
-        wxString rsName = kv.second.source.AfterFirst(':').BeforeLast(':');
-        if (activeRSNames.find(rsName) == activeRSNames.end()) {
-          toRemove.push_back(kv.first);
-        }
+    // Die anderen Canvas übernehmen das Ergebnis, statt selbst zu laden
+    StoreResourceSetSnapshot(rsKv.first, rsKv.second, resIt->second, now);
+    if (ApplyResourceSetResult(state, rsKv.first, m_rsSnapshots[rsKv.first],
+                               rsKv.second.subSets))
+      rsChanged = true;
+    state.rsFetchTimes[rsKv.first] = now;
+  }
+
+  for (auto it = state.resourceSets.begin(); it != state.resourceSets.end();) {
+    if (activeRSNames.find(it->first) == activeRSNames.end()) {
+      it = state.resourceSets.erase(it);
+      m_notesChanged = true;
+      rsChanged = true;
+    } else {
+      ++it;
+    }
+  }
+  // Cluster nur neu, wenn sich ein Resourceset tatsächlich geändert hat
+  if (rsChanged) state.notesDirty = true;
+}
+
+// Icon-Zuordnung und Sichtbarkeit (Provider-Einstellung) der Notes
+// nachziehen. Rückgabe: true wenn neue Icon-Zuordnungen angelegt wurden.
+bool tpSignalKNotesManager::UpdateNoteDisplayFlags() {
+  bool newMappingsFound = false;
+
+  for (auto& pair : m_notes) {
+    const SignalKNote& note = *pair.second.note;
+
+    const wxString& iconName = note.GetIconName();
+    if (!iconName.IsEmpty()) {
+      if (m_iconMappings.find(iconName) == m_iconMappings.end()) {
+        wxString iconPath = ResolveIconPath(iconName);
+        m_iconMappings[iconName] = iconPath;
+        newMappingsFound = true;
       }
-      for (auto& guid : toRemove) state.resourceSetNotes.erase(guid);
-    }  // ← Lock wird hier freigegeben
+    }
+
+    bool providerEnabled = IsProviderEnabled(note);
+    if (note.isDisplayed == providerEnabled) continue;
+
+    // Veröffentlichte Snapshots teilen die Note: ersetzen statt ändern
+    std::shared_ptr<SignalKNote> copy = std::make_shared<SignalKNote>(note);
+    copy->isDisplayed = providerEnabled;
+    pair.second.note = copy;
+    m_notesChanged = true;
+  }
+
+  return newMappingsFound;
+}
+
+bool tpSignalKNotesManager::IsProviderEnabled(const SignalKNote& note) const {
+  if (note.GetSource().IsEmpty()) return true;
+  auto it = m_providerSettings.find(note.GetSource());
+  return it == m_providerSettings.end() || it->second;
+}
+
+// Nächsten Stand für den Render-Pfad bauen. Die Notes selbst werden nicht
+// kopiert, nur ihre shared_ptr; Leser behalten den alten Stand, bis sie ihn
+// loslassen.
+void tpSignalKNotesManager::PublishNotes() {
+  if (!m_notesChanged) return;
+  m_notesChanged = false;
+
+  std::shared_ptr<tpNoteSnapshot> snapshot = std::make_shared<tpNoteSnapshot>();
+  snapshot->version = ++m_notesVersion;
+  snapshot->notes.reserve(m_notes.size());
+  for (const auto& kv : m_notes) {
+    tpNoteSnapshot::Note entry;
+    entry.note = kv.second.note;
+    entry.canvases = kv.second.canvases;
+    snapshot->notes.push_back(entry);
+  }
+  // m_notes ist nach wxString sortiert, gesucht wird nach UTF-8; bei den
+  // üblichen ASCII-ids ist das dieselbe Reihenfolge
+  auto byId = [](const tpNoteSnapshot::Note& a, const tpNoteSnapshot::Note& b) {
+    return a.note->GetIdUtf8() < b.note->GetIdUtf8();
+  };
+  if (!std::is_sorted(snapshot->notes.begin(), snapshot->notes.end(), byId))
+    std::sort(snapshot->notes.begin(), snapshot->notes.end(), byId);
+
+  std::set<const tpNoteBatch*> batches;
+  for (const auto& pair : m_parent->m_canvasStates) {
+    std::vector<const SignalKNote*>& window = snapshot->windows[pair.first];
+    for (const auto& viewKv : pair.second.resourceSets) {
+      const signalk_notes_opencpn_pi::CanvasState::ResourceSetView& view =
+          viewKv.second;
+      if (!view.notes) continue;
+      if (batches.insert(view.notes.get()).second)
+        snapshot->batches.push_back(view.notes);
+      window.insert(window.end(), view.window.begin(), view.window.end());
+    }
+  }
+
+  std::atomic_store(&m_noteSnapshot,
+                    std::shared_ptr<const tpNoteSnapshot>(snapshot));
+  SKN_LOG(m_parent, "Notes snapshot %lu: %d notes, %d resourcesets",
+          snapshot->version, (int)snapshot->notes.size(),
+          (int)snapshot->batches.size());
+}
+
+void tpSignalKNotesManager::StartStream() {
+  if (m_stream || m_serverHost.IsEmpty()) return;
+
+  // Sockets aus Hintergrund-Threads brauchen die Initialisierung im
+  // Haupt-Thread
+  wxSocketBase::Initialize();
+
+  std::vector<wxString> resourceSets;
+  for (const auto& rsKv : m_parent->m_resourceSetConfigs) {
+    if (rsKv.second.enabled) resourceSets.push_back(rsKv.first);
+  }
+
+  m_stream = new tpSignalKStream(this, m_serverHost, m_serverPort, m_authToken,
+                                 resourceSets);
+  if (m_stream->Create() != wxTHREAD_NO_ERROR ||
+      m_stream->Run() != wxTHREAD_NO_ERROR) {
+    SKN_LOG(m_parent, "Failed to start stream thread");
+    delete m_stream;
+    m_stream = nullptr;
+  }
+}
+
+void tpSignalKNotesManager::StopStream() {
+  if (!m_stream) return;
+
+  m_stream->RequestStop();
+  m_stream->Wait();
+  delete m_stream;
+  m_stream = nullptr;
+  m_streamConnected = false;
+
+  wxMutexLocker lock(m_streamMutex);
+  m_streamDeltas.clear();
+  m_pendingStreamState = -1;
+  m_streamReconnected = false;
+}
 
-    state.lastRSFetchTime = now;
+void tpSignalKNotesManager::PublishStreamDeltas(
+    std::vector<tpStreamDelta>& deltas) {
+  {
+    wxMutexLocker lock(m_streamMutex);
+    for (auto& delta : deltas) m_streamDeltas.push_back(delta);
   }
+  m_uiNotifier.CallAfter([this]() { ApplyPendingStreamUpdates(); });
+}
 
-  if (ok == 0) return;
+void tpSignalKNotesManager::PublishStreamState(bool connected) {
+  {
+    wxMutexLocker lock(m_streamMutex);
+    m_pendingStreamState = connected ? 1 : 0;
+    if (connected) m_streamReconnected = true;
+  }
+  m_uiNotifier.CallAfter([this]() { ApplyPendingStreamUpdates(); });
+}
 
-  wxMutexLocker lock(state.notesMutex);  // ← jetzt kein Deadlock mehr
+void tpSignalKNotesManager::ApplyPendingStreamUpdates() {
+  std::vector<tpStreamDelta> deltas;
+  int streamState;
+  bool reconnected;
+  {
+    wxMutexLocker lock(m_streamMutex);
+    deltas.swap(m_streamDeltas);
+    streamState = m_pendingStreamState;
+    reconnected = m_streamReconnected;
+    m_pendingStreamState = -1;
+    m_streamReconnected = false;
+  }
+
+  if (streamState != -1) m_streamConnected = (streamState == 1);
+
+  bool refresh = false;
+
+  // Während der Stream weg war, können Änderungen verloren gegangen sein:
+  // alle Canvas einmal neu abfragen (bedingt, meist 304)
+  if (reconnected) {
+    for (auto& pair : m_parent->m_canvasStates) {
+      pair.second.lastFetchTime = 0;
+      pair.second.rsFetchTimes.clear();
+    }
+    auto cacheIt = m_tileCaches.find(0);
+    if (cacheIt != m_tileCaches.end()) cacheIt->second->Expire();
+    refresh = true;
+  }
 
+  std::set<wxString> changedResourceSets;
   bool newMappingsFound = false;
 
-  for (auto& pair : state.notes) {
-    SignalKNote& note = pair.second;
+  for (const auto& delta : deltas) {
+    if (delta.resourceType != "notes") {
+      auto cfgIt = m_parent->m_resourceSetConfigs.find(delta.resourceType);
+      if (cfgIt != m_parent->m_resourceSetConfigs.end() &&
+          cfgIt->second.enabled)
+        changedResourceSets.insert(delta.resourceType);
+      continue;
+    }
 
-    if (!note.iconName.IsEmpty()) {
-      if (m_iconMappings.find(note.iconName) == m_iconMappings.end()) {
-        wxString iconPath = ResolveIconPath(note.iconName);
-        m_iconMappings[note.iconName] = iconPath;
-        newMappingsFound = true;
+    if (!delta.deleted) {
+      const wxString& source = delta.note.GetSource();
+      if (!source.IsEmpty()) {
+        m_discoveredProviders.insert(source);
+        if (m_providerSettings.find(source) == m_providerSettings.end()) {
+          m_providerSettings[source] = true;
+        }
       }
+      if (!delta.note.GetIconName().IsEmpty())
+        m_discoveredIcons.insert(delta.note.GetIconName());
     }
 
-    bool providerEnabled = true;
-    if (!note.source.IsEmpty()) {
-      auto it = m_providerSettings.find(note.source);
-      if (it != m_providerSettings.end()) {
-        providerEnabled = it->second;
+    // Auch zwischengespeicherte Kacheln des ersten Servers (nur er
+    // streamt), sonst kommt beim Zurückschwenken der alte Stand wieder
+    auto cacheIt = m_tileCaches.find(0);
+    if (cacheIt != m_tileCaches.end())
+      cacheIt->second->ApplyNoteDelta(delta.id,
+                                      delta.deleted ? nullptr : &delta.note);
+    m_detailsCache->Remove(delta.id);
+    m_detailsFailed.erase(delta.id);
+
+    uint32_t canvases = ApplyNoteDelta(delta);
+    if (canvases == 0) continue;
+    if (UpdateNoteDisplayFlags()) newMappingsFound = true;
+    MarkNotesDirty(canvases);
+    refresh = true;
+  }
+
+  if (!deltas.empty()) {
+    SKN_LOG(m_parent, "Stream: %d deltas applied, %d resourcesets changed",
+            (int)deltas.size(), (int)changedResourceSets.size());
+  }
+
+  // Resourcesets werden bei Änderungen gezielt neu geladen - nur das
+  // betroffene Set, ohne Notes-Liste, und nur einmal: die anderen Canvas
+  // übernehmen den Snapshot
+  if (!changedResourceSets.empty()) {
+    wxLongLong now = wxGetLocalTimeMillis();
+    for (auto& pair : m_parent->m_canvasStates) {
+      if (!pair.second.valid) continue;
+
+      tpFetchRequest request;
+      if (!InitFetchRequest(pair.first, request)) continue;
+      request.fetchNotesList = false;
+      request.fetchResourceSets = true;
+      for (const auto& rsName : changedResourceSets) {
+        request.resourceSets[rsName] = m_parent->m_resourceSetConfigs[rsName];
+        m_rsInFlight[rsName] = now;
       }
+      m_fetchWorker->Post(request);
+      break;
     }
+  }
 
-    note.isDisplayed = providerEnabled;
+  PublishNotes();
+  if (newMappingsFound) m_parent->SaveConfig();
+  if (refresh) RequestRefresh(m_parent->m_parent_window);
+}
+
+uint32_t tpSignalKNotesManager::ApplyNoteDelta(const tpStreamDelta& delta) {
+  auto it = m_notes.find(delta.id);
+  if (delta.deleted) {
+    if (it == m_notes.end()) return 0;
+    uint32_t canvases = it->second.canvases;
+    m_notes.erase(it);
+    m_notesChanged = true;
+    return canvases;
   }
 
-  if (newMappingsFound && m_parent) {
-    m_parent->SaveConfig();
+  if (it != m_notes.end()) {
+    // Erneut gemeldet, aber unverändert
+    if (it->second.note->GetContentHash() == delta.note.GetContentHash())
+      return 0;
+    std::shared_ptr<SignalKNote> note =
+        std::make_shared<SignalKNote>(delta.note);
+    note->isDisplayed = it->second.note->isDisplayed;
+    it->second.note = note;
+    m_notesChanged = true;
+    return it->second.canvases;
+  }
+
+  // Neue Note nur bei den Canvas, in deren zuletzt abgefragtem Umkreis sie
+  // liegt - sonst sammelten sie Notes außerhalb ihrer Abfrage
+  uint32_t canvases = 0;
+  for (const auto& pair : m_parent->m_canvasStates) {
+    const signalk_notes_opencpn_pi::CanvasState& state = pair.second;
+    if (state.lastFetchDistance <= 0) continue;
+
+    double brg = 0.0, distNM = 0.0;
+    DistanceBearingMercator_Plugin(delta.note.latitude, delta.note.longitude,
+                                   state.lastFetchCenterLat,
+                                   state.lastFetchCenterLon, &brg, &distNM);
+    if (distNM * 1852.0 <= state.lastFetchDistance)
+      canvases |= CanvasBit(pair.first);
+  }
+  if (canvases == 0) return 0;
+
+  std::shared_ptr<SignalKNote> note = std::make_shared<SignalKNote>(delta.note);
+  note->isDisplayed = IsProviderEnabled(*note);
+  SharedNote& shared = m_notes[delta.id];
+  shared.note = note;
+  shared.canvases = canvases;
+  m_notesChanged = true;
+  return canvases;
+}
+
+void tpSignalKNotesManager::MarkNotesDirty(uint32_t canvases) {
+  for (auto& pair : m_parent->m_canvasStates) {
+    if (canvases & CanvasBit(pair.first)) pair.second.notesDirty = true;
   }
 }
 
-SignalKNote* tpSignalKNotesManager::GetNoteByGUID(
-    signalk_notes_opencpn_pi::CanvasState& state, const wxString& guid) {
-  // Normale Notes
-  auto it = state.notes.find(guid);
-  if (it != state.notes.end()) return &it->second;
+void tpSignalKNotesManager::ReleaseCanvas(int canvasIndex) {
+  for (auto& cacheKv : m_tileCaches) cacheKv.second->RemoveCanvas(canvasIndex);
 
-  // Resourceset-Notes
-  auto rsIt = state.resourceSetNotes.find(guid);
-  if (rsIt != state.resourceSetNotes.end()) return &rsIt->second;
+  uint32_t bit = CanvasBit(canvasIndex);
+  int dropped = 0;
+  for (auto it = m_notes.begin(); it != m_notes.end();) {
+    it->second.canvases &= ~bit;
+    if (it->second.canvases == 0) {
+      it = m_notes.erase(it);
+      dropped++;
+    } else {
+      ++it;
+    }
+  }
+  SKN_LOG(m_parent, "Canvas %d closed, %d notes no longer shown", canvasIndex,
+          dropped);
+  m_notesChanged = true;
+  PublishNotes();
+}
 
-  return nullptr;
+std::shared_ptr<const SignalKNote> tpSignalKNotesManager::GetNoteByGUID(
+    const wxString& guid) const {
+  std::shared_ptr<const tpNoteSnapshot> snapshot = GetNoteSnapshot();
+  const SignalKNote* note = snapshot->Find(guid);
+  if (!note) return nullptr;
+  // Teilt den Besitz am ganzen Snapshot, also auch an den Resourcesets
+  return std::shared_ptr<const SignalKNote>(snapshot, note);
 }
 
-void tpSignalKNotesManager::OnIconClick(
-    const wxString& guid, signalk_notes_opencpn_pi::CanvasState& state,
-    int canvasIndex) {
+void tpSignalKNotesManager::OnIconClick(const wxString& guid,
+                                        int canvasIndex) {
   SKN_LOG(m_parent, "OnIconClick called with guid='%s'", guid);
   m_parent->m_dialogOpen = true;
 
@@ -466,96 +1728,108 @@ void tpSignalKNotesManager::OnIconClick(
   auto FinishAndReleaseMouse = [&]() -> void {
     wxWindow* canvas = GetCanvasByIndex(canvasIndex);
     if (canvas) {
-      wxMouseEvent upEvent(wxEVT_LEFT_UP);
-      upEvent.SetPosition(wxGetMousePosition());
-      canvas->GetEventHandler()->ProcessEvent(upEvent);
-    }
-    m_parent->m_dialogOpen = false;
-  };
-
-  // ============================================================
-  // 1. ResourceSet-Notes
-  // ============================================================
-  {
-    wxMutexLocker lock(state.notesMutex);
-    auto rsIt = state.resourceSetNotes.find(guid);
-    if (rsIt != state.resourceSetNotes.end()) {
-      const SignalKNote& note = rsIt->second;
-
-      wxDialog* dlg = new wxDialog(
-          m_parent->GetParentWindow(), wxID_ANY, note.name, wxDefaultPosition,
-          wxSize(500, 400), wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER);
-
-      wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
-
-      // Beschreibung
-      wxTextCtrl* textCtrl = new wxTextCtrl(
-          dlg, wxID_ANY, note.description, wxDefaultPosition, wxDefaultSize,
-          wxTE_MULTILINE | wxTE_READONLY | wxTE_RICH2);
-      sizer->Add(textCtrl, 1, wxALL | wxEXPAND, 10);
+      wxMouseEvent upEvent(wxEVT_LEFT_UP);
+      upEvent.SetPosition(wxGetMousePosition());
+      canvas->GetEventHandler()->ProcessEvent(upEvent);
+    }
+    m_parent->m_dialogOpen = false;
+  };
 
-      // Buttons
-      wxBoxSizer* btnSizer = new wxBoxSizer(wxHORIZONTAL);
+  // Hält die Note, solange die Dialoge offen sind, auch wenn inzwischen
+  // ein neuer Stand veröffentlicht wird
+  std::shared_ptr<const tpNoteSnapshot> snapshot = GetNoteSnapshot();
+  const tpNoteBatch* batch = nullptr;
+  const SignalKNote* found = snapshot->Find(guid, &batch);
 
-      wxButton* centerBtn = new wxButton(dlg, wxID_ANY, _("Center on map"));
-      centerBtn->Bind(wxEVT_BUTTON, [this, &note, canvasIndex,
-                                     dlg](wxCommandEvent&) {
-        wxWindow* canvas = GetCanvasByIndex(canvasIndex);
-        double scale = 0.0;
-        if (canvas) {
-          scale = m_parent->m_canvasStates[canvasIndex].viewPort.view_scale_ppm;
-        }
-        dlg->EndModal(wxID_OK);
-        if (canvas) {
-          CanvasJumpToPosition(canvas, note.latitude, note.longitude, scale);
-        }
-      });
-      btnSizer->Add(centerBtn, 0, wxALL, 5);
+  // ============================================================
+  // 1. ResourceSet-Notes
+  // ============================================================
+  if (found && batch) {
+    // Note und Beschreibung kopieren und den Snapshot vor ShowModal()
+    // freigeben; der Dialog verweist auf nichts mehr, was ersetzt werden kann
+    const SignalKNote note = *found;
+    const wxString description = batch->GetDescription(note);
+    found = nullptr;
+    batch = nullptr;
+    snapshot.reset();
+
+    wxDialog* dlg = new wxDialog(
+        m_parent->GetParentWindow(), wxID_ANY, note.GetName(),
+        wxDefaultPosition, wxSize(500, 400),
+        wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER);
+
+    wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
+
+    // Beschreibung, erst jetzt entpackt
+    wxTextCtrl* textCtrl = new wxTextCtrl(
+        dlg, wxID_ANY, description, wxDefaultPosition, wxDefaultSize,
+        wxTE_MULTILINE | wxTE_READONLY | wxTE_RICH2);
+    sizer->Add(textCtrl, 1, wxALL | wxEXPAND, 10);
+
+    // Buttons
+    wxBoxSizer* btnSizer = new wxBoxSizer(wxHORIZONTAL);
+
+    wxButton* centerBtn = new wxButton(dlg, wxID_ANY, _("Center on map"));
+    centerBtn->Bind(wxEVT_BUTTON, [this, note, canvasIndex,
+                                   dlg](wxCommandEvent&) {
+      wxWindow* canvas = GetCanvasByIndex(canvasIndex);
+      double scale = 0.0;
+      if (canvas) {
+        scale = m_parent->m_canvasStates[canvasIndex].viewPort.view_scale_ppm;
+      }
+      dlg->EndModal(wxID_OK);
+      if (canvas) {
+        CanvasJumpToPosition(canvas, note.latitude, note.longitude, scale);
+      }
+    });
+    btnSizer->Add(centerBtn, 0, wxALL, 5);
 
-      btnSizer->AddStretchSpacer();
+    btnSizer->AddStretchSpacer();
 
-      wxButton* okBtn = new wxButton(dlg, wxID_OK, _("OK"));
-      btnSizer->Add(okBtn, 0, wxALL, 5);
+    wxButton* okBtn = new wxButton(dlg, wxID_OK, _("OK"));
+    btnSizer->Add(okBtn, 0, wxALL, 5);
 
-      sizer->Add(btnSizer, 0, wxALL | wxEXPAND, 5);
+    sizer->Add(btnSizer, 0, wxALL | wxEXPAND, 5);
 
-      dlg->SetSizer(sizer);
-      dlg->ShowModal();
-      dlg->Destroy();
+    dlg->SetSizer(sizer);
+    dlg->ShowModal();
+    dlg->Destroy();
 
-      FinishAndReleaseMouse();
-      return;
-    }
+    FinishAndReleaseMouse();
+    return;
   }
 
   // ============================================================
   // 2. Normale Notes
   // ============================================================
-  SignalKNote* note = GetNoteByGUID(state, guid);
-  if (!note) {
+  if (!found) {
     SKN_LOG(m_parent, "Note with guid='%s' not found!", guid);
     FinishAndReleaseMouse();
     return;
   }
+  // Details werden in eine Kopie geladen; der Snapshot bleibt unverändert
+  SignalKNote detailed = *found;
+  SignalKNote* note = &detailed;
 
   // Details ggf. nachladen
-  if (note->name.IsEmpty() || note->description.IsEmpty()) {
-    if (!FetchNoteDetails(note->id, *note)) {
-      SKN_LOG(m_parent, "Failed to fetch details for %s", note->id);
-      if (note->name.IsEmpty()) note->name = note->id;
-      if (note->description.IsEmpty())
-        note->description = _("Details could not be loaded.");
+  if (!note->HasName() || !note->HasDescription()) {
+    if (!LoadNoteDetails(*note)) {
+      SKN_LOG(m_parent, "Failed to fetch details for %s", note->GetId());
+      if (!note->HasName()) note->SetName(note->GetId());
+      if (!note->HasDescription())
+        note->SetDescription(_("Details could not be loaded."));
 
       // Fallback-Dialog
       wxDialog* dlg = new wxDialog(
-          m_parent->GetParentWindow(), wxID_ANY, note->name, wxDefaultPosition,
-          wxSize(500, 400), wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER);
+          m_parent->GetParentWindow(), wxID_ANY, note->GetName(),
+          wxDefaultPosition, wxSize(500, 400),
+          wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER);
 
       wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
 
       wxTextCtrl* textCtrl = new wxTextCtrl(
-          dlg, wxID_ANY, note->description, wxDefaultPosition, wxDefaultSize,
-          wxTE_MULTILINE | wxTE_READONLY | wxTE_RICH2);
+          dlg, wxID_ANY, note->GetDescription(), wxDefaultPosition,
+          wxDefaultSize, wxTE_MULTILINE | wxTE_READONLY | wxTE_RICH2);
       sizer->Add(textCtrl, 1, wxALL | wxEXPAND, 10);
 
       wxBoxSizer* btnSizer = new wxBoxSizer(wxHORIZONTAL);
@@ -589,12 +1863,23 @@ void tpSignalKNotesManager::OnIconClick(
       FinishAndReleaseMouse();
       return;
     }
+
+    // Nachgeladene Details in den nächsten Snapshot übernehmen
+    auto noteIt = m_notes.find(guid);
+    if (noteIt != m_notes.end()) {
+      std::shared_ptr<SignalKNote> updated =
+          std::make_shared<SignalKNote>(detailed);
+      updated->isDisplayed = noteIt->second.note->isDisplayed;
+      noteIt->second.note = updated;
+      m_notesChanged = true;
+      PublishNotes();
+    }
   }
 
   // ============================================================
   // 3. Vollständiger HTML-Dialog
   // ============================================================
-  SKN_LOG(m_parent, "Found note '%s'", note->name);
+  SKN_LOG(m_parent, "Found note '%s'", note->GetName());
 
   int totalWidth = 0, totalHeight = 0;
   for (const auto& pair : m_parent->m_canvasStates) {
@@ -615,14 +1900,15 @@ void tpSignalKNotesManager::OnIconClick(
 
   wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
 
-  wxStaticText* title = new wxStaticText(dlg, wxID_ANY, note->name);
+  wxStaticText* title = new wxStaticText(dlg, wxID_ANY, note->GetName());
   wxFont font = title->GetFont();
   font.SetPointSize(font.GetPointSize() + 2);
   font.SetWeight(wxFONTWEIGHT_BOLD);
   title->SetFont(font);
   sizer->Add(title, 0, wxALL | wxEXPAND, 10);
 
-  wxString htmlContent = PrepareHTMLContent(note->description, note->url);
+  wxString htmlContent =
+      PrepareHTMLContent(note->GetDescription(), note->GetUrl());
 
 #if defined(__WXMSW__) || defined(__WXMAC__)
   if (!RenderWithWebView(dlg, sizer, htmlContent))
@@ -830,61 +2116,81 @@ void tpSignalKNotesManager::RenderWithHtmlWindow(wxDialog* dlg,
   SKN_LOG(m_parent, "Using wxHtmlWindow for rendering");
 }
 
-int tpSignalKNotesManager::FetchNotesListForCanvas(
-    double centerLat, double centerLon, double maxDistance,
-    signalk_notes_opencpn_pi::CanvasState& state) {
-  if (m_serverHost.IsEmpty()) {
-    SKN_LOG(m_parent, _("Server host not configured"));
-    return -2;
+int tpSignalKNotesManager::ProcessNotesListResponse(
+    const tpFetchRequest& request, const tpHttpRequest& httpResponse,
+    tpNotesListParser& parser, tpTileResult& result) {
+  const wxString& path = httpResponse.url;
+  long status = httpResponse.status;
+  const wxString& err = httpResponse.error;
+
+  if (httpResponse.notModified) {
+    // Was der Parser eventuell schon gefüllt hat, wird nicht gebraucht.
+    // Ohne ETag/Last-Modified bekommt er den Body hier gar nicht erst.
+    result.notes.clear();
+    result.unchanged = true;
+    return 0;
   }
 
-  wxString path;
-  path.Printf(
-      "http://%s:%d/signalk/v2/api/resources/"
-      "notes?position=[%f,%f]&distance=%.0f",
-      m_serverHost.c_str(), m_serverPort, centerLon, centerLat, maxDistance);
-
-  long status = 0;
-  wxString err;
-
-  wxString response = HttpGet(path, "", &status, &err);
+  // Bei 2xx wurde der Body gestreamt, body enthält nur Fehlertexte
+  wxString response = httpResponse.GetBodyString();
 
-  if (response.IsEmpty() || status != 200) {
+  if (!parser.HasError() &&
+      (httpResponse.bodyBytes == 0 || status != 200 || !err.IsEmpty())) {
     wxString shortResp = response.Left(200);
     if (response.Length() > 200) shortResp += "...";
 
     SKN_LOG(m_parent,
             wxString::Format("FetchNotesList FAILED — status=%ld error=\"%s\" "
                              "url=%s host=%s port=%d response=\"%s\"",
-                             status, err, path, m_serverHost.c_str(),
-                             m_serverPort, shortResp));
+                             status, err, path, request.serverHost.c_str(),
+                             request.serverPort, shortResp));
 
     return -1;
   }
 
-  int ok = ParseNotesListJSON(response, state);
-
-  if (ok == -1) {
+  if (!parser.Finish()) {
     SKN_LOG(
         m_parent,
         wxString::Format(
             "FetchNotesList FAILED — JSON parse error url=%s host=%s port=%d",
-            path, m_serverHost.c_str(), m_serverPort));
+            path, request.serverHost.c_str(), request.serverPort));
+    return -1;
+  }
+
+  return (int)result.notes.size();
+}
+
+bool tpSignalKNotesManager::LoadNoteDetails(SignalKNote& note) {
+  SignalKNote details;
+  wxString noteId = note.GetId();
+  bool cached = m_detailsCache->Get(noteId, details);
+
+  SKN_LOG(m_parent, "Details cache %s for %s: %lu entries, hit ratio %.0f%%",
+          cached ? "hit" : "miss", noteId,
+          (unsigned long)m_detailsCache->GetSize(),
+          100.0 * m_detailsCache->GetHitRatio());
+
+  if (cached) {
+    if (details.HasName()) note.SetName(details.GetName());
+    if (details.HasDescription())
+      note.SetDescription(details.GetDescription());
+    return true;
   }
 
-  return ok;
+  if (!FetchNoteDetails(noteId, note)) return false;
+  m_detailsCache->Put(noteId, note);
+  return true;
 }
 
 bool tpSignalKNotesManager::FetchNoteDetails(const wxString& noteId,
                                              SignalKNote& note) {
-  wxString path;
-  path.Printf("http://%s:%d/signalk/v2/api/resources/notes/%s",
-              m_serverHost.c_str(), m_serverPort, noteId);
+  tpServerEndpoint server = GetServer(FindServer(note.GetServer()));
+  wxString path = NoteDetailsUrl(server.host, server.port, noteId);
 
   long status = 0;
   wxString err;
 
-  wxString response = HttpGet(path, "", &status, &err);
+  wxString response = m_http.Get(path, "", &status, &err);
 
   if (response.IsEmpty() || status != 200) {
     // Response kürzen, damit Logs nicht explodieren
@@ -894,7 +2200,7 @@ bool tpSignalKNotesManager::FetchNoteDetails(const wxString& noteId,
     SKN_LOG(m_parent, wxString::Format(
                           "FetchNoteDetails FAILED — status=%ld error=\"%s\" "
                           "url=%s host=%s port=%d response=\"%s\"",
-                          status, err, path, m_serverHost.c_str(), m_serverPort,
+                          status, err, path, server.host.c_str(), server.port,
                           shortResp));
 
     return false;
@@ -903,128 +2209,163 @@ bool tpSignalKNotesManager::FetchNoteDetails(const wxString& noteId,
   return ParseNoteDetailsJSON(response, note);
 }
 
-int tpSignalKNotesManager::ParseNotesListJSON(
-    const wxString& json, signalk_notes_opencpn_pi::CanvasState& state) {
-  wxJSONReader reader;
-  wxJSONValue root;
+// Länge mit hashen, damit ("ab", "c") und ("a", "bc") verschieden sind
+static uint64_t HashText(const std::string& text, uint64_t hash) {
+  uint64_t length = text.size();
+  hash = tpHashBytes(&length, sizeof(length), hash);
+  return tpHashBytes(text.data(), text.size(), hash);
+}
 
-  int errors = reader.Parse(json, &root);
-  if (errors > 0) {
-    SKN_LOG(m_parent, _("Failed to parse notes list JSON"));
-    return -1;
-  }
+void SignalKNote::UpdateContentHash(uint64_t extra) {
+  uint64_t hash = tpHashBytes(&latitude, sizeof(latitude));
+  hash = tpHashBytes(&longitude, sizeof(longitude), hash);
+  hash = HashText(m_name, hash);
+  hash = HashText(m_description, hash);
+  hash = HashText(m_url, hash);
+  // Handles statt Texte: sie bleiben gültig, solange das Plugin läuft, und
+  // der Hash wird nicht gespeichert
+  hash = tpHashBytes(&m_iconName, sizeof(m_iconName), hash);
+  hash = tpHashBytes(&m_source, sizeof(m_source), hash);
+  m_contentHash = tpHashBytes(&extra, sizeof(extra), hash);
+}
 
-  // Erstelle temporäre Map für neue Notes
-  std::map<wxString, SignalKNote> newNotes;
-  wxArrayString memberNames = root.GetMemberNames();
+// Kurze Texte liegen im std::string selbst (SSO), nur längere auf dem Heap
+static size_t HeapBytes(const std::string& text) {
+  static const size_t inlineCapacity = std::string().capacity();
+  return text.capacity() > inlineCapacity ? text.capacity() + 1 : 0;
+}
 
-  // Parse alle Notes aus JSON
-  for (size_t i = 0; i < memberNames.GetCount(); i++) {
-    wxString noteId = memberNames[i];
-    wxJSONValue noteData = root[noteId];
+size_t SignalKNote::GetMemoryUsage() const {
+  return sizeof(SignalKNote) + HeapBytes(m_id) + HeapBytes(m_name) +
+         HeapBytes(m_description) + HeapBytes(m_url);
+}
 
-    SignalKNote note;
-    note.id = noteId;
+size_t SignalKNote::GetAllocations() const {
+  return (HeapBytes(m_id) ? 1 : 0) + (HeapBytes(m_name) ? 1 : 0) +
+         (HeapBytes(m_description) ? 1 : 0) + (HeapBytes(m_url) ? 1 : 0);
+}
 
-    if (noteData.HasMember(wxT("name"))) {
-      note.name = noteData[wxT("name")].AsString();
-    }
+// Vergleichswert: id, name, description, iconName, url, source, GUID und
+// server als wxString je Note, GUID wie die id
+size_t SignalKNote::GetWideMemoryUsage() const {
+  size_t chars = 2 * (GetId().length() + 1) + GetName().length() + 1 +
+                 GetDescription().length() + 1 + GetUrl().length() + 1 +
+                 GetIconName().length() + 1 + GetSource().length() + 1 +
+                 GetServer().length() + 1;
+  return 8 * sizeof(wxString) + 2 * sizeof(double) + sizeof(bool) +
+         chars * sizeof(wxChar);
+}
 
-    if (noteData.HasMember(wxT("$source"))) {
-      note.source = noteData[wxT("$source")].AsString();
-      m_discoveredProviders.insert(note.source);
+void tpSignalKNotesManager::ParseNoteValue(const wxString& noteId,
+                                           wxJSONValue& noteData,
+                                           SignalKNote& note) {
+  note.SetId(noteId);
 
-      if (m_providerSettings.find(note.source) == m_providerSettings.end()) {
-        m_providerSettings[note.source] = true;
-      }
-    }
+  if (noteData.HasMember(wxT("name"))) {
+    note.SetName(noteData[wxT("name")].AsString());
+  }
 
-    if (noteData.HasMember(wxT("position"))) {
-      wxJSONValue pos = noteData[wxT("position")];
-      if (pos.HasMember(wxT("latitude"))) {
-        note.latitude = pos[wxT("latitude")].AsDouble();
-      }
-      if (pos.HasMember(wxT("longitude"))) {
-        note.longitude = pos[wxT("longitude")].AsDouble();
-      }
-    }
+  if (noteData.HasMember(wxT("$source"))) {
+    note.SetSource(noteData[wxT("$source")].AsString());
+  }
 
-    if (noteData.HasMember(wxT("url"))) {
-      note.url = noteData[wxT("url")].AsString();
+  if (noteData.HasMember(wxT("position"))) {
+    wxJSONValue pos = noteData[wxT("position")];
+    if (pos.HasMember(wxT("latitude"))) {
+      note.latitude = pos[wxT("latitude")].AsDouble();
     }
-
-    if (noteData.HasMember(wxT("properties"))) {
-      wxJSONValue props = noteData[wxT("properties")];
-      if (props.HasMember(wxT("skIcon"))) {
-        note.iconName = props[wxT("skIcon")].AsString();
-        m_discoveredIcons.insert(note.iconName);
-      }
+    if (pos.HasMember(wxT("longitude"))) {
+      note.longitude = pos[wxT("longitude")].AsDouble();
     }
+  }
 
-    newNotes[noteId] = note;
+  if (noteData.HasMember(wxT("url"))) {
+    note.SetUrl(noteData[wxT("url")].AsString());
   }
 
-  // Vergleiche und Update von state.notes
-  {
-    wxMutexLocker lock(state.notesMutex);
-
-    // Übernehme isDisplayed Status von bestehenden Notes
-    for (auto& newPair : newNotes) {
-      auto existingIt = state.notes.find(newPair.first);
-      if (existingIt != state.notes.end()) {
-        newPair.second.isDisplayed = existingIt->second.isDisplayed;
-        newPair.second.GUID = existingIt->second.GUID;
-      } else {
-        newPair.second.isDisplayed = false;
-      }
+  if (noteData.HasMember(wxT("properties"))) {
+    wxJSONValue props = noteData[wxT("properties")];
+    if (props.HasMember(wxT("skIcon"))) {
+      note.SetIconName(props[wxT("skIcon")].AsString());
     }
+  }
 
-    // Vergleiche: Haben sich die Notes wirklich geändert?
-    if (newNotes.size() != state.notes.size()) {
-      SKN_LOG(m_parent, "Notes changed: count %zu -> %zu", state.notes.size(),
-              newNotes.size());
-      state.notes = std::move(newNotes);
-      return 1;
-    }
+  note.UpdateContentHash();
+}
 
-    // Gleiche Anzahl - prüfe ob Inhalte identisch sind
-    bool hasChanges = false;
-    for (const auto& newPair : newNotes) {
-      const wxString& id = newPair.first;
-      const SignalKNote& newNote = newPair.second;
-
-      auto oldIt = state.notes.find(id);
-      if (oldIt == state.notes.end()) {
-        // Neue Note
-        hasChanges = true;
-        break;
+// Übernimmt die neue Liste des Canvas als Delta: nur hinzugekommene,
+// geänderte (anderer Inhalts-Hash) und weggefallene Notes werden angefasst.
+// Unveränderte bleiben samt isDisplayed und nachgeladenen Details stehen.
+// Eine Note, die auch ein anderer Canvas zeigt, wird nicht kopiert, sondern
+// nur dessen Bit gesetzt; ändert sie sich, baut auch er seine Cluster neu.
+int tpSignalKNotesManager::ApplyNotesList(
+    int canvasIndex, std::map<wxString, SignalKNote>& newNotes) {
+  uint32_t bit = CanvasBit(canvasIndex);
+  uint32_t dirty = 0;
+  std::vector<wxString> changedIds;
+  int added = 0, removed = 0;
+  auto oldIt = m_notes.begin();
+  auto newIt = newNotes.begin();
+  // Beide Maps sind nach id sortiert; m_notes enthält auch die Notes der
+  // anderen Canvas
+  while (oldIt != m_notes.end() || newIt != newNotes.end()) {
+    if (newIt == newNotes.end() ||
+        (oldIt != m_notes.end() && oldIt->first < newIt->first)) {
+      SharedNote& shared = oldIt->second;
+      if (shared.canvases & bit) {
+        shared.canvases &= ~bit;
+        removed++;
       }
-
-      const SignalKNote& oldNote = oldIt->second;
-
-      // Feldweiser Vergleich (außer isDisplayed und GUID)
-      if (newNote.name != oldNote.name ||
-          newNote.description != oldNote.description ||
-          newNote.latitude != oldNote.latitude ||
-          newNote.longitude != oldNote.longitude ||
-          newNote.iconName != oldNote.iconName || newNote.url != oldNote.url ||
-          newNote.source != oldNote.source) {
-        hasChanges = true;
-        break;
+      if (shared.canvases == 0)
+        oldIt = m_notes.erase(oldIt);
+      else
+        ++oldIt;
+    } else if (oldIt == m_notes.end() || newIt->first < oldIt->first) {
+      newIt->second.isDisplayed = IsProviderEnabled(newIt->second);
+      SharedNote shared;
+      shared.note = std::make_shared<SignalKNote>(std::move(newIt->second));
+      shared.canvases = bit;
+      m_notes.insert(oldIt, std::make_pair(newIt->first, std::move(shared)));
+      added++;
+      ++newIt;
+    } else {
+      SharedNote& shared = oldIt->second;
+      if ((shared.canvases & bit) == 0) {
+        shared.canvases |= bit;
+        added++;
+      }
+      // Veröffentlichte Snapshots halten die alte Note, daher neu anlegen
+      if (shared.note->GetContentHash() != newIt->second.GetContentHash()) {
+        newIt->second.isDisplayed = shared.note->isDisplayed;
+        shared.note = std::make_shared<SignalKNote>(std::move(newIt->second));
+        changedIds.push_back(oldIt->first);
+        dirty |= shared.canvases;
       }
+      ++oldIt;
+      ++newIt;
     }
+  }
 
-    if (hasChanges) {
-      SKN_LOG(m_parent, "Notes changed: content modified");
-      state.notes = std::move(newNotes);
-      return 1;
-    } else {
-      SKN_LOG(m_parent, "Notes unchanged - keeping existing data");
-      // Keine Änderungen - behalte state.notes wie es ist
-      return 0;
-    }
-  }  // Mutex wird hier automatisch freigegeben
-  return 0;
+  // Details geänderter Notes sind veraltet. Weggefallene liegen meist nur
+  // außerhalb des Bereichs - ihre Details bleiben im Cache.
+  for (const auto& id : changedIds) {
+    m_detailsCache->Remove(id);
+    m_detailsFailed.erase(id);
+  }
+
+  int changes = added + (int)changedIds.size() + removed;
+  if (changes == 0) {
+    SKN_LOG(m_parent, "Notes unchanged - keeping existing data");
+    return 0;
+  }
+  SKN_LOG(m_parent,
+          "Notes delta: canvas %d, %d added, %d changed, %d removed, %d "
+          "notes held for all canvases",
+          canvasIndex, added, (int)changedIds.size(), removed,
+          (int)m_notes.size());
+  m_notesChanged = true;
+  MarkNotesDirty(dirty | bit);
+  return changes;
 }
 
 bool tpSignalKNotesManager::ParseNoteDetailsJSON(const wxString& json,
@@ -1039,11 +2380,11 @@ bool tpSignalKNotesManager::ParseNoteDetailsJSON(const wxString& json,
   }
 
   if (root.HasMember(wxT("name"))) {
-    note.name = root[wxT("name")].AsString();
+    note.SetName(root[wxT("name")].AsString());
   }
 
   if (root.HasMember(wxT("description"))) {
-    note.description = root[wxT("description")].AsString();
+    note.SetDescription(root[wxT("description")].AsString());
   }
 
   if (root.HasMember(wxT("position"))) {
@@ -1059,7 +2400,7 @@ bool tpSignalKNotesManager::ParseNoteDetailsJSON(const wxString& json,
   if (root.HasMember(wxT("properties"))) {
     wxJSONValue props = root[wxT("properties")];
     if (props.HasMember(wxT("skIcon"))) {
-      note.iconName = props[wxT("skIcon")].AsString();
+      note.SetIconName(props[wxT("skIcon")].AsString());
     }
   }
 
@@ -1101,7 +2442,7 @@ bool tpSignalKNotesManager::DownloadIcon(const wxString& iconName,
 }
 
 bool tpSignalKNotesManager::CreateNoteIcon(SignalKNote& note) {
-  wxString iconName = note.iconName;
+  wxString iconName = note.GetIconName();
   if (iconName.IsEmpty()) {
     iconName = wxT("fallback");
   }
@@ -1119,35 +2460,44 @@ bool tpSignalKNotesManager::DeleteNoteIcon(const wxString& guid) {
   auto it = m_notes.find(guid);
   if (it == m_notes.end()) return false;
 
-  it->second.isDisplayed = false;
+  std::shared_ptr<SignalKNote> note =
+      std::make_shared<SignalKNote>(*it->second.note);
+  note->isDisplayed = false;
+  it->second.note = note;
+  m_notesChanged = true;
+  PublishNotes();
   return true;
 }
 
 void tpSignalKNotesManager::GetVisibleNotes(
-    signalk_notes_opencpn_pi::CanvasState& state,
-    std::vector<const SignalKNote*>& outNotes) {
-  wxMutexLocker lock(state.notesMutex);
-
-  // Normale Notes (bereits per isDisplayed gefiltert)
-  for (auto& kv : state.notes) {
-    if (kv.second.isDisplayed) outNotes.push_back(&kv.second);
-  }
-
-  // Resourceset-Notes: Viewport-Check über lat/lon Grenzen
-  if (!state.valid) return;
-  const PlugIn_ViewPort& vp = state.viewPort;
-  for (auto& kv : state.resourceSetNotes) {
-    const SignalKNote& note = kv.second;
-    if (note.latitude >= vp.lat_min && note.latitude <= vp.lat_max &&
-        note.longitude >= vp.lon_min && note.longitude <= vp.lon_max) {
-      outNotes.push_back(&note);
+    const tpNoteSnapshot& snapshot, int canvasIndex,
+    std::vector<const SignalKNote*>& outNotes) const {
+  // Normale Notes dieses Canvas (bereits per isDisplayed gefiltert)
+  uint32_t bit = CanvasBit(canvasIndex);
+  for (const auto& entry : snapshot.notes) {
+    if ((entry.canvases & bit) && entry.note->isDisplayed)
+      outNotes.push_back(entry.note.get());
+  }
+
+  // Resourceset-Notes: nur das Fenster um den Viewport ist geladen, davon
+  // Viewport-Check über lat/lon Grenzen
+  auto stateIt = m_parent->m_canvasStates.find(canvasIndex);
+  if (stateIt == m_parent->m_canvasStates.end() || !stateIt->second.valid)
+    return;
+  auto windowIt = snapshot.windows.find(canvasIndex);
+  if (windowIt == snapshot.windows.end()) return;
+  const PlugIn_ViewPort& vp = stateIt->second.viewPort;
+  for (const SignalKNote* note : windowIt->second) {
+    if (note->latitude >= vp.lat_min && note->latitude <= vp.lat_max &&
+        note->longitude >= vp.lon_min && note->longitude <= vp.lon_max) {
+      outNotes.push_back(note);
     }
   }
 }
 
 bool tpSignalKNotesManager::GetIconBitmapForNote(const SignalKNote& note,
                                                  wxBitmap& bmp, bool forGL) {
-  wxString skIcon = note.iconName;
+  const wxString& skIcon = note.GetIconName();
 
   // 0. Cache-Check im PLUGIN
   if (m_parent->GetCachedIconBitmap(skIcon, bmp, forGL)) {
@@ -1261,40 +2611,25 @@ bool tpSignalKNotesManager::RequestAuthorization() {
       "}",
       m_parent->m_clientUUID);
 
-  wxHTTP http;
-  http.SetTimeout(10);
-  if (!http.Connect(m_serverHost, m_serverPort)) {
-    SKN_LOG(m_parent,
-            wxString::Format("SignalK Notes Auth: Connection failed "
-                             "(RequestAuthorization) — host=%s port=%d",
-                             m_serverHost, m_serverPort));
-    return false;
-  }
-
-  wxMemoryBuffer postData;
+  tpHttpRequest post(
+      wxString::Format("http://%s:%d%s", m_serverHost, m_serverPort, path));
   wxCharBuffer utf8 = body.ToUTF8();
-  postData.AppendData(utf8.data(), utf8.length());
-
-  http.SetPostBuffer("application/json", postData);
+  post.postBody.assign(utf8.data(), utf8.length());
+  post.contentType = "application/json";
 
-  wxInputStream* in = http.GetInputStream(path);
+  m_http.Perform(post);
 
-  if (!in || !in->IsOk()) {
-    SKN_LOG(m_parent, "SignalK Notes Auth: POST request failed (no response)");
-    delete in;
+  if (post.status <= 0) {
+    SKN_LOG(m_parent,
+            wxString::Format("SignalK Notes Auth: POST request failed "
+                             "(RequestAuthorization) — host=%s port=%d "
+                             "error=\"%s\"",
+                             m_serverHost, m_serverPort, post.error));
     return false;
   }
 
-  // Chunk-weises Lesen bis wirklich nichts mehr kommt
-  wxString response;
-  char buf[4096];
-  while (true) {
-    in->Read(buf, sizeof(buf));
-    size_t read = in->LastRead();
-    if (read == 0) break;
-    response += wxString::FromUTF8(buf, read);
-  }
-  delete in;
+  // Der Server antwortet mit 202 Accepted, daher nicht auf 200 prüfen
+  wxString response = post.GetBodyString();
 
   wxJSONReader reader;
   wxJSONValue root;
@@ -1324,7 +2659,7 @@ bool tpSignalKNotesManager::CheckAuthorizationStatus() {
   wxString url;
   url.Printf("http://%s:%d%s", m_serverHost, m_serverPort, m_authRequestHref);
 
-  wxString response = HttpGet(url);
+  wxString response = m_http.Get(url);
 
   if (response.IsEmpty()) {
     SKN_LOG(m_parent, "CheckAuthorizationStatus - empty response");
@@ -1386,7 +2721,7 @@ bool tpSignalKNotesManager::ValidateToken() {
   wxString url =
       wxString::Format("http://%s:%d/plugins/", m_serverHost, m_serverPort);
 
-  wxString response = HttpGet(url, "Authorization: Bearer " + m_authToken);
+  wxString response = m_http.Get(url, BearerHeader(m_authToken));
 
   if (response.IsEmpty()) {
     SKN_LOG(m_parent,
@@ -1415,22 +2750,22 @@ bool tpSignalKNotesManager::ValidateToken() {
   return true;
 }
 
-static wxString HttpGetAuth(const wxString& url, const wxString& token) {
-  return HttpGet(url, "Authorization: Bearer " + token);
-}
-
 bool tpSignalKNotesManager::FetchInstalledPlugins(
     std::map<wxString, bool>& plugins) {
   wxString url;
   url.Printf("http://%s:%d/plugins/", m_serverHost, m_serverPort);
 
-  wxString response = HttpGetAuth(url, m_authToken);
+  wxString response = m_http.Get(url, BearerHeader(m_authToken));
 
   if (response.IsEmpty()) {
     SKN_LOG(m_parent, "Failed to fetch installed plugins");
     return false;
   }
+  return ParseInstalledPlugins(response, plugins);
+}
 
+bool tpSignalKNotesManager::ParseInstalledPlugins(
+    const wxString& response, std::map<wxString, bool>& plugins) {
   wxJSONReader reader;
   wxJSONValue root;
 
@@ -1482,7 +2817,11 @@ void tpSignalKNotesManager::CleanupDisabledProviders() {
     SKN_LOG(m_parent, "Cannot cleanup providers - plugin fetch failed");
     return;
   }
+  RemoveDisabledProviders(installedPlugins);
+}
 
+void tpSignalKNotesManager::RemoveDisabledProviders(
+    const std::map<wxString, bool>& installedPlugins) {
   std::vector<wxString> providersToRemove;
 
   for (const auto& providerPair : m_providerSettings) {
@@ -1597,29 +2936,23 @@ bool tpSignalKNotesManager::FetchAvailableResourceSets(
     std::set<wxString>& outResourceSets) {
   outResourceSets.clear();
 
-  wxHTTP http;
-  http.SetHeader("Content-type", "application/json");
-  http.SetTimeout(10);
-
-  if (!http.Connect(m_serverHost, m_serverPort)) {
+  wxString url = wxString::Format("http://%s:%d/signalk/v2/api/resources",
+                                  m_serverHost, m_serverPort);
+  long status = 0;
+  wxString err;
+  wxString json = m_http.Get(url, "", &status, &err);
+  if (json.IsEmpty()) {
     SKN_LOG(m_parent,
-            "FetchAvailableResourceSets: Verbindung fehlgeschlagen zu %s:%d",
-            m_serverHost, m_serverPort);
-    return false;
-  }
-
-  wxString path = "/signalk/v2/api/resources";
-  wxInputStream* stream = http.GetInputStream(path);
-  if (!stream || http.GetError() != wxPROTO_NOERR) {
-    wxDELETE(stream);
+            "FetchAvailableResourceSets: Abruf fehlgeschlagen von %s:%d "
+            "(status=%ld %s)",
+            m_serverHost, m_serverPort, status, err);
     return false;
   }
+  return ParseResourceSetList(json, outResourceSets);
+}
 
-  wxStringOutputStream out;
-  stream->Read(out);
-  wxDELETE(stream);
-
-  wxString json = out.GetString();
+bool tpSignalKNotesManager::ParseResourceSetList(
+    const wxString& json, std::set<wxString>& outResourceSets) const {
   wxJSONReader reader;
   wxJSONValue root;
   if (reader.Parse(json, &root) != 0) return false;
@@ -1636,370 +2969,381 @@ bool tpSignalKNotesManager::FetchAvailableResourceSets(
   return !outResourceSets.empty();
 }
 
-bool tpSignalKNotesManager::IsValidResourceSet(wxJSONValue rsJson) {
-  if (!rsJson.HasMember("type")) return false;
-  if (rsJson["type"].AsString() != "ResourceSet") return false;
-  if (!rsJson.HasMember("values")) return false;
-  if (!rsJson["values"].HasMember("features")) return false;
-  if (!rsJson["values"]["features"].IsArray()) return false;
-
-  wxJSONValue features = rsJson["values"]["features"];
-  for (int i = 0; i < features.Size(); i++) {
-    wxJSONValue f = features[i];
-    if (!f.HasMember("geometry")) continue;
-    if (!f["geometry"].HasMember("type")) continue;
-    if (f["geometry"]["type"].AsString() != "Point") continue;
-    if (!f["geometry"].HasMember("coordinates")) continue;
-    if (!f["geometry"]["coordinates"].IsArray()) continue;
-    if (f["geometry"]["coordinates"].Size() < 2) continue;
-    if (!f.HasMember("properties")) continue;
-    if (!f["properties"].HasMember("name")) continue;
-    return true;
-  }
-  return false;
-}
-
-int tpSignalKNotesManager::ParseResourceSetJSON(
-    const wxString& json, const wxString& resourceSetName,
+bool tpSignalKNotesManager::ApplyResourceSetResult(
     signalk_notes_opencpn_pi::CanvasState& state,
+    const wxString& resourceSetName, const tpResourceSetSnapshot& snapshot,
     const std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
-        configuredSubs,
-    std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
-        outDiscoveredSubs) {
-  wxJSONReader reader;
-  wxJSONValue root;
-  if (reader.Parse(json, &root) != 0) {
-    SKN_LOG(m_parent, "ParseResourceSetJSON: JSON-Fehler für %s",
+        configuredSubs) {
+  const tpResourceSetResult& rsResult = snapshot.result;
+  // Ob Daten geladen wurden, entscheidet das ganze Resourceset. Auf die
+  // Fenster zugeschnitten darf es auch leer sein.
+  bool loaded = rsResult.notes &&
+                (rsResult.notes->GetCount() > 0 || !snapshot.kept.empty());
+
+  // Ohne Daten hat der Abruf wahrscheinlich gefehlt → alten Stand behalten,
+  // außer alle Unter-RS wurden bewusst deaktiviert
+  if (!loaded && (rsResult.flat || !configuredSubs.empty())) {
+    SKN_LOG(m_parent, "ApplyResourceSetResult: %s → no notes, kept",
             resourceSetName);
-    return 0;
+    return false;
   }
 
-  // Neue Notes aus diesem Abruf sammeln
-  std::map<wxString, SignalKNote> newNotes;
+  // Nur der Ausschnitt um den Viewport, als Zeiger in den geteilten Stand
+  std::vector<const SignalKNote*> window;
+  if (loaded) CollectResourceSetWindow(state, *rsResult.notes, window);
 
-  wxArrayString uuids = root.GetMemberNames();
-  for (size_t i = 0; i < uuids.GetCount(); i++) {
-    wxString uuid = uuids[i];
-    wxJSONValue rsEntry = root[uuid];
-
-    if (!IsValidResourceSet(rsEntry)) {
-      SKN_LOG(m_parent,
-              "ParseResourceSetJSON: Überspringe ungültiges Unter-RS %s", uuid);
-      continue;
-    }
+  if (!loaded) {
+    if (state.resourceSets.erase(resourceSetName) == 0) return false;
+    m_notesChanged = true;
+    return true;
+  }
 
-    wxString subName = rsEntry["name"].AsString();
-
-    // Unter-Resourceset als entdeckt markieren (für Config-Dialog)
-    if (outDiscoveredSubs.find(subName) == outDiscoveredSubs.end()) {
-      signalk_notes_opencpn_pi::SubResourceSetConfig cfg;
-      cfg.name = subName;
-      cfg.enabled = false;
-      // Übernehme ggf. vorhandene Konfiguration
-      auto it = configuredSubs.find(subName);
-      if (it != configuredSubs.end()) {
-        cfg.enabled = it->second.enabled;
-        cfg.iconName = it->second.iconName;
-      }
-      outDiscoveredSubs[subName] = cfg;
-    }
+  signalk_notes_opencpn_pi::CanvasState::ResourceSetView& view =
+      state.resourceSets[resourceSetName];
+  bool changed =
+      view.notes != rsResult.notes || view.window.size() != window.size();
+  view.notes = rsResult.notes;
+  view.window.swap(window);
+  m_notesChanged = true;
 
-    // Prüfe ob dieses Unter-Resourceset aktiviert ist
-    auto cfgIt = configuredSubs.find(subName);
-    bool subEnabled = (cfgIt != configuredSubs.end() && cfgIt->second.enabled);
-    wxString iconName =
-        (cfgIt != configuredSubs.end()) ? cfgIt->second.iconName : wxString("");
+  SKN_LOG(m_parent,
+          "ApplyResourceSetResult: %s → %d of %d Notes in window (changed=%d)",
+          resourceSetName, (int)view.window.size(),
+          (int)rsResult.notes->GetCount(), (int)changed);
+  return changed;
+}
 
-    if (!subEnabled) continue;
+bool tpSignalKNotesManager::ProcessResourceSetResponse(
+    const wxString& resourceSetName, const tpHttpRequest& response,
+    tpResourceSetParser& parser, tpResourceSetResult& out) {
+  if (response.notModified) {
+    SKN_LOG(m_parent, "FetchResourceSet: %s unverändert", resourceSetName);
+    out.unchanged = true;
+    return true;
+  }
 
-    wxJSONValue features = rsEntry["values"]["features"];
-    for (int j = 0; j < features.Size(); j++) {
-      wxJSONValue feat = features[j];
-      if (!feat.HasMember("geometry") || !feat.HasMember("properties"))
-        continue;
+  if (parser.HasError()) {
+    SKN_LOG(m_parent, "FetchResourceSet: JSON-Fehler für %s", resourceSetName);
+    return false;
+  }
 
-      wxJSONValue geom = feat["geometry"];
-      wxJSONValue props = feat["properties"];
+  if (response.status != 200 || !response.error.IsEmpty() ||
+      response.bodyBytes == 0) {
+    SKN_LOG(m_parent, "FetchResourceSet: Kein Ergebnis für %s (status=%ld %s)",
+            resourceSetName, response.status, response.error);
+    return false;
+  }
 
-      if (geom["type"].AsString() != "Point") continue;
-      wxJSONValue coords = geom["coordinates"];
-      if (coords.Size() < 2) continue;
+  // Der Body ist schon durch den Parser gelaufen (beim Empfang oder, ohne
+  // ETag, nach dem Hash-Vergleich) - hier wird nur das Ergebnis übernommen
+  return parser.Finish();
+}
 
-      double lon = coords[0].AsDouble();
-      double lat = coords[1].AsDouble();
-      wxString name =
-          props.HasMember("name") ? props["name"].AsString() : _("Unknown");
-      wxString desc = props.HasMember("description")
-                          ? props["description"].AsString()
-                          : wxString("");
+bool tpSignalKNotesManager::LoadOfflineTile(const wxString& quadKey,
+                                            tpFetchResult& result,
+                                            tpTileResult& tileResult) {
+  std::vector<wxString> keys = m_offlineStore->FindTiles(quadKey);
+  if (keys.empty()) return false;
+
+  // Gespeichert wird auf einer festen Zoomstufe: die Eltern-Kachel
+  // zuschneiden oder die Kinder zusammenfassen
+  std::map<wxString, SignalKNote> notes;
+  for (const auto& key : keys) {
+    std::string body;
+    if (!m_offlineStore->LoadTile(key, body)) continue;
+
+    std::map<wxString, SignalKNote> part;
+    tpNotesListParser parser(this, result, part);
+    if (!parser.Feed(body.data(), body.size()) || !parser.Finish()) continue;
+    tpTileCache::ClipToTile(quadKey, part);
+    notes.insert(part.begin(), part.end());
+  }
+
+  tileResult.notes.swap(notes);
+  tileResult.status = (int)tileResult.notes.size();
+  tileResult.unchanged = false;
+  tileResult.offline = true;
+  return true;
+}
 
-      // GUID: stabil und eindeutig pro Eintrag
-      wxString guid =
-          wxString::Format("RS_%s_%s_%d", resourceSetName, subName, j);
+bool tpSignalKNotesManager::LoadOfflineResourceSet(
+    const wxString& resourceSetName,
+    const std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
+        configuredSubs,
+    tpResourceSetResult& out) {
+  std::string body;
+  if (!m_offlineStore->LoadResourceSet(resourceSetName, body)) return false;
 
-      SignalKNote note;
-      note.GUID = guid;
-      note.id = guid;
-      note.name = name;
-      note.description = desc;
-      note.latitude = lat;
-      note.longitude = lon;
-      note.iconName = iconName;
-      note.source =
-          wxString::Format("resourceset:%s:%s", resourceSetName, subName);
-      note.isDisplayed = true;
-
-      newNotes[guid] = note;
-    }
-  }
+  tpResourceSetResult result;
+  tpResourceSetParser parser(this, resourceSetName, configuredSubs, result);
+  if (!parser.Feed(body.data(), body.size()) || !parser.Finish()) return false;
 
-  // Änderungscheck: Vergleiche mit bisherigen resourceSetNotes
-  wxMutexLocker lock(state.notesMutex);
+  SKN_LOG(m_parent, "FetchResourceSet: %s aus dem Offline-Speicher (%d Notes)",
+          resourceSetName, (int)result.notes->GetCount());
+  std::swap(out, result);
+  return true;
+}
 
-  // Alte RS-Notes für dieses resourceSet entfernen - NUR wenn newNotes gefüllt
-  // ODER wenn das Resourceset explizit deaktiviert wurde
-  std::vector<wxString> toRemove;
-  for (auto& kv : state.resourceSetNotes) {
-    if (kv.second.source.StartsWith(
-            wxString::Format("resourceset:%s:", resourceSetName))) {
-      toRemove.push_back(kv.first);
-    }
+bool tpSignalKNotesManager::StartOfflineDownload(
+    const std::set<wxString>& tiles) {
+  if (m_serverHost.IsEmpty() || tiles.empty()) return false;
+  if (tiles.size() > tpOfflineStore::MAX_REGION_TILES) {
+    SKN_LOG(m_parent, "Offline download: region too large (%d tiles)",
+            (int)tiles.size());
+    return false;
   }
 
-  // Nur löschen wenn neue Notes vorhanden ODER wenn bewusst alle deaktiviert
-  if (!newNotes.empty() || configuredSubs.empty()) {
-    for (auto& guid : toRemove) state.resourceSetNotes.erase(guid);
-    for (auto& kv : newNotes) state.resourceSetNotes[kv.first] = kv.second;
+  std::vector<wxString> items;
+  for (const auto& tile : tiles) items.push_back("tile:" + tile);
+  for (const auto& rsKv : m_parent->m_resourceSetConfigs) {
+    if (rsKv.second.enabled) items.push_back("rs:" + rsKv.first);
   }
-  // Wenn newNotes leer UND configuredSubs nicht leer: Fetch hat wahrscheinlich
-  // gefehlt → alte Notes behalten
 
-  bool changed = (toRemove.size() != newNotes.size());
-  if (!changed) {
-    for (auto& kv : newNotes) {
-      if (state.resourceSetNotes.find(kv.first) ==
-          state.resourceSetNotes.end()) {
-        changed = true;
-        break;
-      }
-    }
+  StopOfflineDownload();
+  if (!m_offlineStore->SaveJob(items)) {
+    SKN_LOG(m_parent, "Offline download: could not write the job file");
+    return false;
   }
-
-  int count = (int)newNotes.size();
-  SKN_LOG(m_parent, "ParseResourceSetJSON: %s → %d Notes geladen (changed=%d)",
-          resourceSetName, count, (int)changed);
-  return count;
+  return StartOfflineDownloader(items);
 }
 
-static wxString EncodeResourceSetName(const wxString& name) {
-  wxString encoded = name;
-  encoded.Replace("ä", "%C3%A4");
-  encoded.Replace("ö", "%C3%B6");
-  encoded.Replace("ü", "%C3%BC");
-  encoded.Replace("Ä", "%C3%84");
-  encoded.Replace("Ö", "%C3%96");
-  encoded.Replace("Ü", "%C3%9C");
-  encoded.Replace("ß", "%C3%9F");
-  encoded.Replace(" ", "%20");
-  encoded.Replace("é", "%C3%A9");
-  encoded.Replace("è", "%C3%A8");
-  encoded.Replace("à", "%C3%A0");
-  return encoded;
-}
+bool tpSignalKNotesManager::ResumeOfflineDownload() {
+  StopOfflineDownload();
 
-// Prüft ob ein JSON-Root ein "flaches" Resourceset ist (UUID → einzelne Notes)
-// Rückgabe: true wenn mindestens ein Eintrag feature.geometry.type == "Point"
-// hat
-static bool IsFlatResourceSet(wxJSONValue root) {
-  if (!root.IsObject()) return false;
-  wxArrayString keys = root.GetMemberNames();
-  for (size_t i = 0; i < keys.GetCount(); i++) {
-    wxJSONValue entry = root[keys[i]];
-    if (!entry.IsObject()) continue;
-    if (!entry.HasMember("feature")) continue;
-    wxJSONValue feat = entry["feature"];
-    if (!feat.HasMember("geometry")) continue;
-    if (!feat["geometry"].HasMember("type")) continue;
-    if (feat["geometry"]["type"].AsString() != "Point") continue;
-    if (!feat["geometry"].HasMember("coordinates")) continue;
-    if (!feat["geometry"]["coordinates"].IsArray()) continue;
-    if (feat["geometry"]["coordinates"].Size() < 2) continue;
-    return true;
+  std::vector<wxString> items;
+  if (!m_offlineStore->LoadJob(items)) return false;
+  if (items.empty()) {
+    m_offlineStore->FinishJob();
+    return false;
   }
-  return false;
+  return StartOfflineDownloader(items);
 }
 
-bool tpSignalKNotesManager::FetchResourceSet(
-    const wxString& resourceSetName,
-    std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
-        outDiscoveredSubs,
-    signalk_notes_opencpn_pi::CanvasState& state,
-    const std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
-        configuredSubs) {
-  wxString url =
-      wxString::Format("http://%s:%d/signalk/v2/api/resources/%s", m_serverHost,
-                       m_serverPort, EncodeResourceSetName(resourceSetName));
-  wxString authHeader;
-  if (!m_authToken.IsEmpty())
-    authHeader = "Authorization: Bearer " + m_authToken;
-
-  wxString json = HttpGet(url, authHeader);
-  if (json.IsEmpty()) {
-    SKN_LOG(m_parent, "FetchResourceSet: Kein Ergebnis für %s",
-            resourceSetName);
+bool tpSignalKNotesManager::StartOfflineDownloader(
+    const std::vector<wxString>& items) {
+  tpOfflineDownloader* downloader = new tpOfflineDownloader(
+      this, m_offlineStore.get(), GetServer(0), m_authToken, items);
+  if (downloader->Create() != wxTHREAD_NO_ERROR ||
+      downloader->Run() != wxTHREAD_NO_ERROR) {
+    SKN_LOG(m_parent, "Failed to start offline download thread");
+    delete downloader;
     return false;
   }
-
-  // Struktur erkennen: hierarchisch (values.features) oder flach (UUID → Note)?
-  wxJSONReader reader;
-  wxJSONValue root;
-  if (reader.Parse(json, &root) != 0) return false;
-
-  if (IsFlatResourceSet(root)) {
-    // Flaches Resourceset: das gesamte RS ist ein einzelnes "Unter-RS"
-    // Eintrag mit dem RS-Namen selbst als Sub-Name anlegen
-    wxString subName = resourceSetName;
-    if (outDiscoveredSubs.find(subName) == outDiscoveredSubs.end()) {
-      signalk_notes_opencpn_pi::SubResourceSetConfig cfg;
-      cfg.name = subName;
-      cfg.enabled = false;
-      auto it = configuredSubs.find(subName);
-      if (it != configuredSubs.end()) {
-        cfg.enabled = it->second.enabled;
-        cfg.iconName = it->second.iconName;
-      }
-      outDiscoveredSubs[subName] = cfg;
-    }
-
-    // Nur laden wenn aktiviert
-    auto cfgIt = configuredSubs.find(subName);
-    if (cfgIt != configuredSubs.end() && cfgIt->second.enabled) {
-      ParseFlatResourceSetJSON(json, resourceSetName, state, cfgIt->second);
-    }
-  } else {
-    // Hierarchisches Resourceset: normale Verarbeitung
-    ParseResourceSetJSON(json, resourceSetName, state, configuredSubs,
-                         outDiscoveredSubs);
-  }
-
+  m_offlineDownloader = downloader;
   return true;
 }
 
-bool tpSignalKNotesManager::DiscoverSubResourceSets(
-    const wxString& resourceSetName,
-    std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig>&
-        outSubs) {
-  wxString url =
-      wxString::Format("http://%s:%d/signalk/v2/api/resources/%s", m_serverHost,
-                       m_serverPort, EncodeResourceSetName(resourceSetName));
-  wxString authHeader;
-  if (!m_authToken.IsEmpty())
-    authHeader = "Authorization: Bearer " + m_authToken;
-
-  wxString json = HttpGet(url, authHeader);
-  if (json.IsEmpty()) return false;
-
-  wxJSONReader reader;
-  wxJSONValue root;
-  if (reader.Parse(json, &root) != 0) return false;
+void tpSignalKNotesManager::StopOfflineDownload() {
+  if (!m_offlineDownloader) return;
 
-  if (IsFlatResourceSet(root)) {
-    // Flaches RS: nur ein Eintrag mit dem RS-Namen selbst
-    if (outSubs.find(resourceSetName) == outSubs.end()) {
-      signalk_notes_opencpn_pi::SubResourceSetConfig cfg;
-      cfg.name = resourceSetName;
-      cfg.enabled = false;
-      outSubs[resourceSetName] = cfg;
-    }
-  } else {
-    // Hierarchisches RS: Unter-RS-Namen sammeln
-    wxArrayString uuids = root.GetMemberNames();
-    for (size_t i = 0; i < uuids.GetCount(); i++) {
-      wxJSONValue entry = root[uuids[i]];
-      if (!IsValidResourceSet(entry)) continue;
-      wxString subName = entry["name"].AsString();
-      if (outSubs.find(subName) == outSubs.end()) {
-        signalk_notes_opencpn_pi::SubResourceSetConfig cfg;
-        cfg.name = subName;
-        cfg.enabled = false;
-        outSubs[subName] = cfg;
-      }
-    }
-  }
+  m_offlineDownloader->RequestStop();
+  m_offlineDownloader->Wait();
+  delete m_offlineDownloader;
+  m_offlineDownloader = nullptr;
+}
 
-  return !outSubs.empty();
+void tpSignalKNotesManager::ClearOfflineStore() {
+  StopOfflineDownload();
+  m_offlineStore->Clear();
 }
 
-int tpSignalKNotesManager::ParseFlatResourceSetJSON(
-    const wxString& json, const wxString& resourceSetName,
-    signalk_notes_opencpn_pi::CanvasState& state,
-    const signalk_notes_opencpn_pi::SubResourceSetConfig& config) {
-  wxJSONReader reader;
-  wxJSONValue root;
-  if (reader.Parse(json, &root) != 0) return 0;
+void tpSignalKNotesManager::GetOfflineStatus(tpOfflineStatus& status) {
+  status = tpOfflineStatus();
+  if (m_offlineDownloader) m_offlineDownloader->GetProgress(status);
+  status.unfinished = !status.running && m_offlineStore->HasJob();
+  status.tiles = m_offlineStore->GetTileCount();
+  status.resourceSets = m_offlineStore->GetResourceSetCount();
+  status.sizeBytes = m_offlineStore->GetSizeBytes();
+}
 
-  std::map<wxString, SignalKNote> newNotes;
+size_t tpSignalKNotesManager::DownloadOfflineItems(
+    tpHttpClient& http, const tpServerEndpoint& server,
+    const wxString& authToken, const std::vector<wxString>& items,
+    tpOfflineStore& store, const std::function<bool()>& isCancelled) {
+  wxString authHeader = BearerHeader(authToken);
+
+  std::vector<tpHttpRequest> batch;
+  for (const auto& item : items) {
+    wxString key;
+    if (item.StartsWith("tile:", &key)) {
+      batch.push_back(
+          tpHttpRequest(NotesTileUrl(server.host, server.port, key)));
+    } else {
+      item.StartsWith("rs:", &key);
+      batch.push_back(tpHttpRequest(
+          ResourceSetUrl(server.host, server.port, key), authHeader));
+      batch.back().timeoutSecs = 60;  // ganze Resourcesets können groß sein
+    }
+    batch.back().isCancelled = isCancelled;
+  }
 
-  wxArrayString uuids = root.GetMemberNames();
-  for (size_t i = 0; i < uuids.GetCount(); i++) {
-    wxJSONValue entry = root[uuids[i]];
-    if (!entry.IsObject()) continue;
-    if (!entry.HasMember("feature")) continue;
+  size_t stored = 0;
+  http.PerformAll(batch, [&](size_t index, tpHttpRequest& response) {
+    if (response.cancelled || response.status != 200 ||
+        !response.error.IsEmpty())
+      return;
 
-    wxJSONValue feat = entry["feature"];
-    if (!feat.HasMember("geometry") || !feat.HasMember("properties")) continue;
+    const wxString& item = items[index];
+    wxString key;
+    bool saved = item.StartsWith("tile:", &key)
+                     ? store.SaveTile(key, response.body)
+                     : item.StartsWith("rs:", &key) &&
+                           store.SaveResourceSet(key, response.body);
+    if (!saved) return;
+    store.MarkDone(item);
+    stored++;
+  });
+  return stored;
+}
 
-    wxJSONValue geom = feat["geometry"];
-    if (geom["type"].AsString() != "Point") continue;
-    wxJSONValue coords = geom["coordinates"];
-    if (coords.Size() < 2) continue;
+void tpSignalKNotesManager::InitConfigLoadJob(
+    tpConfigLoadJob& job, std::vector<tpConfigLoadResult>& cached) {
+  job.server = GetServer(0);
+  job.authToken = m_authToken;
+  wxLongLong now = wxGetLocalTimeMillis();
 
-    double lon = coords[0].AsDouble();
-    double lat = coords[1].AsDouble();
+  // Aktuelle Snapshots der Canvas reichen, nur der Rest wird abgerufen. Mit
+  // der echten Konfiguration geparst, dient das Ergebnis wiederum den Canvas
+  // als Snapshot.
+  for (const auto& rsKv : m_parent->m_resourceSetConfigs) {
+    job.knownResourceSets.insert(rsKv.first);
+    const tpResourceSetSnapshot* snapshot =
+        FindResourceSetSnapshot(rsKv.first, rsKv.second, now);
+    if (!snapshot) {
+      job.resourceSets[rsKv.first] = rsKv.second;
+      continue;
+    }
 
-    wxJSONValue props = feat["properties"];
-    wxString name = props.HasMember("name")   ? props["name"].AsString()
-                    : entry.HasMember("name") ? entry["name"].AsString()
-                                              : _("Unknown");
-    wxString desc =
-        entry.HasMember("description")   ? entry["description"].AsString()
-        : props.HasMember("description") ? props["description"].AsString()
-                                         : wxString("");
+    tpConfigLoadResult result;
+    result.kind = tpConfigLoadResult::RESOURCE_SET;
+    result.ok = true;
+    result.fromSnapshot = true;
+    result.resourceSetName = rsKv.first;
+    result.config = rsKv.second;
+    result.rsResult.discoveredSubs = snapshot->result.discoveredSubs;
+    cached.push_back(result);
+  }
 
-    wxString guid = wxString::Format("RSF_%s_%s", resourceSetName, uuids[i]);
+  SKN_LOG(m_parent, "Config dialog: %d resourcesets from snapshot, %d fetched",
+          (int)cached.size(), (int)job.resourceSets.size());
+}
 
-    SignalKNote note;
-    note.GUID = guid;
-    note.id = guid;
-    note.name = name;
-    note.description = desc;
-    note.latitude = lat;
-    note.longitude = lon;
-    note.iconName = config.iconName;
-    note.source =
-        wxString::Format("resourceset:%s:%s", resourceSetName, resourceSetName);
-    note.isDisplayed = true;
+void tpSignalKNotesManager::LoadConfigData(
+    tpHttpClient& http, const tpConfigLoadJob& job,
+    const std::function<bool()>& isCancelled,
+    const std::function<void(tpConfigLoadResult&)>& onResult) {
+  const tpServerEndpoint& server = job.server;
+  wxString authHeader = BearerHeader(job.authToken);
+
+  // /plugins/ dient zugleich der Token-Prüfung und dem Aufräumen der
+  // Provider, die Liste der Resourcesets und die bekannten Resourcesets
+  // laufen gleichzeitig; erst durch die Liste bekannt gewordene
+  // Resourcesets folgen in einer zweiten Runde
+  std::vector<tpHttpRequest> batch;
+  batch.push_back(tpHttpRequest(
+      wxString::Format("http://%s:%d/plugins/", server.host, server.port),
+      authHeader));
+  batch.push_back(tpHttpRequest(wxString::Format(
+      "http://%s:%d/signalk/v2/api/resources", server.host, server.port)));
+  size_t firstResourceSet = batch.size();
+
+  std::vector<std::unique_ptr<tpConfigLoadResult>> results;
+  std::vector<std::unique_ptr<tpResourceSetParser>> parsers;
+  auto addResourceSet =
+      [&](const wxString& rsName,
+          const signalk_notes_opencpn_pi::ResourceSetConfig& config) {
+        results.push_back(
+            std::unique_ptr<tpConfigLoadResult>(new tpConfigLoadResult()));
+        tpConfigLoadResult& result = *results.back();
+        result.kind = tpConfigLoadResult::RESOURCE_SET;
+        result.resourceSetName = rsName;
+        result.config = config;
+
+        batch.push_back(tpHttpRequest(
+            ResourceSetUrl(server.host, server.port, rsName), authHeader));
+        parsers.push_back(std::unique_ptr<tpResourceSetParser>(
+            new tpResourceSetParser(this, rsName, result.config.subSets,
+                                    result.rsResult)));
+        tpResourceSetParser* parser = parsers.back().get();
+        batch.back().onData = [parser](const char* data, size_t size) {
+          return parser->Feed(data, size);
+        };
+      };
+  for (const auto& rsKv : job.resourceSets)
+    addResourceSet(rsKv.first, rsKv.second);
+
+  std::set<wxString> newResourceSets;
+  auto onDone = [&](size_t index, tpHttpRequest& response) {
+    if (response.cancelled) return;
+    bool ok = response.status == 200 && response.error.IsEmpty();
+
+    if (index < firstResourceSet) {
+      tpConfigLoadResult result;
+      result.ok = ok;
+      if (index == 0) {
+        result.kind = tpConfigLoadResult::PLUGINS;
+        if (ok) result.body = wxString::FromUTF8(response.body.c_str());
+      } else {
+        result.kind = tpConfigLoadResult::RESOURCE_SET_LIST;
+        result.ok = ok && ParseResourceSetList(
+                              wxString::FromUTF8(response.body.c_str()),
+                              result.resourceSets);
+        for (const auto& rsName : result.resourceSets) {
+          if (job.knownResourceSets.count(rsName) == 0)
+            newResourceSets.insert(rsName);
+        }
+      }
+      onResult(result);
+      return;
+    }
 
-    newNotes[guid] = note;
-  }
+    size_t rsIndex = index - firstResourceSet;
+    tpConfigLoadResult& result = *results[rsIndex];
+    if (ok) {
+      LogTransferSize(m_parent, result.resourceSetName, response);
+      result.ok = parsers[rsIndex]->Finish();
+    }
+    onResult(result);
+  };
 
-  // Änderungscheck und Speichern (analog zu ParseResourceSetJSON)
-  wxMutexLocker lock(state.notesMutex);
+  for (auto& request : batch) request.isCancelled = isCancelled;
+  http.PerformAll(batch, onDone);
+  if (newResourceSets.empty() || isCancelled()) return;
+
+  batch.clear();
+  results.clear();
+  parsers.clear();
+  firstResourceSet = 0;
+  for (const auto& rsName : newResourceSets) {
+    signalk_notes_opencpn_pi::ResourceSetConfig config;
+    config.name = rsName;
+    addResourceSet(rsName, config);
+  }
+  for (auto& request : batch) request.isCancelled = isCancelled;
+  http.PerformAll(batch, onDone);
+}
 
-  std::vector<wxString> toRemove;
-  for (auto& kv : state.resourceSetNotes) {
-    if (kv.second.source ==
-        wxString::Format("resourceset:%s:%s", resourceSetName, resourceSetName))
-      toRemove.push_back(kv.first);
+void tpSignalKNotesManager::ApplyConfigLoadResult(tpConfigLoadResult& result) {
+  if (result.kind == tpConfigLoadResult::PLUGINS) {
+    std::map<wxString, bool> installedPlugins;
+    result.ok = result.ok && ParseInstalledPlugins(result.body,
+                                                   installedPlugins);
+    if (result.ok)
+      RemoveDisabledProviders(installedPlugins);
+    else
+      SKN_LOG(m_parent, "Cannot cleanup providers - plugin fetch failed");
+    return;
   }
 
-  // Nur löschen+ersetzen wenn tatsächlich Daten geladen wurden
-  if (!newNotes.empty()) {
-    for (auto& guid : toRemove) state.resourceSetNotes.erase(guid);
-    for (auto& kv : newNotes) state.resourceSetNotes[kv.first] = kv.second;
-  }
+  if (result.kind != tpConfigLoadResult::RESOURCE_SET || !result.ok ||
+      result.fromSnapshot)
+    return;
 
-  SKN_LOG(m_parent, "ParseFlatResourceSetJSON: %s → %d Notes", resourceSetName,
-          (int)newNotes.size());
-  return (int)newNotes.size();
+  // Der Snapshot übernimmt das Ergebnis, der Dialog braucht noch die
+  // gefundenen Unter-Resourcesets
+  std::map<wxString, signalk_notes_opencpn_pi::SubResourceSetConfig> subs =
+      result.rsResult.discoveredSubs;
+  StoreResourceSetSnapshot(result.resourceSetName, result.config,
+                           result.rsResult, wxGetLocalTimeMillis());
+  result.rsResult.discoveredSubs.swap(subs);
 }
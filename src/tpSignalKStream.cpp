@@ -0,0 +1,420 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   SignalK WebSocket delta stream for push based note updates
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "ocpn_plugin.h"
+#include "signalk_notes_opencpn_pi.h"
+#include "tpSignalKNotes.h"
+#include "tpSignalKStream.h"
+
+#include <wx/base64.h>
+#include <wx/jsonreader.h>
+#include <wx/jsonwriter.h>
+#include <wx/tokenzr.h>
+
+#include <stdint.h>
+#include <random>
+
+// WebSocket Opcodes (RFC 6455)
+enum {
+  WS_OP_CONTINUATION = 0x0,
+  WS_OP_TEXT = 0x1,
+  WS_OP_BINARY = 0x2,
+  WS_OP_CLOSE = 0x8,
+  WS_OP_PING = 0x9,
+  WS_OP_PONG = 0xA
+};
+
+// Pause vor einem neuen Verbindungsversuch
+static const int RECONNECT_DELAY_MS = 15000;
+// Schutz gegen kaputte Frames: größere Nachrichten werden verworfen
+static const uint64_t MAX_MESSAGE_SIZE = 64 * 1024 * 1024;
+
+static std::mt19937& Random() {
+  static std::mt19937 s_random(std::random_device{}());
+  return s_random;
+}
+
+static uint32_t Rotl(uint32_t value, int bits) {
+  return (value << bits) | (value >> (32 - bits));
+}
+
+// SHA-1 (FIPS 180-1), nur für Sec-WebSocket-Accept
+static void Sha1(const std::string& data, unsigned char digest[20]) {
+  uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476,
+                   0xC3D2E1F0};
+
+  std::string msg = data;
+  uint64_t bitLength = (uint64_t)data.size() * 8;
+  msg += '\x80';
+  while (msg.size() % 64 != 56) msg += '\0';
+  for (int i = 7; i >= 0; i--) msg += (char)((bitLength >> (i * 8)) & 0xFF);
+
+  for (size_t block = 0; block < msg.size(); block += 64) {
+    const unsigned char* p = (const unsigned char*)msg.data() + block;
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+      w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 |
+             (uint32_t)p[4 * i + 2] << 8 | (uint32_t)p[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++)
+      w[i] = Rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+      uint32_t f, k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+      uint32_t temp = Rotl(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = Rotl(b, 30);
+      b = a;
+      a = temp;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+
+  for (int i = 0; i < 20; i++)
+    digest[i] = (unsigned char)(h[i / 4] >> (24 - 8 * (i % 4)));
+}
+
+// Was der Server für unseren Sec-WebSocket-Key zurückschicken muss
+// (RFC 6455, 4.2.2)
+static wxString WebSocketAccept(const wxString& key) {
+  wxCharBuffer utf8 = key.ToUTF8();
+  unsigned char digest[20];
+  Sha1(std::string(utf8.data(), utf8.length()) +
+           "258EAFA5-E914-47DA-95CA-C5AB0DC85B11",
+       digest);
+  return wxBase64Encode(digest, sizeof(digest));
+}
+
+tpSignalKStream::tpSignalKStream(tpSignalKNotesManager* manager,
+                                 const wxString& host, int port,
+                                 const wxString& authToken,
+                                 const std::vector<wxString>& resourceSets)
+    : wxThread(wxTHREAD_JOINABLE),
+      m_manager(manager),
+      m_host(host.Clone()),
+      m_port(port),
+      m_authToken(authToken.Clone()),
+      m_cond(m_mutex) {
+  for (const auto& rs : resourceSets) m_resourceSets.push_back(rs.Clone());
+}
+
+void tpSignalKStream::RequestStop() {
+  wxMutexLocker lock(m_mutex);
+  m_stopRequested = true;
+  m_cond.Broadcast();
+}
+
+bool tpSignalKStream::IsStopRequested() {
+  wxMutexLocker lock(m_mutex);
+  return m_stopRequested;
+}
+
+bool tpSignalKStream::WaitForStop(int milliseconds) {
+  wxMutexLocker lock(m_mutex);
+  if (!m_stopRequested) m_cond.WaitTimeout(milliseconds);
+  return m_stopRequested;
+}
+
+wxThread::ExitCode tpSignalKStream::Entry() {
+  signalk_notes_opencpn_pi* plugin = m_manager->GetPlugin();
+
+  while (!IsStopRequested()) {
+    wxSocketClient socket(wxSOCKET_BLOCK | wxSOCKET_WAITALL);
+    socket.SetTimeout(10);
+
+    if (Connect(socket)) {
+      SKN_LOG(plugin, "Stream: connected to %s:%d", m_host, m_port);
+      m_manager->PublishStreamState(true);
+
+      RunSession(socket);
+
+      m_manager->PublishStreamState(false);
+      SKN_LOG(plugin, "Stream: disconnected, falling back to polling");
+    }
+    socket.Close();
+
+    if (WaitForStop(RECONNECT_DELAY_MS)) break;
+  }
+
+  return (ExitCode)0;
+}
+
+bool tpSignalKStream::Connect(wxSocketClient& socket) {
+  signalk_notes_opencpn_pi* plugin = m_manager->GetPlugin();
+
+  wxIPV4address addr;
+  addr.Hostname(m_host);
+  addr.Service(m_port);
+
+  if (!socket.Connect(addr, true) || !socket.IsConnected()) {
+    SKN_LOG(plugin, "Stream: connect to %s:%d failed", m_host, m_port);
+    return false;
+  }
+
+  unsigned char nonce[16];
+  for (auto& b : nonce) b = (unsigned char)(Random()() & 0xFF);
+  wxString key = wxBase64Encode(nonce, sizeof(nonce));
+
+  wxString handshake = wxString::Format(
+      "GET /signalk/v1/stream?subscribe=none HTTP/1.1\r\n"
+      "Host: %s:%d\r\n"
+      "Upgrade: websocket\r\n"
+      "Connection: Upgrade\r\n"
+      "Sec-WebSocket-Key: %s\r\n"
+      "Sec-WebSocket-Version: 13\r\n",
+      m_host, m_port, key);
+  if (!m_authToken.IsEmpty())
+    handshake += "Authorization: Bearer " + m_authToken + "\r\n";
+  handshake += "\r\n";
+
+  wxCharBuffer request = handshake.ToUTF8();
+  socket.Write(request.data(), request.length());
+  if (socket.Error()) return false;
+
+  // Antwort-Header bis zur Leerzeile lesen
+  std::string header;
+  char c;
+  while (header.size() < 8192) {
+    if (!ReadExact(socket, &c, 1)) return false;
+    header += c;
+    if (header.size() >= 4 &&
+        header.compare(header.size() - 4, 4, "\r\n\r\n") == 0)
+      break;
+  }
+
+  // Statuszeile "HTTP/1.1 101 Switching Protocols", danach die Header
+  wxStringTokenizer lines(wxString::FromUTF8(header.c_str()), "\r\n",
+                          wxTOKEN_STRTOK);
+  wxString statusLine = lines.GetNextToken();
+  if (!statusLine.StartsWith("HTTP/") ||
+      statusLine.AfterFirst(' ').BeforeFirst(' ') != "101") {
+    SKN_LOG(plugin, "Stream: handshake rejected: %s", statusLine);
+    return false;
+  }
+
+  wxString accept;
+  while (lines.HasMoreTokens()) {
+    wxString line = lines.GetNextToken();
+    wxString name = line.BeforeFirst(':').Trim();
+    if (name.IsSameAs("Sec-WebSocket-Accept", false))
+      accept = line.AfterFirst(':').Trim(false).Trim();
+  }
+  if (accept != WebSocketAccept(key)) {
+    SKN_LOG(plugin, "Stream: wrong Sec-WebSocket-Accept '%s'", accept);
+    return false;
+  }
+
+  // Abonnement: Notes und alle aktivierten Resourcesets, Änderungen sofort
+  wxJSONValue subscribe;
+  subscribe["context"] = "vessels.self";
+  wxJSONValue paths;
+  paths.SetType(wxJSONTYPE_ARRAY);
+
+  wxJSONValue notes;
+  notes["path"] = "resources.notes.*";
+  notes["policy"] = "instant";
+  paths.Append(notes);
+
+  for (const auto& rs : m_resourceSets) {
+    wxJSONValue entry;
+    entry["path"] = "resources." + rs + ".*";
+    entry["policy"] = "instant";
+    paths.Append(entry);
+  }
+  subscribe["subscribe"] = paths;
+
+  wxString message;
+  wxJSONWriter writer(wxJSONWRITER_NONE);
+  writer.Write(subscribe, message);
+
+  wxCharBuffer utf8 = message.ToUTF8();
+  return SendFrame(socket, WS_OP_TEXT, std::string(utf8.data(), utf8.length()));
+}
+
+bool tpSignalKStream::RunSession(wxSocketClient& socket) {
+  std::string message;
+
+  while (!IsStopRequested()) {
+    // Kurz warten, damit ein Stop-Wunsch zeitnah bemerkt wird
+    if (!socket.WaitForRead(0, 500)) {
+      if (!socket.IsConnected()) return false;
+      continue;
+    }
+
+    int opcode = 0;
+    bool fin = false;
+    std::string payload;
+    if (!ReadFrame(socket, opcode, fin, payload)) return false;
+
+    switch (opcode) {
+      case WS_OP_TEXT:
+      case WS_OP_BINARY:
+        message.swap(payload);
+        break;
+      case WS_OP_CONTINUATION:
+        message += payload;
+        break;
+      case WS_OP_PING:
+        SendFrame(socket, WS_OP_PONG, payload);
+        continue;
+      case WS_OP_PONG:
+        continue;
+      case WS_OP_CLOSE:
+        SendFrame(socket, WS_OP_CLOSE, payload);
+        return false;
+      default:
+        return false;
+    }
+
+    if (message.size() > MAX_MESSAGE_SIZE) return false;
+
+    if (fin) {
+      HandleMessage(message);
+      message.clear();
+    }
+  }
+
+  SendFrame(socket, WS_OP_CLOSE, std::string());
+  return true;
+}
+
+bool tpSignalKStream::ReadExact(wxSocketClient& socket, void* buffer,
+                                size_t size) {
+  socket.Read(buffer, size);
+  return !socket.Error() && socket.LastCount() == size;
+}
+
+bool tpSignalKStream::ReadFrame(wxSocketClient& socket, int& opcode, bool& fin,
+                                std::string& payload) {
+  unsigned char head[2];
+  if (!ReadExact(socket, head, 2)) return false;
+
+  fin = (head[0] & 0x80) != 0;
+  opcode = head[0] & 0x0F;
+  bool masked = (head[1] & 0x80) != 0;
+  uint64_t length = head[1] & 0x7F;
+
+  if (length == 126) {
+    unsigned char ext[2];
+    if (!ReadExact(socket, ext, 2)) return false;
+    length = ((uint64_t)ext[0] << 8) | ext[1];
+  } else if (length == 127) {
+    unsigned char ext[8];
+    if (!ReadExact(socket, ext, 8)) return false;
+    length = 0;
+    for (int i = 0; i < 8; i++) length = (length << 8) | ext[i];
+  }
+
+  if (length > MAX_MESSAGE_SIZE) return false;
+
+  unsigned char mask[4] = {0, 0, 0, 0};
+  if (masked && !ReadExact(socket, mask, 4)) return false;
+
+  payload.resize((size_t)length);
+  if (length > 0 && !ReadExact(socket, &payload[0], (size_t)length))
+    return false;
+
+  if (masked) {
+    for (size_t i = 0; i < payload.size(); i++) payload[i] ^= mask[i % 4];
+  }
+  return true;
+}
+
+bool tpSignalKStream::SendFrame(wxSocketClient& socket, int opcode,
+                                const std::string& payload) {
+  std::string frame;
+  frame += (char)(0x80 | opcode);
+
+  // Client-Frames müssen maskiert sein
+  size_t length = payload.size();
+  if (length < 126) {
+    frame += (char)(0x80 | length);
+  } else if (length <= 0xFFFF) {
+    frame += (char)(0x80 | 126);
+    frame += (char)((length >> 8) & 0xFF);
+    frame += (char)(length & 0xFF);
+  } else {
+    frame += (char)(0x80 | 127);
+    for (int i = 7; i >= 0; i--)
+      frame += (char)(((uint64_t)length >> (8 * i)) & 0xFF);
+  }
+
+  unsigned char mask[4];
+  for (auto& b : mask) b = (unsigned char)(Random()() & 0xFF);
+  frame.append((const char*)mask, 4);
+
+  for (size_t i = 0; i < length; i++) frame += (char)(payload[i] ^ mask[i % 4]);
+
+  socket.Write(frame.data(), frame.size());
+  return !socket.Error() && socket.LastCount() == frame.size();
+}
+
+void tpSignalKStream::HandleMessage(const std::string& text) {
+  wxJSONReader reader;
+  wxJSONValue root;
+  if (reader.Parse(wxString::FromUTF8(text.c_str()), &root) > 0) return;
+
+  // Hello-Nachricht und andere Nicht-Deltas ignorieren
+  if (!root.HasMember("updates") || !root["updates"].IsArray()) return;
+
+  std::vector<tpStreamDelta> deltas;
+
+  wxJSONValue updates = root["updates"];
+  for (int i = 0; i < updates.Size(); i++) {
+    wxJSONValue values = updates[i]["values"];
+    if (!values.IsArray()) continue;
+
+    for (int j = 0; j < values.Size(); j++) {
+      wxJSONValue entry = values[j];
+      wxString path = entry["path"].AsString();
+
+      // resources.<typ>.<id>
+      wxString rest;
+      if (!path.StartsWith("resources.", &rest)) continue;
+
+      tpStreamDelta delta;
+      delta.resourceType = rest.BeforeFirst('.');
+      delta.id = rest.AfterFirst('.');
+      if (delta.resourceType.IsEmpty() || delta.id.IsEmpty()) continue;
+
+      wxJSONValue value = entry["value"];
+      delta.deleted = !entry.HasMember("value") || value.IsNull();
+
+      if (delta.resourceType == "notes" && !delta.deleted) {
+        m_manager->ParseNoteValue(delta.id, value, delta.note);
+      }
+
+      deltas.push_back(delta);
+    }
+  }
+
+  if (!deltas.empty()) m_manager->PublishStreamDeltas(deltas);
+}
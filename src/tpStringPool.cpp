@@ -0,0 +1,72 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Intern table for strings shared by many notes
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "tpStringPool.h"
+
+#include <wx/thread.h>
+#include <deque>
+#include <map>
+
+namespace {
+
+struct Pool {
+  wxMutex mutex;
+  // deque: Referenzen aus Get() bleiben beim Anhängen gültig. values[0]
+  // hält nur den Platz für die id 0 frei, Get(0) liest es nicht.
+  std::deque<wxString> values;
+  std::map<wxString, tpStringId> ids;
+
+  Pool() { values.push_back(wxString()); }
+};
+
+Pool& GetPool() {
+  static Pool pool;
+  return pool;
+}
+
+}  // namespace
+
+tpStringId tpStringPool::Intern(const wxString& value) {
+  if (value.IsEmpty()) return 0;
+
+  Pool& pool = GetPool();
+  wxMutexLocker lock(pool.mutex);
+  auto it = pool.ids.find(value);
+  if (it != pool.ids.end()) return it->second;
+
+  tpStringId id = (tpStringId)pool.values.size();
+  pool.values.push_back(value);
+  pool.ids[value] = id;
+  return id;
+}
+
+const wxString& tpStringPool::Get(tpStringId id) {
+  // Der häufigste Fall ohne Lock, aber nicht aus dem deque: ein push_back
+  // in einem anderen Thread darf dessen Blockverwaltung umbauen
+  static const wxString s_empty;
+  if (id == 0) return s_empty;
+
+  Pool& pool = GetPool();
+  wxMutexLocker lock(pool.mutex);
+  return pool.values[id];
+}
+
+size_t tpStringPool::GetCount() {
+  Pool& pool = GetPool();
+  wxMutexLocker lock(pool.mutex);
+  return pool.values.size() - 1;
+}
+
+std::string tpStringPool::ToUtf8(const wxString& text) {
+  wxScopedCharBuffer utf8 = text.utf8_str();
+  return std::string(utf8.data(), utf8.length());
+}
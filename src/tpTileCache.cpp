@@ -0,0 +1,338 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Tile-keyed cache for the notes list
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "tpTileCache.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const double PI = 3.14159265358979323846;
+static const double DEG_TO_RAD = PI / 180.0;
+static const double EARTH_CIRCUMFERENCE = 40075016.686;  // Meter
+static const double METERS_PER_DEG_LAT = 111120.0;
+static const double MAX_MERCATOR_LAT = 85.05112878;
+
+static int TileX(double lon, int n) {
+  int x = (int)std::floor((lon + 180.0) / 360.0 * n);
+  return ((x % n) + n) % n;
+}
+
+static int TileY(double lat, int n) {
+  lat = std::max(-MAX_MERCATOR_LAT, std::min(MAX_MERCATOR_LAT, lat));
+  double latRad = lat * DEG_TO_RAD;
+  double y = (1.0 - std::log(std::tan(latRad) + 1.0 / std::cos(latRad)) / PI) /
+             2.0 * n;
+  return std::max(0, std::min(n - 1, (int)std::floor(y)));
+}
+
+static double TileLat(int y, int n) {
+  return std::atan(std::sinh(PI * (1.0 - 2.0 * y / n))) / DEG_TO_RAD;
+}
+
+static void ParseQuadKey(const wxString& quadKey, int& x, int& y, int& zoom) {
+  x = y = 0;
+  zoom = (int)quadKey.length();
+  for (int i = 0; i < zoom; i++) {
+    int mask = 1 << (zoom - 1 - i);
+    if (quadKey[i] == '1') {
+      x |= mask;
+    } else if (quadKey[i] == '2') {
+      y |= mask;
+    } else if (quadKey[i] == '3') {
+      x |= mask;
+      y |= mask;
+    }
+  }
+}
+
+tpTileRange tpTileCache::RangeForArea(double lat, double lon, double radius) {
+  if (radius <= 0) return tpTileRange();
+
+  lat = std::max(-MAX_MERCATOR_LAT, std::min(MAX_MERCATOR_LAT, lat));
+  double cosLat = std::max(0.01, std::cos(lat * DEG_TO_RAD));
+
+  // Kachelbreite ≈ Radius: ein Viewport liegt auf 2x2 bis 3x3 Kacheln
+  int zoom =
+      (int)std::lround(std::log2(EARTH_CIRCUMFERENCE * cosLat / radius));
+  if (zoom < MIN_ZOOM) zoom = MIN_ZOOM;
+  if (zoom > MAX_ZOOM) zoom = MAX_ZOOM;
+  return RangeAtZoom(lat, lon, radius, zoom);
+}
+
+tpTileRange tpTileCache::RangeAtZoom(double lat, double lon, double radius,
+                                     int zoom) {
+  tpTileRange range;
+  if (radius <= 0) return range;
+
+  lat = std::max(-MAX_MERCATOR_LAT, std::min(MAX_MERCATOR_LAT, lat));
+  double cosLat = std::max(0.01, std::cos(lat * DEG_TO_RAD));
+  range.zoom = zoom;
+  int n = 1 << range.zoom;
+
+  double dLat = radius / METERS_PER_DEG_LAT;
+  double dLon = radius / (METERS_PER_DEG_LAT * cosLat);
+
+  range.y0 = TileY(lat + dLat, n);
+  range.y1 = TileY(lat - dLat, n);
+  if (dLon >= 180.0) {
+    range.x0 = 0;
+    range.x1 = n - 1;
+  } else {
+    range.x0 = TileX(lon - dLon, n);
+    range.x1 = TileX(lon + dLon, n);
+  }
+  return range;
+}
+
+void tpTileCache::TileAt(double lat, double lon, int zoom, int& x, int& y) {
+  int n = 1 << zoom;
+  x = TileX(lon, n);
+  y = TileY(lat, n);
+}
+
+template <typename F>
+void tpTileCache::ForEachTile(const tpTileRange& range, F f) {
+  if (!range.IsValid()) return;
+  int n = 1 << range.zoom;
+  int columns = ((range.x1 - range.x0 + n) % n) + 1;
+
+  for (int y = range.y0; y <= range.y1; y++) {
+    for (int i = 0; i < columns; i++)
+      f(QuadKey((range.x0 + i) % n, y, range.zoom));
+  }
+}
+
+wxString tpTileCache::QuadKey(int x, int y, int zoom) {
+  wxString key;
+  for (int i = zoom; i > 0; i--) {
+    int mask = 1 << (i - 1);
+    char digit = '0';
+    if (x & mask) digit += 1;
+    if (y & mask) digit += 2;
+    key += digit;
+  }
+  return key;
+}
+
+void tpTileCache::TileBounds(const wxString& quadKey, double& latMin,
+                             double& latMax, double& lonMin, double& lonMax) {
+  int x, y, zoom;
+  ParseQuadKey(quadKey, x, y, zoom);
+  int n = 1 << zoom;
+
+  lonMin = (double)x / n * 360.0 - 180.0;
+  lonMax = (double)(x + 1) / n * 360.0 - 180.0;
+  latMax = TileLat(y, n);
+  latMin = TileLat(y + 1, n);
+}
+
+void tpTileCache::QueryCircle(const wxString& quadKey, double& lat,
+                              double& lon, double& radius) {
+  double latMin, latMax, lonMin, lonMax;
+  TileBounds(quadKey, latMin, latMax, lonMin, lonMax);
+  lat = (latMin + latMax) / 2.0;
+  lon = (lonMin + lonMax) / 2.0;
+
+  // Halbe Diagonale, gemessen an der äquatornäheren (breiteren) Kante
+  double edgeLat = std::min(std::fabs(latMin), std::fabs(latMax));
+  if (latMin < 0 && latMax > 0) edgeLat = 0.0;
+  double halfHeight = (latMax - latMin) / 2.0 * METERS_PER_DEG_LAT;
+  double halfWidth = (lonMax - lonMin) / 2.0 * METERS_PER_DEG_LAT *
+                     std::cos(edgeLat * DEG_TO_RAD);
+  radius = std::ceil(std::hypot(halfHeight, halfWidth) * 1.01);
+}
+
+void tpTileCache::ClipToTile(const wxString& quadKey,
+                             std::map<wxString, SignalKNote>& notes) {
+  double latMin, latMax, lonMin, lonMax;
+  TileBounds(quadKey, latMin, latMax, lonMin, lonMax);
+
+  // Untere/linke Kante gehört zur Kachel, obere/rechte zum Nachbarn
+  for (auto it = notes.begin(); it != notes.end();) {
+    const SignalKNote& note = it->second;
+    if (note.latitude > latMin && note.latitude <= latMax &&
+        note.longitude >= lonMin && note.longitude < lonMax)
+      ++it;
+    else
+      it = notes.erase(it);
+  }
+}
+
+bool tpTileCache::IsFresh(const Tile& tile, wxLongLong now,
+                          long maxAgeMs) const {
+  if (tile.fetchTime == 0) return false;
+  return maxAgeMs < 0 || (now - tile.fetchTime).ToLong() <= maxAgeMs;
+}
+
+bool tpTileCache::HasFresh(const wxString& quadKey, wxLongLong now,
+                           long maxAgeMs) const {
+  auto it = m_tiles.find(quadKey);
+  return it != m_tiles.end() && IsFresh(it->second, now, maxAgeMs);
+}
+
+void tpTileCache::Use(Tile& tile, wxLongLong now) {
+  tile.lastUsed = now;
+  if (tile.prefetched) {
+    // Vorausgeladen und jetzt gebraucht
+    tile.prefetched = false;
+    m_prefetchedShown += tile.notes.size();
+  }
+}
+
+void tpTileCache::CollectMissing(const tpTileRange& range, wxLongLong now,
+                                 long maxAgeMs,
+                                 std::vector<tpTileFetch>& missing,
+                                 bool countStats) {
+  ForEachTile(range, [&](const wxString& quadKey) {
+    bool covered = HasFresh(quadKey, now, maxAgeMs);
+
+    // Nach dem Hineinzoomen: Eltern-Kachel enthält diese
+    for (size_t len = quadKey.length() - 1;
+         !covered && len >= (size_t)MIN_ZOOM; len--) {
+      covered = HasFresh(quadKey.Left(len), now, maxAgeMs);
+    }
+
+    // Nach dem Herauszoomen: alle vier Kinder vorhanden
+    if (!covered && (int)quadKey.length() < MAX_ZOOM) {
+      covered = true;
+      for (char digit = '0'; digit <= '3' && covered; digit++) {
+        covered = HasFresh(quadKey + digit, now, maxAgeMs);
+      }
+    }
+
+    if (countStats) {
+      if (covered)
+        m_hits++;
+      else
+        m_misses++;
+    }
+    if (covered) return;
+
+    tpTileFetch fetch;
+    fetch.quadKey = quadKey;
+    fetch.revalidate = m_tiles.find(quadKey) != m_tiles.end();
+    missing.push_back(fetch);
+  });
+}
+
+void tpTileCache::CollectNotes(const tpTileRange& range, wxLongLong now,
+                               std::map<wxString, SignalKNote>& notes) {
+  ForEachTile(range, [&](const wxString& quadKey) {
+    auto it = m_tiles.find(quadKey);
+    if (it != m_tiles.end()) {
+      Use(it->second, now);
+      notes.insert(it->second.notes.begin(), it->second.notes.end());
+      return;
+    }
+
+    // Nächste vorhandene Eltern-Kachel, auf diese Kachel zugeschnitten
+    for (size_t len = quadKey.length() - 1; len >= (size_t)MIN_ZOOM; len--) {
+      auto parentIt = m_tiles.find(quadKey.Left(len));
+      if (parentIt == m_tiles.end()) continue;
+
+      Use(parentIt->second, now);
+      std::map<wxString, SignalKNote> part = parentIt->second.notes;
+      ClipToTile(quadKey, part);
+      notes.insert(part.begin(), part.end());
+      return;
+    }
+
+    // Sonst, was an Kindern da ist
+    for (char digit = '0'; digit <= '3'; digit++) {
+      auto childIt = m_tiles.find(quadKey + digit);
+      if (childIt == m_tiles.end()) continue;
+      Use(childIt->second, now);
+      notes.insert(childIt->second.notes.begin(), childIt->second.notes.end());
+    }
+  });
+}
+
+void tpTileCache::Store(const wxString& quadKey,
+                        std::map<wxString, SignalKNote>& notes, wxLongLong now,
+                        bool prefetched) {
+  Tile& tile = m_tiles[quadKey];
+  tile.notes.swap(notes);
+  tile.fetchTime = now;
+  tile.lastUsed = now;
+  tile.prefetched = prefetched;
+  if (prefetched) m_prefetchedNotes += tile.notes.size();
+  Evict();
+}
+
+void tpTileCache::Touch(const wxString& quadKey, wxLongLong now) {
+  auto it = m_tiles.find(quadKey);
+  if (it == m_tiles.end()) return;
+  it->second.fetchTime = now;
+  it->second.lastUsed = now;
+}
+
+void tpTileCache::Restore(const wxString& quadKey,
+                          const std::map<wxString, SignalKNote>& notes) {
+  if (m_tiles.find(quadKey) != m_tiles.end()) return;
+  // fetchTime und lastUsed 0: abgelaufen und als Erstes verdrängt
+  m_tiles[quadKey].notes = notes;
+  Evict();
+}
+
+void tpTileCache::Expire() {
+  for (auto& kv : m_tiles) kv.second.fetchTime = 0;
+  for (auto& kv : m_canvases) kv.second.prefetch = tpTileRange();
+}
+
+void tpTileCache::Clear() {
+  m_tiles.clear();
+  m_canvases.clear();
+}
+
+const tpTileRange& tpTileCache::GetRange(int canvasIndex) const {
+  static const tpTileRange none;
+  auto it = m_canvases.find(canvasIndex);
+  return it != m_canvases.end() ? it->second.shown : none;
+}
+
+void tpTileCache::SetRange(int canvasIndex, const tpTileRange& range) {
+  m_canvases[canvasIndex].shown = range;
+}
+
+bool tpTileCache::SetPrefetchRange(int canvasIndex, const tpTileRange& range) {
+  tpTileRange& prefetch = m_canvases[canvasIndex].prefetch;
+  if (range == prefetch) return false;
+  prefetch = range;
+  return true;
+}
+
+void tpTileCache::RemoveCanvas(int canvasIndex) {
+  m_canvases.erase(canvasIndex);
+}
+
+void tpTileCache::ApplyNoteDelta(const wxString& id, const SignalKNote* note) {
+  for (auto& kv : m_tiles) {
+    kv.second.notes.erase(id);
+    if (!note) continue;
+
+    double latMin, latMax, lonMin, lonMax;
+    TileBounds(kv.first, latMin, latMax, lonMin, lonMax);
+    if (note->latitude > latMin && note->latitude <= latMax &&
+        note->longitude >= lonMin && note->longitude < lonMax)
+      kv.second.notes[id] = *note;
+  }
+}
+
+void tpTileCache::Evict() {
+  while (m_tiles.size() > MAX_TILES) {
+    auto oldest = m_tiles.begin();
+    for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it) {
+      if (it->second.lastUsed < oldest->second.lastUsed) oldest = it;
+    }
+    m_tiles.erase(oldest);
+  }
+}
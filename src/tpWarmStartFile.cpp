@@ -0,0 +1,208 @@
+﻿/******************************************************************************
+ * Project:   SignalK Notes Plugin for OpenCPN
+ * Purpose:   Notes of the last session for an instant start
+ * Author:    Dirk Behrendt
+ * Copyright: Copyright (c) 2026 Dirk Behrendt
+ * Licence:   GPLv2
+ *
+ * Icon Licensing:
+ *   - Some icons are derived from freeboard-sk (Apache License 2.0)
+ *   - Some icons are based on OpenCPN standard icons (GPLv2)
+ ******************************************************************************/
+
+#include "tpWarmStartFile.h"
+#include "tpNoteBatch.h"
+
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+
+static const uint32_t MAGIC = 0x574e4b53;  // "SKNW"
+// Kleinste Note: vier leere Texte, drei Tabellen-Indizes, Position,
+// Beschreibungs-Ref und Hash
+static const size_t MIN_NOTE_BYTES =
+    8 * sizeof(uint32_t) + 2 * sizeof(double) + sizeof(uint64_t);
+
+// Geteilte Werte (Icon, Quelle, Server) stehen einmal in der Datei, die
+// Notes verweisen per Index darauf; 0 ist der leere Text
+class StringTable {
+public:
+  StringTable() { m_values.push_back(wxEmptyString); }
+
+  uint32_t Add(const wxString& value) {
+    if (value.IsEmpty()) return 0;
+    auto it = m_index.find(value);
+    if (it != m_index.end()) return it->second;
+    uint32_t index = (uint32_t)m_values.size();
+    m_index[value] = index;
+    m_values.push_back(value);
+    return index;
+  }
+
+  void Write(tpBinaryWriter& out) const {
+    out.Put((uint32_t)m_values.size());
+    for (const auto& value : m_values)
+      out.PutString(tpStringPool::ToUtf8(value));
+  }
+
+  bool Read(tpBinaryReader& in) {
+    m_values.resize(in.GetCount(sizeof(uint32_t)));
+    for (auto& value : m_values)
+      value = tpStringPool::FromUtf8(in.GetString());
+    return in.IsOk() && !m_values.empty();
+  }
+
+  const wxString& Get(uint32_t index) const {
+    return index < m_values.size() ? m_values[index] : m_values[0];
+  }
+
+private:
+  std::vector<wxString> m_values;
+  std::map<wxString, uint32_t> m_index;
+};
+
+static void WriteNote(tpBinaryWriter& out, const SignalKNote& note,
+                      StringTable& table) {
+  out.PutString(note.GetIdUtf8());
+  out.PutString(note.GetNameUtf8());
+  out.PutString(note.GetDescriptionUtf8());
+  out.PutString(note.GetUrlUtf8());
+  out.Put(table.Add(note.GetIconName()));
+  out.Put(table.Add(note.GetSource()));
+  out.Put(table.Add(note.GetServer()));
+  out.Put(note.latitude);
+  out.Put(note.longitude);
+  out.Put(note.GetDescriptionRef());
+  out.Put(note.GetContentHash());
+}
+
+static void ReadNote(tpBinaryReader& in, SignalKNote& note,
+                     const StringTable& table) {
+  note.SetIdUtf8(in.GetString());
+  note.SetNameUtf8(in.GetString());
+  note.SetDescriptionUtf8(in.GetString());
+  note.SetUrlUtf8(in.GetString());
+  note.SetIconName(table.Get(in.Get<uint32_t>()));
+  note.SetSource(table.Get(in.Get<uint32_t>()));
+  note.SetServer(table.Get(in.Get<uint32_t>()));
+  note.latitude = in.Get<double>();
+  note.longitude = in.Get<double>();
+  note.SetDescriptionRef(in.Get<uint32_t>());
+  note.SetContentHash(in.Get<uint64_t>());
+}
+
+bool tpWarmStartFile::Save(const Contents& contents) {
+  // Notes zuerst: dabei entsteht die Tabelle, die vor ihnen stehen muss
+  StringTable table;
+  std::string body;
+  tpBinaryWriter out(body);
+
+  out.Put(table.Add(contents.server));
+  out.Put((uint32_t)contents.providers.size());
+  for (const auto& provider : contents.providers) out.Put(table.Add(provider));
+  out.Put((uint32_t)contents.icons.size());
+  for (const auto& icon : contents.icons) out.Put(table.Add(icon));
+
+  out.Put((uint32_t)contents.tiles.size());
+  for (const auto& tile : contents.tiles) {
+    out.Put(table.Add(tile.server));
+    out.PutString(tpStringPool::ToUtf8(tile.quadKey));
+    out.Put((uint32_t)tile.notes.size());
+    for (const auto& kv : tile.notes) WriteNote(out, kv.second, table);
+  }
+
+  out.Put((uint32_t)contents.resourceSets.size());
+  for (const auto& rs : contents.resourceSets) {
+    out.PutString(tpStringPool::ToUtf8(rs.name));
+    out.PutString(tpStringPool::ToUtf8(rs.configKey));
+    out.Put((uint8_t)rs.flat);
+    out.Put((int64_t)rs.dataTime.GetValue());
+    out.Put((uint32_t)rs.notes->GetCount());
+    for (const auto& note : rs.notes->GetNotes())
+      WriteNote(out, note, table);
+    rs.notes->GetDescriptions().Write(out);
+  }
+
+  std::string data;
+  tpBinaryWriter header(data);
+  header.Put(MAGIC);
+  header.Put(VERSION);
+  table.Write(header);
+  data += body;
+
+  // Erst in eine temporäre Datei, dann umbenennen: ein Abbruch hinterlässt
+  // keine halbe Datei
+  wxFileName fn(m_path);
+  if (!fn.DirExists() && !fn.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL))
+    return false;
+  wxString tmpPath = m_path + ".tmp";
+  {
+    wxFile file;
+    if (!file.Create(tmpPath, true)) return false;
+    if (file.Write(data.data(), data.size()) != data.size()) return false;
+  }
+  return wxRenameFile(tmpPath, m_path, true);
+}
+
+bool tpWarmStartFile::Load(Contents& contents) {
+  // In einem Stück lesen; alles wird ohnehin in Notes umkopiert
+  std::string data;
+  {
+    wxFile file;
+    if (!wxFileExists(m_path) || !file.Open(m_path)) return false;
+    wxFileOffset length = file.Length();
+    if (length <= 0) return false;
+    data.resize((size_t)length);
+    if (file.Read(&data[0], data.size()) != length) return false;
+  }
+
+  tpBinaryReader in(data.data(), data.size());
+  if (in.Get<uint32_t>() != MAGIC || in.Get<uint32_t>() != VERSION)
+    return false;
+
+  StringTable table;
+  if (!table.Read(in)) return false;
+
+  contents.server = table.Get(in.Get<uint32_t>());
+  uint32_t count = in.GetCount(sizeof(uint32_t));
+  for (uint32_t i = 0; i < count; i++)
+    contents.providers.insert(table.Get(in.Get<uint32_t>()));
+  count = in.GetCount(sizeof(uint32_t));
+  for (uint32_t i = 0; i < count; i++)
+    contents.icons.insert(table.Get(in.Get<uint32_t>()));
+
+  contents.tiles.resize(in.GetCount(2 * sizeof(uint32_t)));
+  for (auto& tile : contents.tiles) {
+    tile.server = table.Get(in.Get<uint32_t>());
+    tile.quadKey = tpStringPool::FromUtf8(in.GetString());
+    count = in.GetCount(MIN_NOTE_BYTES);
+    for (uint32_t i = 0; i < count; i++) {
+      SignalKNote note;
+      ReadNote(in, note, table);
+      tile.notes[note.GetId()] = note;
+    }
+  }
+
+  contents.resourceSets.resize(in.GetCount(3 * sizeof(uint32_t)));
+  for (auto& rs : contents.resourceSets) {
+    rs.name = tpStringPool::FromUtf8(in.GetString());
+    rs.configKey = tpStringPool::FromUtf8(in.GetString());
+    rs.flat = in.Get<uint8_t>() != 0;
+    rs.dataTime = wxLongLong(in.Get<int64_t>());
+
+    std::vector<SignalKNote> notes(in.GetCount(MIN_NOTE_BYTES));
+    for (auto& note : notes) {
+      ReadNote(in, note, table);
+      note.isDisplayed = true;
+    }
+    tpDescriptionStore descriptions;
+    if (!descriptions.Read(in)) return false;
+    rs.notes = std::make_shared<tpNoteBatch>(notes, descriptions);
+  }
+
+  return in.IsOk();
+}
+
+void tpWarmStartFile::Remove() {
+  if (wxFileExists(m_path)) wxRemoveFile(m_path);
+}